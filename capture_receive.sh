@@ -0,0 +1,72 @@
+#!/bin/bash
+
+# Audio Capture Receiver
+# Requests a WAV from the Sound Explorer over its USB serial port and saves it.
+#
+# Usage: ./capture_receive.sh <serial-port> <output.wav> [seconds]
+#   Without seconds: dump the capture ring (enable it first with 'capture on')
+#   With seconds:    stream that many seconds of live output
+
+set -e
+
+PORT="$1"
+OUTPUT="$2"
+SECONDS_TO_STREAM="$3"
+
+if [ -z "$PORT" ] || [ -z "$OUTPUT" ]; then
+    echo "Usage: $0 <serial-port> <output.wav> [seconds]"
+    exit 1
+fi
+
+if [ ! -e "$PORT" ]; then
+    echo "Error: serial port not found: $PORT"
+    exit 1
+fi
+
+# Raw mode so binary data passes through unchanged
+stty -F "$PORT" 115200 raw -echo
+exec 3<>"$PORT"
+
+if [ -n "$SECONDS_TO_STREAM" ]; then
+    printf 'capture stream %s\r' "$SECONDS_TO_STREAM" >&3
+else
+    printf 'capture dump\r' >&3
+fi
+
+# Skip console text until the "WAV <bytes>" marker
+BYTES=""
+while IFS= read -r -t 10 LINE <&3; do
+    LINE="${LINE%$'\r'}"
+    case "$LINE" in
+        "WAV "[0-9]*)
+            BYTES="${LINE#WAV }"
+            break
+            ;;
+        "Capture busy"*)
+            echo "Error: $LINE"
+            exit 1
+            ;;
+    esac
+done
+
+if [ -z "$BYTES" ]; then
+    echo "Error: no WAV marker received"
+    exit 1
+fi
+
+echo "Receiving $BYTES bytes..."
+head -c "$BYTES" <&3 > "$OUTPUT"
+
+# Transfer summary: "WAV END sent <n> dropped <n> muted <n>"
+while IFS= read -r -t 2 LINE <&3; do
+    LINE="${LINE%$'\r'}"
+    case "$LINE" in
+        "WAV END"*)
+            echo "$LINE"
+            break
+            ;;
+    esac
+done
+
+exec 3<&-
+echo "Saved $OUTPUT"
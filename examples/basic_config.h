@@ -47,15 +47,26 @@
 #define DEFAULT_RELEASE_TIME 2.0f    // 2s release
 #endif
 
+// Tighter drum kit (tune in Hz, decay to -60 dB in ms)
+#ifdef TIGHT_DRUMS
+#define DRUM_KICK_TUNE 60.0f
+#define DRUM_KICK_DECAY_MS 250.0f
+#define DRUM_SNARE_DECAY_MS 120.0f
+#define DRUM_HAT_DECAY_MS 30.0f
+#endif
+
+// Smaller grain pool (RP2040: no FPU and a lower clock)
+#ifdef SMALL_GRAIN_POOL
+#define GRANULAR_MAX_GRAINS 16
+#endif
+
 // Sample rate alternatives for different quality/performance trade-offs
 #ifdef HIGH_QUALITY_AUDIO
 #define SAMPLE_RATE 48000       // Higher quality, more CPU usage
-#define PWM_WRAP 511            // 9-bit resolution
 #endif
 
 #ifdef LOW_POWER_AUDIO
 #define SAMPLE_RATE 22050       // Lower quality, less CPU usage
-#define PWM_WRAP 127            // 7-bit resolution
 #endif
 
 // Waveform customization examples
@@ -65,6 +76,7 @@
 
 #ifdef ENABLE_ANTI_ALIASING
 #define USE_BAND_LIMITED_WAVEFORMS  // Enable band-limited waveforms
+#define OVERSAMPLE_FACTOR 4         // 4x oscillator rate with half-band decimation
 #endif
 
 // Debug and monitoring options
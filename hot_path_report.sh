@@ -0,0 +1,126 @@
+#!/bin/bash
+
+# Audio Hot Path Placement Report
+# Lists every function and table on the sample interrupt path (and the
+# core 1 analyzer), where the linker put it and how big it is, and checks
+# each scratch bank leaves room for the stack it shares. Exits with status 2
+# when a bank is over budget.
+#
+# Usage: ./hot_path_report.sh build/sound_explorer.elf [nm-tool] [rp2040|rp2350]
+
+set -e
+
+ELF="$1"
+NM="${2:-arm-none-eabi-nm}"
+PLATFORM="${3:-rp2350}"
+
+if [ -z "$ELF" ] || [ ! -f "$ELF" ]; then
+    echo "Usage: $0 <sound_explorer.elf> [nm-tool] [rp2040|rp2350]"
+    exit 1
+fi
+
+# Scratch X/Y follow main SRAM: 256K on RP2040, 512K on RP2350
+if [ "$PLATFORM" = "rp2040" ]; then
+    SCRATCH_X=0x20040000
+else
+    SCRATCH_X=0x20080000
+fi
+
+# Audio interrupt path (core 0)
+CORE0_SYMBOLS="pwm_interrupt_handler generate_waveform_sample render_oscillator render_shape
+render_phase_voices render_engine_voice is_phase_voice
+generate_square_wave generate_triangle_wave generate_sawtooth_wave generate_sine_wave
+sine_table adsr_process modulation_process_sample lfo_value lfo_advance
+route_contribution clamp_i32 apply_sums oversampling_get_factor oversampling_decimate
+halfband_decimate halfband_push decimate_stages spectrum_tap timebase_get_pwm_levels timebase_count_sample
+ks_process ks_pool_free additive_process additive_render_block
+capture_tap latency_tap sequencer_process seq_queue_pop seq_event_before seq_apply
+adsr_gate modulation_set_base_increment timebase_get_sample_count timebase_get_sample_rate
+waveform_select drums_process drums_active drums_trigger drums_noise drums_sine
+tuning_is_high_precision granular_process granular_render_block granular_spawn
+audio_input_process audio_input_render_block audio_input_apply audio_input_write_index
+latency_arm_input"
+
+# Spectrum analyzer (core 1)
+CORE1_SYMBOLS="spectrum_core1_entry spectrum_fft spectrum_digit_reverse spectrum_analyze
+spectrum_band_power spectrum_window_capture"
+
+echo "====================================="
+echo "  Audio Hot Path Placement Report    "
+echo "====================================="
+echo "ELF: $ELF ($PLATFORM)"
+echo ""
+
+"$NM" -S "$ELF" | awk -v core0="$CORE0_SYMBOLS" -v core1="$CORE1_SYMBOLS" -v scratch_x="$SCRATCH_X" '
+function hex(s,    i, c, v) {
+    v = 0
+    s = tolower(s)
+    sub(/^0x/, "", s)
+    for (i = 1; i <= length(s); i++) {
+        c = index("0123456789abcdef", substr(s, i, 1)) - 1
+        v = v * 16 + c
+    }
+    return v
+}
+function region(addr) {
+    if (addr < hex("20000000")) return "FLASH"
+    if (addr < sx) return "SRAM"
+    if (addr < sx + 4096) return "SCRATCH_X"
+    if (addr < sx + 8192) return "SCRATCH_Y"
+    return "OTHER"
+}
+BEGIN {
+    sx = hex(scratch_x)
+    n = split(core0, list0, /[ \n]+/)
+    for (i = 1; i <= n; i++) if (list0[i] != "") want[list0[i]] = "core0"
+    n = split(core1, list1, /[ \n]+/)
+    for (i = 1; i <= n; i++) if (list1[i] != "") want[list1[i]] = "core1"
+    printf "%-28s %-6s %-10s %6s  %s\n", "Symbol", "Core", "Address", "Size", "Region"
+}
+NF >= 3 {
+    # Bank bounds from the SDK memory map
+    sym = $NF
+    if (sym ~ /^__scratch_[xy]_(start|end)__$/ || sym ~ /^__Stack(One)?(Bottom|Top)$/) {
+        bound[sym] = hex($1)
+    }
+}
+NF == 4 && ($4 in want) {
+    addr = hex($1)
+    size = hex($2)
+    where = region(addr)
+    printf "%-28s %-6s 0x%s %6d  %s\n", $4, want[$4], $1, size, where
+    total[want[$4] " " where] += size
+    found[$4] = 1
+    if (where == "FLASH") in_flash++
+}
+END {
+    print ""
+    print "Totals (bytes):"
+    for (key in total) printf "  %-20s %6d\n", key, total[key]
+    for (sym in want) if (!(sym in found)) printf "  (inlined or absent: %s)\n", sym
+    if (in_flash > 0) {
+        printf "\n%d hot path symbol(s) still execute from flash\n", in_flash
+    } else {
+        print "\nEntire hot path is RAM resident"
+    }
+
+    print "\nScratch banks (bytes):"
+    over = 0
+    over += bank("SCRATCH_X", "__scratch_x_start__", "__scratch_x_end__", "__StackOneBottom", "__StackOneTop")
+    over += bank("SCRATCH_Y", "__scratch_y_start__", "__scratch_y_end__", "__StackBottom", "__StackTop")
+    if (over > 0) {
+        print "\nScratch bank over budget: move functions from *_SCRATCH_FUNC to *_HOT_FUNC"
+        exit 2
+    }
+}
+function bank(name, start, end, stack_bottom, stack_top,    used, stack, budget) {
+    if (!(start in bound) || !(end in bound) || !(stack_bottom in bound) || !(stack_top in bound)) {
+        printf "  %-10s bounds not in symbol table\n", name
+        return 0
+    }
+    used = bound[end] - bound[start]
+    stack = bound[stack_top] - bound[stack_bottom]
+    budget = 4096 - stack
+    printf "  %-10s code/data %5d, stack %5d, budget %5d, free %5d\n", name, used, stack, budget, budget - used
+    return used > budget
+}'
@@ -0,0 +1,79 @@
+#ifndef ADDITIVE_H
+#define ADDITIVE_H
+
+#include "sound_explorer.h"
+
+// Size of the partial bank (harmonics 1 to ADDITIVE_MAX_PARTIALS)
+#ifndef ADDITIVE_MAX_PARTIALS
+#define ADDITIVE_MAX_PARTIALS 64
+#endif
+
+#define ADDITIVE_DEFAULT_PARTIALS 32    // Partials enabled at boot
+#define ADDITIVE_BLOCK_SIZE 8           // Samples rendered per partial pass
+#define ADDITIVE_SINE_BITS 10           // log2 of the sine table length
+
+// Harmonic amplitude presets
+typedef enum {
+    ADDITIVE_PRESET_SAWTOOTH = 0,       // All harmonics, 1/k
+    ADDITIVE_PRESET_SQUARE,             // Odd harmonics, 1/k
+    ADDITIVE_PRESET_TRIANGLE,           // Odd harmonics, alternating 1/k^2
+    ADDITIVE_PRESET_ORGAN,              // Drawbar-style 1, 2, 3, 4, 6, 8
+    ADDITIVE_PRESET_COUNT
+} additive_preset_t;
+
+/**
+ * Build the sine table and load the sawtooth preset
+ */
+void additive_init(void);
+
+/**
+ * Load a harmonic amplitude preset
+ * @param preset Preset to load
+ */
+void additive_load_preset(additive_preset_t preset);
+
+/**
+ * Set the amplitude of one harmonic
+ * @param harmonic Harmonic number (1 to ADDITIVE_MAX_PARTIALS)
+ * @param level Relative amplitude (-1.0 to 1.0, negative inverts the phase)
+ * @return true if the harmonic number was valid
+ */
+bool additive_set_partial(uint8_t harmonic, float level);
+
+/**
+ * Set how many harmonics are summed (partials above Nyquist are always skipped)
+ * @param count 1 to ADDITIVE_MAX_PARTIALS
+ * @return true if the count was valid
+ */
+bool additive_set_partial_count(uint8_t count);
+
+/**
+ * Get the next additive sample, rendering a new block of
+ * ADDITIVE_BLOCK_SIZE samples when the previous one is used up
+ * Called from the sample interrupt.
+ * @param phase_increment Fundamental phase increment for the next block
+ * @return Q15 sample
+ */
+int32_t additive_process(uint32_t phase_increment);
+
+/**
+ * Get preset name
+ * @param preset Harmonic preset
+ * @return String representation of the preset
+ */
+const char* additive_get_preset_name(additive_preset_t preset);
+
+/**
+ * Print partial count, Nyquist limit and the strongest harmonics
+ * @param system Pointer to the sound system state
+ */
+void additive_print_status(sound_system_t *system);
+
+/**
+ * Measure cost per sample for increasing partial counts, per-sample versus
+ * block rendering, and report how many partials fit in one sample period.
+ * Audio output pauses for the duration of the measurement.
+ */
+void additive_benchmark(void);
+
+#endif // ADDITIVE_H
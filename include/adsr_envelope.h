@@ -21,11 +21,27 @@ void adsr_note_on(sound_system_t *system);
 void adsr_note_off(sound_system_t *system);
 
 /**
- * Update ADSR envelope state and calculate current envelope level
+ * Open or close the envelope gate without logging (safe in the sample interrupt)
+ * Does not pluck a string; scheduled strings are plucked ahead with ks_pluck_at().
  * @param system Pointer to the sound system state
- * @param delta_time Time elapsed since last update (in seconds)
+ * @param on true starts the attack, false the release
  */
-void adsr_update(sound_system_t *system, float delta_time);
+void adsr_gate(sound_system_t *system, bool on);
+
+/**
+ * Recalculate per-sample curve coefficients if the ADSR parameters changed
+ * @param system Pointer to the sound system state
+ */
+void adsr_update(sound_system_t *system);
+
+/**
+ * Advance the envelope by one sample (one multiply-add per sample)
+ * Attack and release always start from the current level, so retriggers
+ * and early note-offs are continuous.
+ * @param system Pointer to the sound system state
+ * @return Envelope level after this sample (0.0-1.0)
+ */
+float adsr_process(sound_system_t *system);
 
 /**
  * Get current envelope multiplier
@@ -0,0 +1,158 @@
+#ifndef AUDIO_INPUT_H
+#define AUDIO_INPUT_H
+
+#include "sound_explorer.h"
+
+// ADC channel sampled at audio rate; its pot keeps the value read before the
+// input was switched on (default: ADC3/GPIO29, the decay pot)
+#ifndef AUDIO_INPUT_ADC_CHANNEL
+#define AUDIO_INPUT_ADC_CHANNEL 3
+#endif
+
+#define AUDIO_INPUT_CHANNELS 4          // ADC0-3 converted in turn, one frame per output sample
+#define AUDIO_INPUT_RING_BITS 12        // log2 of the DMA ring size in bytes (2048 conversions)
+#define AUDIO_INPUT_BLOCK_SIZE 8        // Input samples filtered per block
+#define AUDIO_INPUT_LEVEL_GAIN 2        // Follower makeup gain in level mode (full-scale sine ~ 1.0)
+
+#define AUDIO_INPUT_MIN_ENV_MS 0.1f     // Follower attack/release range
+#define AUDIO_INPUT_MAX_ENV_MS 2000.0f
+#define AUDIO_INPUT_MAX_GAIN 16         // Input preamp gain range 1-16x
+
+// What the input does to the voice
+typedef enum {
+    AUDIO_INPUT_MOD_OFF = 0,            // Voice unchanged
+    AUDIO_INPUT_MOD_RING,               // Voice x input
+    AUDIO_INPUT_MOD_AM,                 // Voice x (1 + input) / 2
+    AUDIO_INPUT_MOD_COUNT
+} audio_input_mod_t;
+
+// What the envelope follower drives
+typedef enum {
+    AUDIO_INPUT_FOLLOW_OFF = 0,         // Follower runs, nothing uses it
+    AUDIO_INPUT_FOLLOW_LEVEL,           // Input loudness scales the voice under the ADSR
+    AUDIO_INPUT_FOLLOW_TRIGGER,         // Crossing the threshold gates the ADSR on and off
+    AUDIO_INPUT_FOLLOW_COUNT
+} audio_input_follow_t;
+
+// Path counters (written by the sample interrupt)
+typedef struct {
+    uint32_t blocks;                    // Blocks processed
+    uint32_t slips;                     // Read position re-centred after ADC/PWM clock drift
+    uint32_t triggers;                  // Gate-on events in trigger mode
+    uint32_t distance_min;              // Frames between the DMA and the reader at block start
+    uint32_t distance_max;
+    uint64_t distance_total;
+} audio_input_stats_t;
+
+/**
+ * Claim the DMA channels; the input stays off until enabled
+ */
+void audio_input_init(void);
+
+/**
+ * Start or stop audio-rate sampling
+ * On, the ADC converts ADC0-3 round robin at AUDIO_INPUT_CHANNELS x the
+ * sample rate into a DMA ring; pot reads then come from the same stream.
+ * @param enabled true to sample the input
+ */
+void audio_input_set_enabled(bool enabled);
+
+/**
+ * Check if the input is being sampled
+ * @return true when enabled
+ */
+bool audio_input_is_enabled(void);
+
+/**
+ * Retime the ADC and recompute follower coefficients after a sample rate change
+ */
+void audio_input_refresh_rates(void);
+
+/**
+ * Read a potentiometer channel
+ * A blocking conversion when the input is off; otherwise the first
+ * conversion of that channel made after the call, taken from the DMA ring.
+ * @param channel ADC channel (0-3)
+ * @return Raw ADC reading (0-4095)
+ */
+uint16_t audio_input_read_adc(uint channel);
+
+/**
+ * Set what the envelope follower drives
+ * @param follow Follower mode
+ * @param threshold Gate-on level in trigger mode (0.0-1.0 of full scale); gate off at half
+ * @return true if the threshold was valid
+ */
+bool audio_input_set_follow(audio_input_follow_t follow, float threshold);
+
+/**
+ * Set the envelope follower times
+ * @param attack_ms Rise time constant (AUDIO_INPUT_MIN_ENV_MS-AUDIO_INPUT_MAX_ENV_MS)
+ * @param release_ms Fall time constant
+ * @return true if the times were valid
+ */
+bool audio_input_set_envelope(float attack_ms, float release_ms);
+
+/**
+ * Set the modulation of the voice by the input
+ * @param mod Modulation type
+ * @param depth Wet amount (0.0-1.0)
+ * @return true if the depth was valid
+ */
+bool audio_input_set_mod(audio_input_mod_t mod, float depth);
+
+/**
+ * Set the input gain
+ * @param gain 1 to AUDIO_INPUT_MAX_GAIN
+ * @return true if the gain was valid
+ */
+bool audio_input_set_gain(uint8_t gain);
+
+/**
+ * Advance the input by one sample, filtering a new block when the previous
+ * one is used up (called from the sample interrupt before rendering)
+ * @param system Pointer to the sound system state (gated in trigger mode)
+ */
+void audio_input_process(sound_system_t *system);
+
+/**
+ * Apply the modulation and follower level to a voice sample
+ * Called from the sample interrupt after audio_input_process().
+ * @param value Q15 voice sample
+ * @return Q15 sample
+ */
+int32_t audio_input_apply(int32_t value);
+
+/**
+ * Get path counters
+ * @param stats Destination for the counters
+ */
+void audio_input_get_stats(audio_input_stats_t *stats);
+
+/**
+ * Get modulation name
+ * @param mod Modulation type
+ * @return String representation of the modulation
+ */
+const char* audio_input_get_mod_name(audio_input_mod_t mod);
+
+/**
+ * Get follower mode name
+ * @param follow Follower mode
+ * @return String representation of the mode
+ */
+const char* audio_input_get_follow_name(audio_input_follow_t follow);
+
+/**
+ * Print settings, follower level, path latency and slips
+ */
+void audio_input_print_status(void);
+
+/**
+ * Measure cost per sample of the input path for each modulation type and
+ * report it against the sample period at 44.1 kHz.
+ * Audio output pauses for the duration of the measurement.
+ */
+void audio_input_benchmark(void);
+
+#endif // AUDIO_INPUT_H
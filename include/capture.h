@@ -0,0 +1,97 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "sound_explorer.h"
+
+// Capture ring size in samples, must be a power of two
+#ifndef CAPTURE_BUFFER_SIZE
+#define CAPTURE_BUFFER_SIZE 65536
+#endif
+
+#define CAPTURE_CHUNK_SIZE 256      // Most bytes queued for USB per service call
+#define CAPTURE_WAV_HEADER_SIZE 44  // RIFF/WAVE header for 8-bit mono PCM
+
+// What the sample interrupt does with each rendered sample
+typedef enum {
+    CAPTURE_OFF = 0,                // Not captured
+    CAPTURE_RING,                   // Overwrite the oldest sample (last N samples kept)
+    CAPTURE_STREAM                  // FIFO to the USB link, dropped when full
+} capture_mode_t;
+
+// Capture counters
+typedef struct {
+    uint32_t captured;              // Samples written to the ring
+    uint32_t dropped;               // Samples lost during the current/last transfer
+    uint32_t sent;                  // Sample bytes queued to USB by the current/last transfer
+} capture_stats_t;
+
+/**
+ * Clear the capture ring and counters
+ */
+void capture_init(void);
+
+/**
+ * Tee one rendered sample into the capture ring (called from the sample interrupt)
+ * @param sample PWM sample value (0-255, 128 = silence)
+ */
+void capture_tap(uint8_t sample);
+
+/**
+ * Enable or disable ring capture of the last CAPTURE_BUFFER_SIZE samples
+ * @param enabled true to capture continuously
+ */
+void capture_set_ring(bool enabled);
+
+/**
+ * Send the ring contents as a WAV file; the ring stops recording until the
+ * transfer completes
+ * @return true if the transfer was started
+ */
+bool capture_start_dump(void);
+
+/**
+ * Stream the live output as a WAV over USB
+ * @param seconds Stream length, 0 streams until capture_stop()
+ * @return true if the transfer was started
+ */
+bool capture_start_stream(float seconds);
+
+/**
+ * Stop the current transfer and return to the previous capture mode
+ */
+void capture_stop(void);
+
+/**
+ * Queue pending WAV data to the USB CDC link without blocking
+ * Call from the main loop.
+ */
+void capture_service(void);
+
+/**
+ * Copy the most recently captured samples, oldest first
+ * The sample interrupt keeps writing during the copy, so at most half the
+ * ring can be copied without the oldest samples being overwritten.
+ * @param dest Destination buffer
+ * @param count Samples wanted (at most CAPTURE_BUFFER_SIZE / 2)
+ * @return Samples copied (fewer if fewer have been captured)
+ */
+uint32_t capture_copy_recent(uint8_t *dest, uint32_t count);
+
+/**
+ * Check if a WAV transfer is using the serial link
+ * @return true while a dump or stream is in progress
+ */
+bool capture_is_transferring(void);
+
+/**
+ * Get capture counters
+ * @param stats Destination for the counters
+ */
+void capture_get_stats(capture_stats_t *stats);
+
+/**
+ * Print capture mode, ring size and counters
+ */
+void capture_print_status(void);
+
+#endif // CAPTURE_H
@@ -0,0 +1,99 @@
+#ifndef DRUMS_H
+#define DRUMS_H
+
+#include "sound_explorer.h"
+
+// Default voice settings (tune in Hz, decay to -60 dB in ms)
+#ifndef DRUM_KICK_TUNE
+#define DRUM_KICK_TUNE 50.0f        // Pitch at the end of the sweep
+#endif
+#ifndef DRUM_KICK_DECAY_MS
+#define DRUM_KICK_DECAY_MS 400.0f
+#endif
+#ifndef DRUM_SNARE_TUNE
+#define DRUM_SNARE_TUNE 180.0f      // Body tone
+#endif
+#ifndef DRUM_SNARE_DECAY_MS
+#define DRUM_SNARE_DECAY_MS 200.0f  // Noise; the tone decays twice as fast
+#endif
+#ifndef DRUM_HAT_TUNE
+#define DRUM_HAT_TUNE 7000.0f       // High-pass cutoff
+#endif
+#ifndef DRUM_HAT_DECAY_MS
+#define DRUM_HAT_DECAY_MS 60.0f
+#endif
+
+#define DRUM_KICK_SWEEP 6.0f        // Kick starts this many times above its tune
+#define DRUM_KICK_SWEEP_MS 40.0f    // Pitch sweep decay to -60 dB
+#define DRUM_MIN_DECAY_MS 5.0f      // Shortest decay
+#define DRUM_MAX_DECAY_MS 2000.0f   // Longest decay
+
+// Drum voices
+typedef enum {
+    DRUM_KICK = 0,                  // Pitch-swept sine
+    DRUM_SNARE,                     // Sine body plus noise
+    DRUM_HAT,                       // High-passed noise
+    DRUM_VOICE_COUNT
+} drum_voice_t;
+
+/**
+ * Load the default voice settings and silence all voices
+ */
+void drums_init(void);
+
+/**
+ * Recompute envelope and pitch coefficients after a sample rate change
+ */
+void drums_refresh_rates(void);
+
+/**
+ * Set a voice's sound
+ * @param voice Drum voice
+ * @param tune Kick end pitch, snare tone or hat cutoff in Hz
+ * @param decay_ms Decay to -60 dB in ms (DRUM_MIN_DECAY_MS-DRUM_MAX_DECAY_MS)
+ * @param level Voice level (0.0-1.0)
+ * @return true if the settings were valid
+ */
+bool drums_set_voice(drum_voice_t voice, float tune, float decay_ms, float level);
+
+/**
+ * Start a hit, restarting the voice if it is still sounding
+ * Safe to call from the sample interrupt.
+ * @param voice Drum voice
+ * @param velocity Hit strength, Q15 (0-32768)
+ */
+void drums_trigger(drum_voice_t voice, int32_t velocity);
+
+/**
+ * Render one sample of all sounding voices (called from the sample interrupt)
+ * @return Drum mix as a bipolar Q15 sample
+ */
+int32_t drums_process(void);
+
+/**
+ * Check if any voice is sounding
+ * @return true while a hit is decaying
+ */
+bool drums_active(void);
+
+/**
+ * Get drum voice name
+ * @param voice Drum voice
+ * @return String representation of the voice
+ */
+const char* drums_get_voice_name(drum_voice_t voice);
+
+/**
+ * Print voice settings
+ */
+void drums_print_status(void);
+
+/**
+ * Measure the cost of each voice per sample and per hit, and of all
+ * voices together with the oscillator, against the sample period
+ * Audio output pauses for the duration of the measurement.
+ * @param system Pointer to the sound system state
+ */
+void drums_benchmark(sound_system_t *system);
+
+#endif // DRUMS_H
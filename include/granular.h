@@ -0,0 +1,124 @@
+#ifndef GRANULAR_H
+#define GRANULAR_H
+
+#include "sound_explorer.h"
+
+// Size of the grain pool (grains sounding at once)
+#ifndef GRANULAR_MAX_GRAINS
+#define GRANULAR_MAX_GRAINS 64
+#endif
+
+// Flash sample image location, written separately from the program, e.g.
+// picotool load -o 0x10100000 sample.bin
+#ifndef GRANULAR_FLASH_OFFSET
+#define GRANULAR_FLASH_OFFSET (1024 * 1024)
+#endif
+
+#define GRANULAR_CAPTURE_BITS 15            // log2 of the capture snapshot length (0.74 s at 44.1 kHz)
+#define GRANULAR_MIN_SOURCE_BITS 8          // Shortest flash sample (256 samples)
+#define GRANULAR_MAX_SOURCE_BITS 20         // Longest flash sample (1M samples)
+#define GRANULAR_WINDOW_BITS 9              // log2 of the window table length
+#define GRANULAR_BLOCK_SIZE 8               // Samples rendered per grain pass
+#define GRANULAR_ROOT_FREQUENCY 261.6256f   // Oscillator pitch that plays the source unshifted (C4)
+#define GRANULAR_IMAGE_MAGIC 0x314E5247u    // "GRN1"
+
+#define GRANULAR_MIN_DENSITY 1.0f           // Grains per second
+#define GRANULAR_MAX_DENSITY 4000.0f
+#define GRANULAR_MIN_SIZE_MS 2.0f           // Grain length
+#define GRANULAR_MAX_SIZE_MS 500.0f
+
+// Where grains read from
+typedef enum {
+    GRANULAR_SOURCE_NONE = 0,               // Nothing loaded, the voice is silent
+    GRANULAR_SOURCE_CAPTURE,                // Snapshot of the capture ring
+    GRANULAR_SOURCE_FLASH,                  // Sample image at GRANULAR_FLASH_OFFSET
+    GRANULAR_SOURCE_COUNT
+} granular_source_t;
+
+// Flash sample image header, followed by length signed 8-bit samples
+typedef struct {
+    uint32_t magic;                         // GRANULAR_IMAGE_MAGIC
+    uint32_t sample_rate;                   // Recording rate in Hz
+    uint32_t length_bits;                   // log2 of the sample count
+    uint32_t reserved;
+} granular_image_header_t;
+
+// Scheduler counters (written by the sample interrupt)
+typedef struct {
+    uint32_t spawned;                       // Grains started
+    uint32_t skipped;                       // Grains not started because the pool was full
+    uint8_t active;                         // Grains sounding now
+    uint8_t peak;                           // Most grains sounding at once
+} granular_stats_t;
+
+/**
+ * Build the window table and load the default scheduler settings (no source)
+ */
+void granular_init(void);
+
+/**
+ * Recompute grain length and spawn interval after a sample rate change
+ */
+void granular_refresh_rates(void);
+
+/**
+ * Select the grain source
+ * GRANULAR_SOURCE_CAPTURE copies the most recent 2^GRANULAR_CAPTURE_BITS
+ * samples out of the capture ring (the rest is silence if fewer were
+ * captured); GRANULAR_SOURCE_FLASH checks the image header in flash.
+ * @param source Grain source
+ * @return false if nothing has been captured or there is no valid flash image
+ */
+bool granular_load_source(granular_source_t source);
+
+/**
+ * Set the grain scheduler
+ * @param density Grains started per second (GRANULAR_MIN_DENSITY-GRANULAR_MAX_DENSITY)
+ * @param size_ms Grain length (GRANULAR_MIN_SIZE_MS-GRANULAR_MAX_SIZE_MS)
+ * @param spray Random start offset as a fraction of the source (0.0-1.0)
+ * @param jitter Random spawn interval variation (0.0 = synchronous, 1.0 = +/-100%)
+ * @return true if the settings were valid
+ */
+bool granular_set_scheduler(float density, float size_ms, float spray, float jitter);
+
+/**
+ * Set where in the source grains start
+ * @param position Fraction of the source (0.0 = oldest, 1.0 = newest)
+ */
+void granular_set_position(float position);
+
+/**
+ * Get the next granular sample, spawning grains and rendering a new block
+ * of GRANULAR_BLOCK_SIZE samples when the previous one is used up
+ * Called from the sample interrupt.
+ * @param phase_increment Oscillator phase increment; sets the pitch of new grains
+ * @return Q15 sample
+ */
+int32_t granular_process(uint32_t phase_increment);
+
+/**
+ * Get scheduler counters
+ * @param stats Destination for the counters
+ */
+void granular_get_stats(granular_stats_t *stats);
+
+/**
+ * Get source name
+ * @param source Grain source
+ * @return String representation of the source
+ */
+const char* granular_get_source_name(granular_source_t source);
+
+/**
+ * Print source, scheduler settings and grain counters
+ */
+void granular_print_status(void);
+
+/**
+ * Measure cost per sample for increasing grain counts from the current
+ * source and report how many concurrent grains fit at 44.1 kHz.
+ * Audio output pauses for the duration of the measurement.
+ */
+void granular_benchmark(void);
+
+#endif // GRANULAR_H
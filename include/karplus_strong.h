@@ -0,0 +1,76 @@
+#ifndef KARPLUS_STRONG_H
+#define KARPLUS_STRONG_H
+
+#include "sound_explorer.h"
+#include "timebase.h"
+
+#define KS_MAX_STRINGS 4            // Strings that can ring at the same time
+#define KS_POOL_LINES KS_MAX_STRINGS // Delay lines in the pool (one per string)
+
+// Longest delay line: one period of MIN_FREQUENCY at the highest sample rate
+#define KS_DELAY_MAX_LENGTH (TIMEBASE_MAX_SAMPLE_RATE / MIN_FREQUENCY + 1)
+
+#define KS_DEFAULT_DECAY 2.0f       // Default time for the fundamental to fall 60 dB (s)
+#define KS_DEFAULT_BRIGHTNESS 0.3f  // Default loop filter brightness (0 = classic KS)
+
+/**
+ * Return all delay lines to the pool and apply the default string settings
+ */
+void ks_init(void);
+
+/**
+ * Pluck a new string: take a delay line from the pool (stealing the oldest
+ * string if the pool is empty), tune it and fill it with noise
+ * @param frequency String frequency in Hz
+ * @return true if the frequency fits the delay line limits
+ */
+bool ks_pluck(float frequency);
+
+/**
+ * Pluck a new string that starts sounding on a given sample
+ * The string is tuned and filled now, so a scheduled note starts on its exact sample.
+ * @param frequency String frequency in Hz
+ * @param start_sample Sample count (timebase_get_sample_count()) of the first sample
+ * @return true if the frequency fits the delay line limits
+ */
+bool ks_pluck_at(float frequency, uint32_t start_sample);
+
+/**
+ * Silence every string and return their delay lines to the pool
+ */
+void ks_reset(void);
+
+/**
+ * Set the damping used for strings plucked from now on
+ * @param decay_time Time for the fundamental to fall 60 dB in seconds
+ * @param brightness Loop filter brightness (0.0 = classic KS averaging, 1.0 = no high-frequency loss)
+ * @return true if the settings were in range
+ */
+bool ks_set_damping(float decay_time, float brightness);
+
+/**
+ * Advance all active strings by one sample (integer only)
+ * Called from the sample interrupt.
+ * @return Sum of the strings as a Q15 sample
+ */
+int32_t ks_process(void);
+
+/**
+ * Get the number of strings currently ringing
+ * @return Active string count
+ */
+uint8_t ks_get_active_strings(void);
+
+/**
+ * Print string settings and pool usage
+ */
+void ks_print_status(void);
+
+/**
+ * Measure the per-sample cost of 0 to KS_MAX_STRINGS strings and report
+ * how many fit in a 44.1 kHz sample period. Ringing strings are silenced
+ * and audio output pauses during the measurement.
+ */
+void ks_benchmark(void);
+
+#endif // KARPLUS_STRONG_H
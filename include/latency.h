@@ -0,0 +1,78 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "sound_explorer.h"
+
+// Envelope level that counts as "sound has started"
+#ifndef LATENCY_ENVELOPE_THRESHOLD
+#define LATENCY_ENVELOPE_THRESHOLD 0.01f
+#endif
+
+#define LATENCY_MAX_TRIALS 64       // Trials kept per input source (oldest replaced)
+#define LATENCY_EDGE_MAX_AGE_US 500000  // Older button edges are not matched to a note
+#define LATENCY_EDGE_STABLE_US 20000    // Button must be released this long before a press edge
+
+// Inputs that can start a note
+typedef enum {
+    LATENCY_SRC_BUTTON = 0,         // Output toggle button (GPIO edge)
+    LATENCY_SRC_SERIAL,             // Serial 'note on' / 'pluck' command
+    LATENCY_SRC_INPUT,              // Audio input envelope crossing the trigger threshold
+    LATENCY_SRC_COUNT
+} latency_source_t;
+
+/**
+ * Timestamp output button edges with a GPIO interrupt and clear all trials
+ */
+void latency_init(void);
+
+/**
+ * Start a trial when a note-on is handled (skipped while the previous note
+ * is still above the threshold)
+ * @param source Input that triggered the note
+ * @param input_time_us time_us_32() when the input arrived; ignored for the
+ *        button, which uses the edge recorded by the GPIO interrupt
+ */
+void latency_arm(latency_source_t source, uint32_t input_time_us);
+
+/**
+ * Start an audio input trial (called from the sample interrupt when the
+ * envelope follower gates a note on; skipped while a note is still sounding)
+ * @param input_time_us time_us_32() when the sample that crossed the threshold was converted
+ */
+void latency_arm_input(uint32_t input_time_us);
+
+/**
+ * Forget a recorded button edge that did not start a note (output switched off)
+ */
+void latency_discard_edge(void);
+
+/**
+ * Check the envelope of the sample just rendered (called from the sample interrupt)
+ * @param envelope Envelope level of the sample (0.0-1.0)
+ */
+void latency_tap(float envelope);
+
+/**
+ * Move a completed trial from the sample interrupt into the statistics
+ * Call from the main loop.
+ */
+void latency_service(void);
+
+/**
+ * Clear all recorded trials
+ */
+void latency_reset(void);
+
+/**
+ * Get input source name
+ * @param source Input source
+ * @return String representation of the source
+ */
+const char* latency_get_source_name(latency_source_t source);
+
+/**
+ * Print latency percentiles per input source
+ */
+void latency_print_report(void);
+
+#endif // LATENCY_H
@@ -0,0 +1,150 @@
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include "sound_explorer.h"
+
+#define MOD_LFO_COUNT 3         // Number of free-running LFOs
+#define MOD_MAX_ROUTES 8        // Slots in the modulation matrix
+#define MOD_LFO_MIN_RATE 0.01f  // Slowest LFO rate in Hz
+#define MOD_LFO_MAX_RATE 1000.0f // Fastest LFO rate in Hz (audio-rate FM/PWM)
+
+// LFO shapes
+typedef enum {
+    LFO_SHAPE_SINE = 0,
+    LFO_SHAPE_TRIANGLE,
+    LFO_SHAPE_SAWTOOTH,
+    LFO_SHAPE_SQUARE,
+    LFO_SHAPE_RANDOM,           // Sample and hold, new value every cycle
+    LFO_SHAPE_COUNT
+} lfo_shape_t;
+
+// Modulation sources
+typedef enum {
+    MOD_SRC_LFO1 = 0,
+    MOD_SRC_LFO2,
+    MOD_SRC_LFO3,
+    MOD_SRC_COUNT
+} mod_source_t;
+
+// Modulation destinations
+typedef enum {
+    MOD_DEST_PITCH = 0,         // phase_increment, full depth = +/-1 octave
+    MOD_DEST_DUTY,              // Square wave duty threshold, full depth = +/-50%
+    MOD_DEST_AMPLITUDE,         // Envelope depth (tremolo), full depth = 0-100%
+    MOD_DEST_CUTOFF,            // Low-pass filter coefficient
+    MOD_DEST_MORPH,             // Morph oscillator shape, full depth = +/-1.5 shapes
+    MOD_DEST_COUNT
+} mod_destination_t;
+
+// Where a route is evaluated
+typedef enum {
+    MOD_RATE_CONTROL = 0,       // Once per control block in the main loop
+    MOD_RATE_AUDIO              // Every sample in the PWM interrupt
+} mod_rate_t;
+
+// One slot of the modulation matrix
+typedef struct {
+    bool active;
+    uint8_t source;             // mod_source_t
+    uint8_t destination;        // mod_destination_t
+    uint8_t rate;               // mod_rate_t
+    int16_t depth;              // Q15, -32767 to 32767
+} mod_route_t;
+
+// Modulated parameters consumed by the sample generator
+typedef struct {
+    uint32_t phase_increment;   // Pitch after modulation
+    uint32_t phase_fraction;    // Fractional increment, 1/2^32 (64-bit phase mode)
+    uint16_t duty_threshold;    // Square wave threshold (0-65535)
+    int32_t gain;               // Amplitude multiplier, Q15 (0-32768)
+    int32_t cutoff;             // One-pole filter coefficient, Q15 (32768 = bypass)
+    int32_t morph;              // Morph position, Q15 per shape (0 = square, 3 << 15 = sine)
+} mod_output_t;
+
+/**
+ * Initialize LFOs and clear the modulation matrix
+ */
+void modulation_init(void);
+
+/**
+ * Configure an LFO
+ * @param lfo LFO index (0 to MOD_LFO_COUNT-1)
+ * @param shape LFO waveform
+ * @param rate_hz LFO rate in Hz (clamped to MOD_LFO_MIN_RATE-MOD_LFO_MAX_RATE)
+ * @return true if the LFO index was valid
+ */
+bool modulation_set_lfo(uint8_t lfo, lfo_shape_t shape, float rate_hz);
+
+/**
+ * Recompute LFO increments after a sample rate change
+ */
+void modulation_refresh_rates(void);
+
+/**
+ * Set a modulation matrix slot
+ * @param slot Route slot (0 to MOD_MAX_ROUTES-1)
+ * @param source Modulation source
+ * @param destination Modulation destination
+ * @param depth Modulation depth (-1.0 to 1.0)
+ * @param rate Evaluate at control rate or audio rate
+ * @return true if the route was stored
+ */
+bool modulation_set_route(uint8_t slot, mod_source_t source, mod_destination_t destination,
+                          float depth, mod_rate_t rate);
+
+/**
+ * Disable a modulation matrix slot
+ * @param slot Route slot (0 to MOD_MAX_ROUTES-1)
+ * @return true if the slot was valid
+ */
+bool modulation_clear_route(uint8_t slot);
+
+/**
+ * Evaluate control-rate routes against the current base parameters
+ * Call once per control block from the main loop.
+ * @param system Pointer to the sound system state
+ */
+void modulation_update_control(sound_system_t *system);
+
+/**
+ * Retune the unmodulated pitch immediately (called from the sample interrupt)
+ * Control-rate route sums are kept until the next control block.
+ * @param phase_increment New base phase increment
+ * @param fraction Fractional part of the increment, 1/2^32
+ */
+void modulation_set_base_increment(uint32_t phase_increment, uint32_t fraction);
+
+/**
+ * Advance the LFOs by one sample and evaluate audio-rate routes
+ * Called from the sample interrupt.
+ * @return Modulated parameters for this sample
+ */
+const mod_output_t* modulation_process_sample(void);
+
+/**
+ * Get LFO shape name
+ * @param shape LFO shape
+ * @return String representation of the shape
+ */
+const char* modulation_get_shape_name(lfo_shape_t shape);
+
+/**
+ * Get modulation destination name
+ * @param destination Modulation destination
+ * @return String representation of the destination
+ */
+const char* modulation_get_destination_name(mod_destination_t destination);
+
+/**
+ * Print LFO settings and active routes
+ */
+void modulation_print_status(void);
+
+/**
+ * Measure per-sample and per-block cost for 0 to MOD_MAX_ROUTES active routes
+ * Audio output pauses for the duration of the measurement.
+ * @param system Pointer to the sound system state
+ */
+void modulation_benchmark(sound_system_t *system);
+
+#endif // MODULATION_H
@@ -0,0 +1,53 @@
+#ifndef OVERSAMPLING_H
+#define OVERSAMPLING_H
+
+#include "sound_explorer.h"
+
+#define OVERSAMPLE_MAX_FACTOR 4     // Highest supported oversampling factor
+#define HALFBAND_TAPS 47            // Half-band FIR length (4n - 1)
+
+/**
+ * Design the half-band filters and apply the build-time OVERSAMPLE_FACTOR
+ */
+void oversampling_init(void);
+
+/**
+ * Select the internal oversampling factor
+ * @param factor 1 (off), 2 or 4
+ * @return true if the factor is supported
+ */
+bool oversampling_set_factor(uint8_t factor);
+
+/**
+ * Get the current oversampling factor
+ * @return 1, 2 or 4
+ */
+uint8_t oversampling_get_factor(void);
+
+/**
+ * Decimate one output sample's worth of oversampled input
+ * Runs one (2x) or two cascaded (4x) polyphase half-band stages.
+ * @param input oversampling_get_factor() Q15 samples, oldest first
+ * @return Q15 sample at the output rate
+ */
+int32_t oversampling_decimate(const int32_t *input);
+
+/**
+ * Measure alias rejection by sweeping test tones through the fixed-point
+ * decimator at the current sample rate
+ * Only tones whose alias lands at or below the passband edge count.
+ * @param factor 2 or 4
+ * @param passband Passband edge at the output rate (Hz)
+ * @param worst_frequency Set to the input tone with the strongest alias (may be NULL)
+ * @return Strongest alias relative to the input tone, in dB
+ */
+float oversampling_measure_alias_rejection(uint8_t factor, float passband, float *worst_frequency);
+
+/**
+ * Measure render cost per output sample at 1x, 2x and 4x and the
+ * decimator's measured alias rejection. Audio output pauses during the measurement.
+ * @param system Pointer to the sound system state
+ */
+void oversampling_benchmark(sound_system_t *system);
+
+#endif // OVERSAMPLING_H
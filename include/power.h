@@ -0,0 +1,87 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include "sound_explorer.h"
+#include "timebase.h"
+
+#define POWER_IDLE_DELAY_MS 2000    // Silence before entering deep idle
+
+// clk_sys while in deep idle (must be a clock set_sys_clock_khz can reach)
+#ifndef POWER_IDLE_CLOCK_KHZ
+#define POWER_IDLE_CLOCK_KHZ TIMEBASE_MIN_SYS_CLOCK_KHZ
+#endif
+
+// Current model for the estimates in the report (no current sense on the
+// board); calibrate against a meter in series with VSYS
+#ifndef POWER_STATIC_MA
+#define POWER_STATIC_MA 2.0f        // Regulator, XOSC, PLLs, USB
+#endif
+#ifndef POWER_MA_PER_MHZ
+#define POWER_MA_PER_MHZ 0.12f      // Core 0 running, per MHz of clk_sys
+#endif
+#ifndef POWER_WFI_SHARE
+#define POWER_WFI_SHARE 0.3f        // Share of the per-MHz current left while the core sleeps
+#endif
+
+// Events that end deep idle
+typedef enum {
+    POWER_WAKE_BUTTON = 0,          // Any front panel button
+    POWER_WAKE_SERIAL,              // Characters received
+    POWER_WAKE_SOURCE_COUNT
+} power_wake_source_t;
+
+// Residency and wake-up counters
+typedef struct {
+    uint64_t idle_us;               // Time in deep idle
+    uint64_t idle_awake_us;         // Part of idle_us with core 0 out of WFI
+    uint64_t elapsed_us;            // Time since the counters were reset
+    uint32_t entries;               // Times deep idle was entered
+    uint32_t wakes[POWER_WAKE_SOURCE_COUNT];
+    uint32_t wake_last_us;          // Wake event to sample interrupt running
+    uint32_t wake_max_us;
+    uint64_t wake_total_us;
+} power_stats_t;
+
+/**
+ * Register the serial wake-up callback and clear the counters
+ */
+void power_init(void);
+
+/**
+ * Enable or disable deep idle
+ * @param enabled true to enter deep idle after POWER_IDLE_DELAY_MS of silence
+ */
+void power_set_enabled(bool enabled);
+
+/**
+ * Check if deep idle is enabled
+ * @return true when enabled
+ */
+bool power_is_enabled(void);
+
+/**
+ * Enter deep idle once the system has been silent for POWER_IDLE_DELAY_MS
+ * Stops the sample interrupt, drops clk_sys to POWER_IDLE_CLOCK_KHZ and
+ * sleeps core 0 until a button or serial event, then restores the clock and
+ * the sample interrupt before returning. Call from the main loop.
+ * @param system Pointer to the sound system state
+ */
+void power_service(sound_system_t *system);
+
+/**
+ * Get residency and wake-up counters
+ * @param stats Destination for the counters
+ */
+void power_get_stats(power_stats_t *stats);
+
+/**
+ * Clear residency and wake-up counters
+ */
+void power_reset_stats(void);
+
+/**
+ * Print residency, wake-up latency and estimated active/idle current
+ */
+void power_print_status(void);
+
+#endif // POWER_H
@@ -0,0 +1,180 @@
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include "sound_explorer.h"
+
+#define SEQ_MAX_STEPS 16            // Steps in a pattern
+#define SEQ_QUEUE_SIZE 32           // Pending events (note on/off, frequency, waveform, drums)
+#define SEQ_STEPS_PER_BEAT 4        // Sixteenth notes
+#define SEQ_MIN_TEMPO 20            // BPM
+#define SEQ_MAX_TEMPO 300           // BPM (steps 50 ms apart)
+#define SEQ_DEFAULT_TEMPO 120       // BPM
+#define SEQ_LOOKAHEAD_MS 20         // Steps are queued this far ahead of their sample
+#define SEQ_REST 127                // Step note value for a rest
+#define SEQ_NOTE_RANGE 36           // Step notes are -36 to +36 semitones from the root
+#define SEQ_ARP_MAX_NOTES 8         // Notes held by the arpeggiator
+#define SEQ_ARP_MAX_OCTAVES 3       // Octaves the arpeggiator spans
+#define SEQ_ARP_GATE 50             // Arpeggiator gate length, % of a step
+
+// Events applied by the sample interrupt
+typedef enum {
+    SEQ_EVENT_NOTE_ON = 0,          // Start the envelope attack
+    SEQ_EVENT_NOTE_OFF,             // Start the envelope release
+    SEQ_EVENT_FREQUENCY,            // Retune the oscillator
+    SEQ_EVENT_WAVEFORM,             // Crossfade to another waveform
+    SEQ_EVENT_DRUM                  // Trigger drum voices
+} seq_event_type_t;
+
+typedef struct {
+    uint32_t time;                  // Sample count at which the event is applied
+    uint32_t order;                 // Queue order, breaks ties on the same sample
+    uint8_t type;                   // seq_event_type_t
+    uint8_t waveform;               // SEQ_EVENT_WAVEFORM
+    uint8_t drums;                  // SEQ_EVENT_DRUM, bit per drum_voice_t
+    uint32_t phase_increment;       // SEQ_EVENT_FREQUENCY
+    uint32_t phase_fraction;        // SEQ_EVENT_FREQUENCY, fractional increment
+    float frequency;                // SEQ_EVENT_FREQUENCY
+} seq_event_t;
+
+// One pattern step
+typedef struct {
+    int8_t note;                    // Semitones from the root, or SEQ_REST
+    uint8_t gate;                   // Note length, % of a step (1-100)
+    int8_t waveform;                // Waveform to switch to, -1 keeps the current one
+    uint8_t drums;                  // Drum voices hit on this step, bit per drum_voice_t
+} seq_step_t;
+
+// Arpeggiator modes
+typedef enum {
+    ARP_OFF = 0,                    // Play the step pattern
+    ARP_UP,
+    ARP_DOWN,
+    ARP_UPDOWN,
+    ARP_RANDOM,
+    ARP_MODE_COUNT
+} arp_mode_t;
+
+// Event timing counters
+typedef struct {
+    uint32_t events;                // Events applied
+    uint32_t late;                  // Events applied after their sample
+    uint32_t max_late;              // Worst lateness in samples (timing jitter)
+    uint32_t dropped;               // Events lost to a full queue
+} seq_stats_t;
+
+/**
+ * Load the default pattern and clear the event queue
+ */
+void sequencer_init(void);
+
+/**
+ * Start the sequencer SEQ_LOOKAHEAD_MS from now, rooted at the current frequency
+ * @param system Pointer to the sound system state
+ */
+void sequencer_start(sound_system_t *system);
+
+/**
+ * Stop the sequencer, drop pending events and release the note
+ * @param system Pointer to the sound system state
+ */
+void sequencer_stop(sound_system_t *system);
+
+/**
+ * Check if the sequencer is running
+ * @return true while running
+ */
+bool sequencer_is_running(void);
+
+/**
+ * Set the tempo
+ * @param bpm Beats per minute (SEQ_MIN_TEMPO-SEQ_MAX_TEMPO), four steps per beat
+ * @return true if the tempo was in range
+ */
+bool sequencer_set_tempo(float bpm);
+
+/**
+ * Set the pattern length
+ * @param length Number of steps (1-SEQ_MAX_STEPS)
+ * @return true if the length was in range
+ */
+bool sequencer_set_length(uint8_t length);
+
+/**
+ * Edit a pattern step
+ * @param index Step index (0 to SEQ_MAX_STEPS-1)
+ * @param note Semitones from the root (+/-SEQ_NOTE_RANGE), or SEQ_REST; scale
+ *             steps from the root when the tuning is quantized
+ * @param gate Note length, % of a step (1-100)
+ * @param waveform Waveform to switch to at this step, -1 to keep the current one
+ * @return true if the step was stored
+ */
+bool sequencer_set_step(uint8_t index, int note, int gate, int waveform);
+
+/**
+ * Set the drum voices hit on a step
+ * Drums play on rests and while the arpeggiator is on.
+ * @param index Step index (0 to SEQ_MAX_STEPS-1)
+ * @param drums Bit per drum_voice_t, 0 for none
+ * @return true if the step was stored
+ */
+bool sequencer_set_drums(uint8_t index, uint8_t drums);
+
+/**
+ * Turn every step into a rest without drums
+ */
+void sequencer_clear(void);
+
+/**
+ * Set the frequency that step and arpeggiator notes are relative to
+ * @param frequency Root frequency in Hz
+ */
+void sequencer_set_root(float frequency);
+
+/**
+ * Configure the arpeggiator
+ * @param mode Arpeggiator mode, ARP_OFF plays the step pattern
+ * @param octaves Octaves spanned (1-SEQ_ARP_MAX_OCTAVES)
+ * @return true if the settings were valid
+ */
+bool sequencer_set_arp(arp_mode_t mode, uint8_t octaves);
+
+/**
+ * Set the notes held by the arpeggiator (sorted low to high)
+ * @param notes Semitones from the root
+ * @param count Number of notes (1-SEQ_ARP_MAX_NOTES)
+ * @return true if the notes were stored
+ */
+bool sequencer_set_arp_notes(const int8_t *notes, uint8_t count);
+
+/**
+ * Get arpeggiator mode name
+ * @param mode Arpeggiator mode
+ * @return String representation of the mode
+ */
+const char* sequencer_get_arp_mode_name(arp_mode_t mode);
+
+/**
+ * Queue the events of steps that start within SEQ_LOOKAHEAD_MS
+ * Call from the main loop.
+ * @param system Pointer to the sound system state
+ */
+void sequencer_service(sound_system_t *system);
+
+/**
+ * Apply queued events that are due on this sample (called from the sample interrupt)
+ * @param system Pointer to the sound system state
+ */
+void sequencer_process(sound_system_t *system);
+
+/**
+ * Get event timing counters
+ * @param stats Destination for the counters
+ */
+void sequencer_get_stats(seq_stats_t *stats);
+
+/**
+ * Print tempo, pattern, arpeggiator settings and timing counters
+ */
+void sequencer_print_status(void);
+
+#endif // SEQUENCER_H
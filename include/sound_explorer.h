@@ -25,6 +25,7 @@
 
 #define WAVEFORM_BUTTON_PIN 2   // Button for waveform selection
 #define OUTPUT_TOGGLE_PIN 3     // Button for output on/off
+#define DRUM_BUTTON_PIN 8       // Drum pad button (optional)
 
 #define LED_SQUARE_PIN 4        // LED indicator for square wave
 #define LED_TRIANGLE_PIN 5      // LED indicator for triangle wave
@@ -32,21 +33,72 @@
 #define LED_SINE_PIN 7          // LED indicator for sine wave
 
 // System constants
-#define SAMPLE_RATE 44100       // Audio sample rate
-#define PWM_WRAP 255            // PWM counter wrap value (8-bit resolution)
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE 44100       // Default audio sample rate (PWM wrap derived from clk_sys)
+#endif
 #define MIN_FREQUENCY 20        // Minimum frequency in Hz
 #define MAX_FREQUENCY 20000     // Maximum frequency in Hz
 #define ADC_MAX_VALUE 4095      // 12-bit ADC maximum value
 
+// Internal oscillator oversampling (1, 2 or 4); can be changed at run time
+#ifndef OVERSAMPLE_FACTOR
+#define OVERSAMPLE_FACTOR 1
+#endif
+
+// Audio hot path placement (set with the AUDIO_HOT_PATH CMake option)
+#define AUDIO_HOT_PATH_FLASH 0      // Execute from XIP flash (cache misses cause ISR jitter)
+#define AUDIO_HOT_PATH_SRAM 1       // Copy to main SRAM (.time_critical)
+#define AUDIO_HOT_PATH_SCRATCH 2    // Copy to the scratch bank of the core that runs it
+
+#ifndef AUDIO_HOT_PATH_PLACEMENT
+#define AUDIO_HOT_PATH_PLACEMENT AUDIO_HOT_PATH_FLASH
+#endif
+
+// The sample interrupt is registered on core 0, the spectrum analyzer runs on
+// core 1. A scratch bank is only 4 KB and also holds the stack of the core
+// that uses it (Y for core 0, X for core 1), so SCRATCH mode only puts the
+// interrupt entry and the innermost kernels there (*_SCRATCH_FUNC); the rest
+// of the hot path goes to .time_critical as in SRAM mode. The linker checks
+// the banks still leave room for the stacks (hot_path_budget.ld).
+#if AUDIO_HOT_PATH_PLACEMENT == AUDIO_HOT_PATH_SCRATCH
+#define AUDIO_HOT_FUNC(func_name) __not_in_flash_func(func_name)
+#define AUDIO_HOT_DATA(data_name) __not_in_flash(#data_name) data_name
+#define AUDIO_SCRATCH_FUNC(func_name) __scratch_y(#func_name) func_name
+#define AUDIO_SCRATCH_DATA(data_name) __scratch_y(#data_name) data_name
+#define CORE1_HOT_FUNC(func_name) __not_in_flash_func(func_name)
+#define CORE1_SCRATCH_FUNC(func_name) __scratch_x(#func_name) func_name
+#elif AUDIO_HOT_PATH_PLACEMENT == AUDIO_HOT_PATH_SRAM
+#define AUDIO_HOT_FUNC(func_name) __not_in_flash_func(func_name)
+#define AUDIO_HOT_DATA(data_name) __not_in_flash(#data_name) data_name
+#define AUDIO_SCRATCH_FUNC(func_name) __not_in_flash_func(func_name)
+#define AUDIO_SCRATCH_DATA(data_name) __not_in_flash(#data_name) data_name
+#define CORE1_HOT_FUNC(func_name) __not_in_flash_func(func_name)
+#define CORE1_SCRATCH_FUNC(func_name) __not_in_flash_func(func_name)
+#else
+#define AUDIO_HOT_FUNC(func_name) func_name
+#define AUDIO_HOT_DATA(data_name) data_name
+#define AUDIO_SCRATCH_FUNC(func_name) func_name
+#define AUDIO_SCRATCH_DATA(data_name) data_name
+#define CORE1_HOT_FUNC(func_name) func_name
+#define CORE1_SCRATCH_FUNC(func_name) func_name
+#endif
+
 // Waveform types
 typedef enum {
     WAVEFORM_SQUARE = 0,
     WAVEFORM_TRIANGLE,
     WAVEFORM_SAWTOOTH,
     WAVEFORM_SINE,
+    WAVEFORM_PLUCK,             // Karplus-Strong plucked string
+    WAVEFORM_ADDITIVE,          // Sum of harmonics
+    WAVEFORM_MORPH,             // Continuous blend of square, triangle, sawtooth and sine
+    WAVEFORM_GRANULAR,          // Windowed grains from a captured or flash sample
     WAVEFORM_COUNT
 } waveform_type_t;
 
+// Morph positions: 0 = square, 1 = triangle, 2 = sawtooth, 3 = sine
+#define MORPH_POSITION_MAX 3.0f
+
 // ADSR envelope states
 typedef enum {
     ADSR_IDLE = 0,
@@ -56,14 +108,24 @@ typedef enum {
     ADSR_RELEASE
 } adsr_state_t;
 
+// Per-sample envelope stage coefficients: level = base + level * coef
+typedef struct {
+    float coef;
+    float base;
+} adsr_stage_t;
+
 // System state structure
 typedef struct {
     waveform_type_t current_waveform;
     float frequency;
     float duty_cycle;
+    float morph_position;       // Morph oscillator shape (0.0 to MORPH_POSITION_MAX)
+    float filter_cutoff;        // Low-pass cutoff in Hz (>= MAX_FREQUENCY bypasses)
     bool output_enabled;
     uint32_t phase_accumulator;
     uint32_t phase_increment;
+    uint32_t phase_fraction;            // Phase below phase_accumulator (64-bit phase mode)
+    uint32_t phase_increment_fraction;  // Increment below phase_increment, 1/2^32
     
     // ADSR parameters
     float attack_time;
@@ -74,13 +136,19 @@ typedef struct {
     // ADSR state
     adsr_state_t adsr_state;
     float envelope_level;
-    float adsr_timer;
+    
+    // ADSR curve coefficients (recomputed by adsr_update when parameters change)
+    adsr_stage_t attack_stage;
+    adsr_stage_t decay_stage;
+    adsr_stage_t release_stage;
     
     // Button states for debouncing
     bool waveform_button_pressed;
     bool output_button_pressed;
     uint32_t last_waveform_press;
     uint32_t last_output_press;
+    bool drum_button_pressed;
+    uint32_t last_drum_press;
 } sound_system_t;
 
 // Global system state
@@ -0,0 +1,55 @@
+#ifndef SPECTRUM_ANALYZER_H
+#define SPECTRUM_ANALYZER_H
+
+#include "sound_explorer.h"
+
+// FFT length, must be a power of four (256 or 1024)
+#ifndef SPECTRUM_FFT_SIZE
+#define SPECTRUM_FFT_SIZE 1024
+#endif
+
+#define SPECTRUM_MAX_HARMONIC 10    // Highest harmonic included in THD
+
+// Latest analysis of the rendered output stream
+typedef struct {
+    float peak_frequency;       // Interpolated frequency of the strongest bin (Hz)
+    float peak_level_db;        // Level of the strongest bin (dBFS)
+    float thd_percent;          // Total harmonic distortion up to SPECTRUM_MAX_HARMONIC
+    float noise_floor_db;       // Average non-harmonic bin level (dBFS)
+    uint32_t frames;            // Number of completed analyses
+} spectrum_result_t;
+
+/**
+ * Build FFT tables and start the analyzer on core 1
+ */
+void spectrum_analyzer_init(void);
+
+/**
+ * Feed one rendered output sample to the analyzer (called from the sample interrupt)
+ * @param sample PWM sample value (0-255, 128 = silence)
+ */
+void spectrum_tap(uint8_t sample);
+
+/**
+ * In-place fixed-point radix-4 decimation-in-frequency FFT
+ * Each stage scales by 1/4, so the output is the DFT divided by n.
+ * Output is in natural order.
+ * @param data Interleaved real/imaginary samples (2 * n values)
+ * @param n FFT length (power of four, at most SPECTRUM_FFT_SIZE)
+ */
+void spectrum_fft(int32_t *data, uint16_t n);
+
+/**
+ * Copy the most recent analysis result
+ * @param result Destination for the result
+ * @return true if at least one analysis has completed
+ */
+bool spectrum_get_result(spectrum_result_t *result);
+
+/**
+ * Print the latest analysis and compare the peak with the set frequency
+ * @param system Pointer to the sound system state
+ */
+void spectrum_print_status(sound_system_t *system);
+
+#endif // SPECTRUM_ANALYZER_H
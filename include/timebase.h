@@ -0,0 +1,101 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "sound_explorer.h"
+
+// System clock to switch to at boot in kHz (0 keeps the boot clock)
+#ifndef TIMEBASE_SYS_CLOCK_KHZ
+#define TIMEBASE_SYS_CLOCK_KHZ 0
+#endif
+
+#define TIMEBASE_MAX_SAMPLE_RATE 96000     // Highest supported sample rate
+#define TIMEBASE_MAX_SYS_CLOCK_KHZ 250000   // Highest overclock accepted
+#define TIMEBASE_MIN_SYS_CLOCK_KHZ 48000    // Lowest clock accepted
+#define TIMEBASE_VREG_BOOST_KHZ 200000      // Above this the core voltage is raised
+
+/**
+ * Derive the PWM divider and wrap for SAMPLE_RATE from clk_sys and apply
+ * them to the audio PWM slice
+ */
+void timebase_init(void);
+
+/**
+ * Switch the audio sample rate and recompute every rate-dependent increment
+ * @param system Pointer to the sound system state
+ * @param sample_rate 22050, 44100, 48000 or 96000
+ * @return true if the rate is supported
+ */
+bool timebase_set_sample_rate(sound_system_t *system, uint32_t sample_rate);
+
+/**
+ * Change clk_sys (optional overclocking) and keep the sample rate
+ * @param system Pointer to the sound system state
+ * @param khz New system clock in kHz
+ * @return true if the clock could be set
+ */
+bool timebase_set_system_clock(sound_system_t *system, uint32_t khz);
+
+/**
+ * Drop clk_sys for deep idle, keeping the PWM carrier at the sample rate
+ * Rate-dependent coefficients are left alone, so only call while the sample
+ * interrupt is stopped and call timebase_exit_idle_clock() before restarting
+ * it. The output is held at the DC bias.
+ * @param khz Idle system clock in kHz
+ * @return true if the clock was lowered (false if already at or below khz)
+ */
+bool timebase_enter_idle_clock(uint32_t khz);
+
+/**
+ * Restore the clk_sys saved by timebase_enter_idle_clock()
+ * The divider, wrap and sample rate come back exactly as before.
+ */
+void timebase_exit_idle_clock(void);
+
+/**
+ * Get the exact sample rate produced by the current divider and wrap
+ * @return Sample rate in Hz
+ */
+float timebase_get_sample_rate(void);
+
+/**
+ * Get the requested (nominal) sample rate
+ * @return Sample rate in Hz
+ */
+uint32_t timebase_get_nominal_rate(void);
+
+/**
+ * Get the number of PWM levels per sample period (wrap + 1)
+ * @return PWM counter range
+ */
+uint16_t timebase_get_pwm_levels(void);
+
+/**
+ * Get the integer PWM clock divider
+ * @return clk_sys cycles per PWM counter tick
+ */
+uint32_t timebase_get_pwm_divider(void);
+
+/**
+ * Count one rendered sample (called from the sample interrupt)
+ */
+void timebase_count_sample(void);
+
+/**
+ * Get the number of samples rendered since boot (wraps every 2^32 samples)
+ * @return Sample count
+ */
+uint32_t timebase_get_sample_count(void);
+
+/**
+ * Print clock, divider and sample rate information
+ */
+void timebase_print_status(void);
+
+/**
+ * Measure the real sample rate against the CPU timer and report the
+ * resulting pitch error for the current frequency
+ * @param system Pointer to the sound system state
+ */
+void timebase_measure_pitch(sound_system_t *system);
+
+#endif // TIMEBASE_H
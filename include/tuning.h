@@ -0,0 +1,155 @@
+#ifndef TUNING_H
+#define TUNING_H
+
+#include "sound_explorer.h"
+
+#define TUNING_MAX_DEGREES 64           // Scale degrees per period (including the period)
+#define TUNING_TABLE_PERIODS 10         // Octaves from MIN_FREQUENCY to MAX_FREQUENCY, rounded up
+#define TUNING_MAX_NOTES (TUNING_MAX_DEGREES * TUNING_TABLE_PERIODS + 1)  // Table entries
+#define TUNING_DEFAULT_ROOT 261.6256f   // C4 with A4 = 440 Hz
+#define TUNING_HYSTERESIS 0.6f          // Fraction of a step the pot must pass to change notes
+
+// Pitch sources
+typedef enum {
+    TUNING_CONTINUOUS = 0,              // Pot curve, no quantization
+    TUNING_EQUAL,                       // 12-tone equal temperament
+    TUNING_JUST,                        // 5-limit just intonation over the root
+    TUNING_SCALA,                       // Degrees loaded with tuning_load_degrees()
+    TUNING_MODE_COUNT
+} tuning_mode_t;
+
+/**
+ * Load 12-TET and an empty Scala table, continuous pitch, 32-bit phase
+ */
+void tuning_init(void);
+
+/**
+ * Select the pitch source and rebuild the note table
+ * @param mode Tuning mode
+ * @return false if a Scala table was selected before one was loaded
+ */
+bool tuning_set_mode(tuning_mode_t mode);
+
+/**
+ * Get the current pitch source
+ * @return Tuning mode
+ */
+tuning_mode_t tuning_get_mode(void);
+
+/**
+ * Check if pitches snap to the note table
+ * @return true unless the mode is TUNING_CONTINUOUS
+ */
+bool tuning_is_quantized(void);
+
+/**
+ * Set the frequency of scale degree 0 and rebuild the note table
+ * @param frequency Root frequency in Hz (MIN_FREQUENCY-MAX_FREQUENCY)
+ * @return true if the frequency was in range
+ */
+bool tuning_set_root(float frequency);
+
+/**
+ * Replace or extend the Scala degrees and rebuild the note table
+ * As in a Scala file, degree 0 (1/1) is implied and the last degree is the
+ * period the scale repeats at.
+ * @param cents Degrees in cents above the root, ascending
+ * @param count Number of degrees
+ * @param append Add to the degrees already loaded instead of replacing them
+ * @return true if the degrees were ascending, fit in TUNING_MAX_DEGREES and the
+ *         note table can hold every degree from MIN_FREQUENCY to MAX_FREQUENCY
+ */
+bool tuning_load_degrees(const float *cents, uint8_t count, bool append);
+
+/**
+ * Parse one Scala pitch: cents if it has a decimal point, otherwise a ratio
+ * ("5/4") or whole number ("2" = 2/1)
+ * @param text Pitch text
+ * @param cents Destination for the pitch in cents
+ * @return true if the text was a valid, positive pitch
+ */
+bool tuning_parse_pitch(const char *text, float *cents);
+
+/**
+ * Enable the 64-bit (32.32 fixed-point) phase accumulator
+ * @param high true for 64-bit phase, false for the 32-bit integer increment
+ */
+void tuning_set_high_precision(bool high);
+
+/**
+ * Check if the 64-bit phase accumulator is enabled
+ * @return true in 64-bit mode
+ */
+bool tuning_is_high_precision(void);
+
+/**
+ * Rebuild the note table after a sample rate change
+ */
+void tuning_refresh_rates(void);
+
+/**
+ * Find the note table entry nearest a frequency
+ * @param frequency Frequency in Hz
+ * @param previous Note the input was last quantized to (kept until the input
+ *                 passes TUNING_HYSTERESIS of a step), or -1
+ * @return Table index, or -1 in continuous mode
+ */
+int tuning_nearest(float frequency, int previous);
+
+/**
+ * Get the number of scale steps per period (the octave, or the last Scala degree)
+ * @return Degrees of the active scale; 12 in continuous mode, where notes are semitones
+ */
+int tuning_degree_count(void);
+
+/**
+ * Get the number of notes in the table
+ * @return Notes between MIN_FREQUENCY and MAX_FREQUENCY
+ */
+int tuning_note_count(void);
+
+/**
+ * Get a table note's frequency
+ * @param note Table index (clamped to the table)
+ * @return Frequency in Hz
+ */
+float tuning_note_frequency(int note);
+
+/**
+ * Get a table note's phase increment
+ * @param note Table index (clamped to the table)
+ * @param fraction Destination for the increment's fractional 32 bits
+ * @return Integer phase increment
+ */
+uint32_t tuning_note_increment(int note, uint32_t *fraction);
+
+/**
+ * Convert a frequency to a 32.32 phase increment at the current sample rate
+ * Table notes come from the precomputed table; other frequencies are
+ * computed in double precision.
+ * @param frequency Frequency in Hz
+ * @param fraction Destination for the increment's fractional 32 bits
+ * @return Integer phase increment
+ */
+uint32_t tuning_frequency_to_increment(float frequency, uint32_t *fraction);
+
+/**
+ * Get tuning mode name
+ * @param mode Tuning mode
+ * @return String representation of the mode
+ */
+const char* tuning_get_mode_name(tuning_mode_t mode);
+
+/**
+ * Print mode, root, precision and the loaded scale degrees
+ */
+void tuning_print_status(void);
+
+/**
+ * Report the worst pitch error across MIN_FREQUENCY-MAX_FREQUENCY for the
+ * float, 32-bit and 64-bit increment calculations, in cents and in phase
+ * drift per hour
+ */
+void tuning_print_error_report(void);
+
+#endif // TUNING_H
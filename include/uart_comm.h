@@ -39,4 +39,23 @@ const char* uart_get_adsr_state_name(adsr_state_t state);
  */
 void uart_periodic_update(sound_system_t *system);
 
+/**
+ * Poll the serial link for command input (non-blocking)
+ * Complete lines are dispatched to uart_handle_command().
+ * @param system Pointer to the sound system state
+ */
+void uart_poll_commands(sound_system_t *system);
+
+/**
+ * Execute a single serial command line
+ * @param system Pointer to the sound system state
+ * @param line Null-terminated command line
+ */
+void uart_handle_command(sound_system_t *system, char *line);
+
+/**
+ * Print the list of serial commands
+ */
+void uart_print_help(void);
+
 #endif // UART_COMM_H
\ No newline at end of file
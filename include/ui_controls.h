@@ -2,6 +2,7 @@
 #define UI_CONTROLS_H
 
 #include "sound_explorer.h"
+#include "drums.h"
 
 /**
  * Initialize UI controls (buttons, LEDs, potentiometers)
@@ -38,6 +39,18 @@ void ui_handle_waveform_button(sound_system_t *system);
  */
 void ui_handle_output_toggle(sound_system_t *system);
 
+/**
+ * Handle drum pad button press
+ * @param system Pointer to the sound system state
+ */
+void ui_handle_drum_button(sound_system_t *system);
+
+/**
+ * Choose the voice the drum pad button plays
+ * @param voice Drum voice
+ */
+void ui_set_drum_pad(drum_voice_t voice);
+
 /**
  * Convert ADC value to frequency in the specified range
  * @param adc_value Raw ADC reading (0-4095)
@@ -52,6 +65,13 @@ float ui_adc_to_frequency(uint16_t adc_value);
  */
 float ui_adc_to_duty_cycle(uint16_t adc_value);
 
+/**
+ * Convert ADC value to morph position
+ * @param adc_value Raw ADC reading (0-4095)
+ * @return Morph position (0.0-MORPH_POSITION_MAX)
+ */
+float ui_adc_to_morph(uint16_t adc_value);
+
 /**
  * Convert ADC value to time parameter (for ADSR)
  * @param adc_value Raw ADC reading (0-4095)
@@ -3,6 +3,11 @@
 
 #include "sound_explorer.h"
 
+// Length of the crossfade when the waveform is changed
+#ifndef WAVEFORM_CROSSFADE_MS
+#define WAVEFORM_CROSSFADE_MS 5
+#endif
+
 /**
  * Initialize the waveform generator subsystem
  * Sets up PWM for audio output
@@ -10,19 +15,30 @@
 void waveform_generator_init(void);
 
 /**
- * Generate a single sample for the current waveform
+ * Generate a single sample for the current waveform and advance the phase
+ * Applies modulation, the low-pass filter and the ADSR envelope.
  * @param system Pointer to the sound system state
  * @return Sample value (0-255 for 8-bit PWM)
  */
 uint8_t generate_waveform_sample(sound_system_t *system);
 
+/**
+ * Switch to another waveform with a short crossfade
+ * The crossfade starts on the next sample and lasts WAVEFORM_CROSSFADE_MS;
+ * selected during a fade, the new shape fades in once that fade completes
+ * (or the fade reverses when going back to the shape fading out).
+ * @param system Pointer to the sound system state
+ * @param waveform Waveform to switch to
+ */
+void waveform_select(sound_system_t *system, waveform_type_t waveform);
+
 /**
  * Generate square wave sample with variable duty cycle
  * @param phase Current phase (0-65535)
- * @param duty_cycle Duty cycle (0.0-1.0)
+ * @param duty_threshold Phase below which the output is high (0-65535)
  * @return Sample value (0-255)
  */
-uint8_t generate_square_wave(uint16_t phase, float duty_cycle);
+uint8_t generate_square_wave(uint16_t phase, uint16_t duty_threshold);
 
 /**
  * Generate triangle wave sample
@@ -56,4 +72,36 @@ void update_phase_accumulator(sound_system_t *system);
  */
 void pwm_interrupt_handler(void);
 
+/**
+ * Start or stop the sample interrupt
+ * While stopped the output is held at the DC bias and no samples are counted.
+ * @param enabled true to run the sample interrupt
+ */
+void waveform_set_sample_interrupt(bool enabled);
+
+// Sample interrupt timing, in clk_sys cycles
+typedef struct {
+    uint32_t worst_latency;     // PWM wrap to handler entry
+    uint32_t worst_duration;    // Handler entry to exit
+    uint64_t total_duration;    // Sum over all counted interrupts
+    uint32_t count;             // Interrupts measured since the last reset
+    uint32_t overruns;          // Handlers that ran past the next wrap
+} isr_stats_t;
+
+/**
+ * Get sample interrupt latency and duration statistics
+ * @param stats Destination for the statistics
+ */
+void waveform_get_isr_stats(isr_stats_t *stats);
+
+/**
+ * Reset sample interrupt statistics
+ */
+void waveform_reset_isr_stats(void);
+
+/**
+ * Print sample interrupt statistics and the hot path placement
+ */
+void waveform_print_isr_stats(void);
+
 #endif // WAVEFORM_GENERATOR_H
\ No newline at end of file
@@ -0,0 +1,264 @@
+/**
+ * Additive Synthesis Implementation
+ *
+ * This module sums up to ADDITIVE_MAX_PARTIALS harmonics from a Q15 sine
+ * table. The partial bank is a struct of arrays (phases, amplitudes) and is
+ * rendered a block at a time with the partial loop outside the sample loop,
+ * so each partial's phase, increment and amplitude stay in registers for the
+ * whole block. Harmonics at or above Nyquist are skipped from the current
+ * phase increment, so the output never aliases.
+ */
+
+#include "additive.h"
+#include "waveform_generator.h"
+#include "timebase.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+#define ADDITIVE_SINE_SIZE (1 << ADDITIVE_SINE_BITS)
+#define ADDITIVE_PHASE_SHIFT (32 - ADDITIVE_SINE_BITS)
+#define ADDITIVE_NYQUIST_INCREMENT 0x80000000u  // Phase increment of fs / 2
+#define ADDITIVE_BENCH_SAMPLES 4096             // Samples timed per benchmark step
+#define ADDITIVE_BENCH_FREQUENCY 55.0f          // Low enough for every partial to sound
+#define ADDITIVE_BENCH_RATE 44100               // Sample rate the budget is reported for
+
+// Q15 sine, one full cycle
+static int16_t sine_q15[ADDITIVE_SINE_SIZE];
+
+// Partial bank (index k holds harmonic k + 1)
+static uint32_t partial_phase[ADDITIVE_MAX_PARTIALS];
+static int16_t partial_amplitude[ADDITIVE_MAX_PARTIALS];    // Normalized, sum of |a| <= 1.0
+static float partial_level[ADDITIVE_MAX_PARTIALS];          // Levels as set by the user
+static volatile uint8_t partial_count = ADDITIVE_DEFAULT_PARTIALS;
+static additive_preset_t current_preset = ADDITIVE_PRESET_SAWTOOTH;
+static bool preset_edited = false;
+
+// Rendered block, consumed one sample per interrupt (Q30)
+static int32_t block[ADDITIVE_BLOCK_SIZE];
+static uint8_t block_position = ADDITIVE_BLOCK_SIZE;
+
+/**
+ * Scale the user levels so the summed amplitudes cannot exceed full scale
+ */
+static void additive_normalize(void) {
+    float total = 0.0f;
+    for (int k = 0; k < partial_count; k++) {
+        total += fabsf(partial_level[k]);
+    }
+
+    float scale = (total > 0.0f) ? 32767.0f / total : 0.0f;
+    for (int k = 0; k < ADDITIVE_MAX_PARTIALS; k++) {
+        partial_amplitude[k] = (k < partial_count) ? (int16_t)(partial_level[k] * scale) : 0;
+    }
+}
+
+/**
+ * Render count samples of the partial bank into out (Q30)
+ * @return Number of partials below Nyquist
+ */
+static uint32_t AUDIO_HOT_FUNC(additive_render_block)(int32_t *out, uint32_t count, uint32_t increment) {
+    // Harmonic k + 1 sits at (k + 1) * increment and must stay below fs / 2
+    uint32_t audible = increment ? (ADDITIVE_NYQUIST_INCREMENT - 1) / increment : ADDITIVE_MAX_PARTIALS;
+    uint32_t partials = (partial_count < audible) ? partial_count : audible;
+
+    for (uint32_t n = 0; n < count; n++) {
+        out[n] = 0;
+    }
+
+    uint32_t harmonic_increment = 0;
+    for (uint32_t k = 0; k < partials; k++) {
+        harmonic_increment += increment;
+        uint32_t phase = partial_phase[k];
+        int32_t amplitude = partial_amplitude[k];
+
+        if (amplitude != 0) {
+            for (uint32_t n = 0; n < count; n++) {
+                out[n] += sine_q15[phase >> ADDITIVE_PHASE_SHIFT] * amplitude;
+                phase += harmonic_increment;
+            }
+        } else {
+            phase += harmonic_increment * count;
+        }
+        partial_phase[k] = phase;
+    }
+    return partials;
+}
+
+void additive_init(void) {
+    for (int i = 0; i < ADDITIVE_SINE_SIZE; i++) {
+        sine_q15[i] = (int16_t)lroundf(32767.0f * sinf(2.0f * (float)M_PI * i / ADDITIVE_SINE_SIZE));
+    }
+    memset(partial_phase, 0, sizeof(partial_phase));
+    additive_load_preset(ADDITIVE_PRESET_SAWTOOTH);
+
+    printf("Additive synthesis initialized (%d partials, %d-sample blocks)\n",
+           ADDITIVE_MAX_PARTIALS, ADDITIVE_BLOCK_SIZE);
+}
+
+void additive_load_preset(additive_preset_t preset) {
+    static const uint8_t organ_harmonics[] = {1, 2, 3, 4, 6, 8};
+
+    for (int k = 0; k < ADDITIVE_MAX_PARTIALS; k++) {
+        int harmonic = k + 1;
+        float level = 0.0f;
+
+        switch (preset) {
+            case ADDITIVE_PRESET_SAWTOOTH:
+                level = 1.0f / harmonic;
+                break;
+            case ADDITIVE_PRESET_SQUARE:
+                level = (harmonic & 1) ? 1.0f / harmonic : 0.0f;
+                break;
+            case ADDITIVE_PRESET_TRIANGLE:
+                if (harmonic & 1) {
+                    level = ((harmonic / 2) & 1 ? -1.0f : 1.0f) / (harmonic * harmonic);
+                }
+                break;
+            case ADDITIVE_PRESET_ORGAN:
+                for (uint i = 0; i < count_of(organ_harmonics); i++) {
+                    if (organ_harmonics[i] == harmonic) {
+                        level = 1.0f;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        partial_level[k] = level;
+    }
+
+    current_preset = preset;
+    preset_edited = false;
+    additive_normalize();
+}
+
+bool additive_set_partial(uint8_t harmonic, float level) {
+    if (harmonic < 1 || harmonic > ADDITIVE_MAX_PARTIALS || level < -1.0f || level > 1.0f) {
+        return false;
+    }
+    partial_level[harmonic - 1] = level;
+    preset_edited = true;
+    additive_normalize();
+    return true;
+}
+
+bool additive_set_partial_count(uint8_t count) {
+    if (count < 1 || count > ADDITIVE_MAX_PARTIALS) {
+        return false;
+    }
+    partial_count = count;
+    additive_normalize();
+    return true;
+}
+
+int32_t AUDIO_HOT_FUNC(additive_process)(uint32_t phase_increment) {
+    if (block_position == ADDITIVE_BLOCK_SIZE) {
+        // Pitch (including modulation) is picked up once per block
+        additive_render_block(block, ADDITIVE_BLOCK_SIZE, phase_increment);
+        block_position = 0;
+    }
+    return block[block_position++] >> 15;
+}
+
+const char* additive_get_preset_name(additive_preset_t preset) {
+    switch (preset) {
+        case ADDITIVE_PRESET_SAWTOOTH: return "saw";
+        case ADDITIVE_PRESET_SQUARE:   return "square";
+        case ADDITIVE_PRESET_TRIANGLE: return "triangle";
+        case ADDITIVE_PRESET_ORGAN:    return "organ";
+        default:                       return "unknown";
+    }
+}
+
+void additive_print_status(sound_system_t *system) {
+    uint32_t audible = system->phase_increment ?
+                       (ADDITIVE_NYQUIST_INCREMENT - 1) / system->phase_increment : ADDITIVE_MAX_PARTIALS;
+    if (audible > partial_count) {
+        audible = partial_count;
+    }
+
+    printf("Additive: %d partials (%s%s), %lu below Nyquist at %.1f Hz\n",
+           partial_count, additive_get_preset_name(current_preset),
+           preset_edited ? ", edited" : "", (unsigned long)audible, system->frequency);
+    printf("  Levels:");
+    for (int k = 0; k < partial_count && k < 8; k++) {
+        printf(" %d:%.0f%%", k + 1, partial_level[k] * 100.0f);
+    }
+    printf("%s\n", partial_count > 8 ? " ..." : "");
+}
+
+void additive_benchmark(void) {
+    static const uint8_t counts[] = {1, 8, 16, 32, 48, 64};
+    static int32_t bench_block[ADDITIVE_BLOCK_SIZE];
+    uint32_t block_us[count_of(counts)];
+    uint32_t single_us[count_of(counts)];
+    float saved_levels[ADDITIVE_MAX_PARTIALS];
+    uint8_t saved_count = partial_count;
+    bool saved_edited = preset_edited;
+
+    // Every partial non-zero so none are skipped
+    memcpy(saved_levels, partial_level, sizeof(partial_level));
+    for (int k = 0; k < ADDITIVE_MAX_PARTIALS; k++) {
+        partial_level[k] = 1.0f / (k + 1);
+    }
+    uint32_t increment = (uint32_t)(ADDITIVE_BENCH_FREQUENCY * 4294967296.0f / timebase_get_sample_rate());
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (uint i = 0; i < count_of(counts); i++) {
+        partial_count = (counts[i] < ADDITIVE_MAX_PARTIALS) ? counts[i] : ADDITIVE_MAX_PARTIALS;
+        additive_normalize();
+
+        uint64_t start = time_us_64();
+        for (int n = 0; n < ADDITIVE_BENCH_SAMPLES; n += ADDITIVE_BLOCK_SIZE) {
+            additive_render_block(bench_block, ADDITIVE_BLOCK_SIZE, increment);
+        }
+        block_us[i] = (uint32_t)(time_us_64() - start);
+
+        start = time_us_64();
+        for (int n = 0; n < ADDITIVE_BENCH_SAMPLES; n++) {
+            additive_render_block(bench_block, 1, increment);
+        }
+        single_us[i] = (uint32_t)(time_us_64() - start);
+    }
+
+    memcpy(partial_level, saved_levels, sizeof(partial_level));
+    partial_count = saved_count;
+    preset_edited = saved_edited;
+    additive_normalize();
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    printf("Additive benchmark (%.0f MHz, %d-sample blocks):\n", cycles_per_us, ADDITIVE_BLOCK_SIZE);
+    printf("  Partials | Block cycles/sample | Per-sample cycles/sample\n");
+    for (uint i = 0; i < count_of(counts); i++) {
+        if (counts[i] > ADDITIVE_MAX_PARTIALS) {
+            continue;
+        }
+        printf("  %8d | %19.1f | %24.1f\n", counts[i],
+               block_us[i] * cycles_per_us / ADDITIVE_BENCH_SAMPLES,
+               single_us[i] * cycles_per_us / ADDITIVE_BENCH_SAMPLES);
+    }
+
+    // Cost of one more partial from the two largest measured counts, against
+    // the budget left in a sample period by the rest of the interrupt
+    uint last = count_of(counts) - 1;
+    while (last > 1 && counts[last] > ADDITIVE_MAX_PARTIALS) {
+        last--;
+    }
+    float per_partial = (block_us[last] - block_us[0]) * cycles_per_us /
+                        ((float)ADDITIVE_BENCH_SAMPLES * (counts[last] - counts[0]));
+    float fixed = block_us[0] * cycles_per_us / ADDITIVE_BENCH_SAMPLES - per_partial;
+
+    isr_stats_t stats;
+    waveform_get_isr_stats(&stats);
+    float isr_load = stats.count ? (float)stats.total_duration / stats.count : 0.0f;
+    float budget = cycles_per_us * 1000000.0f / ADDITIVE_BENCH_RATE;
+    printf("  %.2f cycles per partial-sample, %.0f cycle budget at %d Hz (ISR average %.0f)\n",
+           per_partial, budget, ADDITIVE_BENCH_RATE, isr_load);
+    if (per_partial > 0.0f) {
+        printf("  Partials per sample that fit at %d Hz: %d\n", ADDITIVE_BENCH_RATE,
+               (int)((budget - isr_load - fixed) / per_partial));
+    }
+}
@@ -6,6 +6,9 @@
  */
 
 #include "adsr_envelope.h"
+#include "timebase.h"
+#include "karplus_strong.h"
+#include "audio_input.h"
 
 void adsr_envelope_init(void) {
     // Initialize ADC for reading potentiometer values
@@ -23,94 +26,137 @@ void adsr_envelope_init(void) {
     gpio_put(MUX_SELECT_PIN, false); // Start with frequency/duty cycle mode
 }
 
+// Curve shape: how far past its target each stage aims. Small ratios give
+// strongly exponential curves, large ratios approach a straight line.
+#define ADSR_ATTACK_TARGET_RATIO 0.3f
+#define ADSR_DECAY_RELEASE_TARGET_RATIO 0.0001f
+
+// Parameters the current coefficients were computed for
+static float cached_attack_time = -1.0f;
+static float cached_decay_time = -1.0f;
+static float cached_sustain_level = -1.0f;
+static float cached_release_time = -1.0f;
+static float cached_sample_rate = -1.0f;
+
+/**
+ * Compute the one-pole coefficients for a stage that heads towards target
+ * (which already includes the overshoot) and takes stage_time seconds to
+ * cover the full 0-100% range.
+ */
+static adsr_stage_t adsr_calc_stage(float stage_time, float target, float ratio) {
+    adsr_stage_t stage;
+    float samples = stage_time * timebase_get_sample_rate();
+    
+    if (samples < 1.0f) {
+        // Instant stage: first sample lands on (or past) the target
+        stage.coef = 0.0f;
+    } else {
+        stage.coef = expf(-logf((1.0f + ratio) / ratio) / samples);
+    }
+    stage.base = target * (1.0f - stage.coef);
+    return stage;
+}
+
 void adsr_note_on(sound_system_t *system) {
+    // Attack restarts from the current level so retriggers never jump
     system->adsr_state = ADSR_ATTACK;
-    system->adsr_timer = 0.0f;
+    
+    if (system->current_waveform == WAVEFORM_PLUCK && !ks_pluck(system->frequency)) {
+        printf("ADSR: %.1f Hz is outside the string range\n", system->frequency);
+    }
     
     printf("ADSR: Note ON - Starting attack phase\n");
 }
 
 void adsr_note_off(sound_system_t *system) {
     if (system->adsr_state != ADSR_IDLE) {
+        // Release fades from wherever the envelope is, even mid-attack
         system->adsr_state = ADSR_RELEASE;
-        system->adsr_timer = 0.0f;
         
         printf("ADSR: Note OFF - Starting release phase\n");
     }
 }
 
-void adsr_update(sound_system_t *system, float delta_time) {
-    system->adsr_timer += delta_time;
+void AUDIO_HOT_FUNC(adsr_gate)(sound_system_t *system, bool on) {
+    if (on) {
+        system->adsr_state = ADSR_ATTACK;
+    } else if (system->adsr_state != ADSR_IDLE) {
+        system->adsr_state = ADSR_RELEASE;
+    }
+}
+
+void adsr_update(sound_system_t *system) {
+    if (system->attack_time == cached_attack_time &&
+        system->decay_time == cached_decay_time &&
+        system->sustain_level == cached_sustain_level &&
+        system->release_time == cached_release_time &&
+        timebase_get_sample_rate() == cached_sample_rate) {
+        return;
+    }
+    
+    adsr_stage_t attack = adsr_calc_stage(system->attack_time,
+                                          1.0f + ADSR_ATTACK_TARGET_RATIO,
+                                          ADSR_ATTACK_TARGET_RATIO);
+    adsr_stage_t decay = adsr_calc_stage(system->decay_time,
+                                         system->sustain_level - ADSR_DECAY_RELEASE_TARGET_RATIO,
+                                         ADSR_DECAY_RELEASE_TARGET_RATIO);
+    adsr_stage_t release = adsr_calc_stage(system->release_time,
+                                           -ADSR_DECAY_RELEASE_TARGET_RATIO,
+                                           ADSR_DECAY_RELEASE_TARGET_RATIO);
+    
+    // Each stage is two words; the sample interrupt may pick up a mix of old
+    // and new coefficients for one sample, which is harmless.
+    system->attack_stage = attack;
+    system->decay_stage = decay;
+    system->release_stage = release;
+    
+    cached_attack_time = system->attack_time;
+    cached_decay_time = system->decay_time;
+    cached_sustain_level = system->sustain_level;
+    cached_release_time = system->release_time;
+    cached_sample_rate = timebase_get_sample_rate();
+}
+
+float AUDIO_HOT_FUNC(adsr_process)(sound_system_t *system) {
+    float level = system->envelope_level;
     
     switch (system->adsr_state) {
         case ADSR_IDLE:
-            system->envelope_level = 0.0f;
+            level = 0.0f;
             break;
             
         case ADSR_ATTACK:
-            if (system->attack_time > 0.0f) {
-                system->envelope_level = system->adsr_timer / system->attack_time;
-                if (system->envelope_level >= 1.0f) {
-                    system->envelope_level = 1.0f;
-                    system->adsr_state = ADSR_DECAY;
-                    system->adsr_timer = 0.0f;
-                }
-            } else {
-                // Instant attack
-                system->envelope_level = 1.0f;
+            level = system->attack_stage.base + level * system->attack_stage.coef;
+            if (level >= 1.0f) {
+                level = 1.0f;
                 system->adsr_state = ADSR_DECAY;
-                system->adsr_timer = 0.0f;
             }
             break;
             
         case ADSR_DECAY:
-            if (system->decay_time > 0.0f) {
-                float decay_progress = system->adsr_timer / system->decay_time;
-                if (decay_progress >= 1.0f) {
-                    system->envelope_level = system->sustain_level;
-                    system->adsr_state = ADSR_SUSTAIN;
-                    system->adsr_timer = 0.0f;
-                } else {
-                    // Linear interpolation from 1.0 to sustain_level
-                    system->envelope_level = 1.0f - decay_progress * (1.0f - system->sustain_level);
-                }
-            } else {
-                // Instant decay
-                system->envelope_level = system->sustain_level;
+            level = system->decay_stage.base + level * system->decay_stage.coef;
+            if (level <= system->sustain_level) {
+                level = system->sustain_level;
                 system->adsr_state = ADSR_SUSTAIN;
-                system->adsr_timer = 0.0f;
             }
             break;
             
         case ADSR_SUSTAIN:
-            system->envelope_level = system->sustain_level;
             // Stay in sustain until note off
+            level = system->sustain_level;
             break;
             
         case ADSR_RELEASE:
-            if (system->release_time > 0.0f) {
-                float release_progress = system->adsr_timer / system->release_time;
-                if (release_progress >= 1.0f) {
-                    system->envelope_level = 0.0f;
-                    system->adsr_state = ADSR_IDLE;
-                    system->adsr_timer = 0.0f;
-                } else {
-                    // Linear fade from current level to 0
-                    float start_level = system->sustain_level;
-                    system->envelope_level = start_level * (1.0f - release_progress);
-                }
-            } else {
-                // Instant release
-                system->envelope_level = 0.0f;
+            level = system->release_stage.base + level * system->release_stage.coef;
+            if (level <= 0.0f) {
+                level = 0.0f;
                 system->adsr_state = ADSR_IDLE;
-                system->adsr_timer = 0.0f;
             }
             break;
     }
     
-    // Clamp envelope level to valid range
-    if (system->envelope_level < 0.0f) system->envelope_level = 0.0f;
-    if (system->envelope_level > 1.0f) system->envelope_level = 1.0f;
+    system->envelope_level = level;
+    return level;
 }
 
 float adsr_get_level(sound_system_t *system) {
@@ -128,13 +174,11 @@ void adsr_read_parameters(sound_system_t *system) {
     last_read_time = current_time;
     
     // Read attack time potentiometer
-    adc_select_input(2); // ADSR_ATTACK_POT_PIN is ADC2 (GPIO28)
-    uint16_t attack_adc = adc_read();
+    uint16_t attack_adc = audio_input_read_adc(2); // ADSR_ATTACK_POT_PIN is ADC2 (GPIO28)
     system->attack_time = (float)attack_adc / ADC_MAX_VALUE * 2.0f; // 0 to 2 seconds
     
     // Read decay time potentiometer  
-    adc_select_input(3); // ADSR_DECAY_POT_PIN is ADC3 (GPIO29)
-    uint16_t decay_adc = adc_read();
+    uint16_t decay_adc = audio_input_read_adc(3); // ADSR_DECAY_POT_PIN is ADC3 (GPIO29)
     system->decay_time = (float)decay_adc / ADC_MAX_VALUE * 2.0f; // 0 to 2 seconds
     
     // Read sustain and release using multiplexer
@@ -143,13 +187,11 @@ void adsr_read_parameters(sound_system_t *system) {
     sleep_us(10); // Allow mux to settle
     
     // Read sustain level potentiometer (multiplexed on ADC0)
-    adc_select_input(0);
-    uint16_t sustain_adc = adc_read();
+    uint16_t sustain_adc = audio_input_read_adc(0);
     system->sustain_level = (float)sustain_adc / ADC_MAX_VALUE; // 0 to 100%
     
     // Read release time potentiometer (multiplexed on ADC1)
-    adc_select_input(1);
-    uint16_t release_adc = adc_read();
+    uint16_t release_adc = audio_input_read_adc(1);
     system->release_time = (float)release_adc / ADC_MAX_VALUE * 5.0f; // 0 to 5 seconds
     
     // Switch back to frequency/duty cycle mode
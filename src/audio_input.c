@@ -0,0 +1,468 @@
+/**
+ * Audio Input Implementation
+ *
+ * This module samples one ADC channel at the audio rate. The ADC converts
+ * ADC0-3 round robin, one frame of AUDIO_INPUT_CHANNELS conversions per
+ * output sample, and two chained DMA channels take turns writing the FIFO
+ * into an aligned ring, so the stream never stops and needs no interrupt.
+ * The pot channels ride in the same frames: while the input is on, pot
+ * reads take the next fresh conversion from the ring instead of starting
+ * one of their own.
+ *
+ * The sample interrupt reads the audio channel a block at a time, a fixed
+ * distance behind the DMA, removes the DC bias and runs a peak envelope
+ * follower in fixed point. The follower can scale the voice or gate the
+ * ADSR; the input itself can ring or amplitude modulate the voice.
+ */
+
+#include "audio_input.h"
+#include "adsr_envelope.h"
+#include "latency.h"
+#include "timebase.h"
+#include "waveform_generator.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+#define AUDIO_INPUT_RING_SIZE ((1 << AUDIO_INPUT_RING_BITS) / sizeof(uint16_t))
+#define AUDIO_INPUT_RING_MASK (AUDIO_INPUT_RING_SIZE - 1)
+#define AUDIO_INPUT_FRAMES (AUDIO_INPUT_RING_SIZE / AUDIO_INPUT_CHANNELS)
+#define AUDIO_INPUT_FRAME_MASK (AUDIO_INPUT_FRAMES - 1)
+#define AUDIO_INPUT_ADC_CENTRE 2048
+#define AUDIO_INPUT_DC_SHIFT 8          // DC estimate time constant, 256 samples (~27 Hz at 44.1 kHz)
+#define AUDIO_INPUT_READ_TIMEOUT_US 1000
+#define AUDIO_INPUT_BENCH_SAMPLES 4096  // Samples timed per benchmark step
+#define AUDIO_INPUT_BENCH_RATE 44100    // Sample rate the budget is reported for
+
+_Static_assert((AUDIO_INPUT_FRAMES & (AUDIO_INPUT_FRAMES - 1)) == 0,
+               "AUDIO_INPUT_CHANNELS must divide the ring into a power of two frames");
+
+// Conversions in arrival order; ring[frame * AUDIO_INPUT_CHANNELS + channel]
+static uint16_t ring[AUDIO_INPUT_RING_SIZE] __attribute__((aligned(1 << AUDIO_INPUT_RING_BITS)));
+static uint dma_channels[2];
+
+// Settings (single words, read by the sample interrupt)
+static volatile bool enabled = false;
+static volatile uint8_t mod_type = AUDIO_INPUT_MOD_OFF;
+static volatile int32_t mod_depth = 32768;      // Q15 wet amount
+static volatile uint8_t follow_mode = AUDIO_INPUT_FOLLOW_OFF;
+static volatile int32_t threshold = 3277;       // Q15 gate-on level
+static volatile int32_t attack_coef = 0;        // Q15 one-pole coefficients
+static volatile int32_t release_coef = 0;
+static volatile int32_t input_gain = 1;
+static volatile uint32_t frame_period_ns = 0;
+
+static float attack_ms = 1.0f;
+static float release_ms = 100.0f;
+static uint16_t held_pot = 0;                   // Pot on the input channel, read before enabling
+
+// Sample interrupt state
+typedef struct {
+    uint32_t read_frame;                // Next frame to read
+    int32_t dc;                         // DC estimate << AUDIO_INPUT_DC_SHIFT
+    int32_t follower;                   // Envelope, Q30
+    bool gate;                          // Trigger mode note state
+    bool primed;                        // Read position set since enabling
+    uint8_t block_position;
+    int32_t input;                      // Current sample (Q15)
+    int32_t level;                      // Current envelope (Q15)
+    int32_t block[AUDIO_INPUT_BLOCK_SIZE];
+    int32_t levels[AUDIO_INPUT_BLOCK_SIZE];
+} input_state_t;
+
+static input_state_t state;
+static volatile audio_input_stats_t stats;
+
+/**
+ * One-pole coefficient (Q15) for a time constant in ms at the current rate
+ */
+static int32_t audio_input_coefficient(float ms) {
+    float coef = 1.0f - expf(-1000.0f / (ms * timebase_get_sample_rate()));
+    int32_t q15 = (int32_t)(coef * 32768.0f);
+    if (q15 < 1) q15 = 1;
+    if (q15 > 32767) q15 = 32767;
+    return q15;
+}
+
+static void audio_input_reset_state(void) {
+    state = (input_state_t){0};
+    state.block_position = AUDIO_INPUT_BLOCK_SIZE;
+    state.dc = AUDIO_INPUT_ADC_CENTRE << AUDIO_INPUT_DC_SHIFT;
+    stats = (audio_input_stats_t){0};
+    stats.distance_min = UINT32_MAX;
+
+    // Frames not yet written by the DMA read as silence, not a step from zero
+    for (uint32_t i = 0; i < AUDIO_INPUT_RING_SIZE; i++) {
+        ring[i] = AUDIO_INPUT_ADC_CENTRE;
+    }
+}
+
+void audio_input_init(void) {
+    dma_channels[0] = dma_claim_unused_channel(true);
+    dma_channels[1] = dma_claim_unused_channel(true);
+    audio_input_reset_state();
+    audio_input_refresh_rates();
+
+    printf("Audio input initialized (ADC%d, %d-conversion DMA ring, %d-sample blocks)\n",
+           AUDIO_INPUT_ADC_CHANNEL, (int)AUDIO_INPUT_RING_SIZE, AUDIO_INPUT_BLOCK_SIZE);
+}
+
+void audio_input_refresh_rates(void) {
+    float rate = timebase_get_sample_rate();
+
+    // One frame per output sample; the ADC needs 96 of its clocks per conversion
+    adc_set_clkdiv(clock_get_hz(clk_adc) / (rate * AUDIO_INPUT_CHANNELS) - 1.0f);
+    frame_period_ns = (uint32_t)(1e9f / rate);
+    attack_coef = audio_input_coefficient(attack_ms);
+    release_coef = audio_input_coefficient(release_ms);
+}
+
+void audio_input_set_enabled(bool enable) {
+    if (enable == enabled) {
+        return;
+    }
+
+    if (enable) {
+        adc_select_input(AUDIO_INPUT_ADC_CHANNEL);
+        held_pot = adc_read();
+        audio_input_reset_state();
+
+        adc_fifo_setup(true, true, 1, false, false);
+        adc_set_round_robin((1u << AUDIO_INPUT_CHANNELS) - 1);
+        adc_select_input(0);
+        audio_input_refresh_rates();
+
+        // Each channel fills the ring once, then triggers the other; its write
+        // address has wrapped back to the start by then
+        for (int i = 0; i < 2; i++) {
+            dma_channel_config config = dma_channel_get_default_config(dma_channels[i]);
+            channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+            channel_config_set_read_increment(&config, false);
+            channel_config_set_write_increment(&config, true);
+            channel_config_set_ring(&config, true, AUDIO_INPUT_RING_BITS);
+            channel_config_set_dreq(&config, DREQ_ADC);
+            channel_config_set_chain_to(&config, dma_channels[i ^ 1]);
+            dma_channel_configure(dma_channels[i], &config, ring, &adc_hw->fifo,
+                                  AUDIO_INPUT_RING_SIZE, i == 0);
+        }
+
+        enabled = true;
+        adc_run(true);
+    } else {
+        enabled = false;
+        adc_run(false);
+
+        // Without DREQ both channels stall; aborting one can still trigger the
+        // other through the chain, so abort that one again
+        dma_channel_abort(dma_channels[1]);
+        dma_channel_abort(dma_channels[0]);
+        dma_channel_abort(dma_channels[1]);
+
+        adc_set_round_robin(0);
+        adc_fifo_setup(false, false, 0, false, false);
+        adc_fifo_drain();
+    }
+}
+
+bool audio_input_is_enabled(void) {
+    return enabled;
+}
+
+/**
+ * Ring index the DMA writes next
+ */
+static uint32_t AUDIO_HOT_FUNC(audio_input_write_index)(void) {
+    // Between passes neither channel is busy and both point at the ring start
+    uint channel = dma_channel_is_busy(dma_channels[0]) ? dma_channels[0] : dma_channels[1];
+    uintptr_t address = (uintptr_t)dma_channel_hw_addr(channel)->write_addr;
+    return ((address - (uintptr_t)ring) / sizeof(uint16_t)) & AUDIO_INPUT_RING_MASK;
+}
+
+uint16_t audio_input_read_adc(uint channel) {
+    if (!enabled) {
+        adc_select_input(channel);
+        return adc_read();
+    }
+    if (channel == AUDIO_INPUT_ADC_CHANNEL) {
+        return held_pot;
+    }
+
+    // Two frames on, every channel has been converted since the call (after
+    // a multiplexer switch, for example)
+    uint32_t start = audio_input_write_index();
+    uint32_t start_time = time_us_32();
+    uint32_t index;
+    do {
+        index = audio_input_write_index();
+    } while (((index - start) & AUDIO_INPUT_RING_MASK) < 2 * AUDIO_INPUT_CHANNELS &&
+             time_us_32() - start_time < AUDIO_INPUT_READ_TIMEOUT_US);
+
+    uint32_t frame = (index / AUDIO_INPUT_CHANNELS - 1) & AUDIO_INPUT_FRAME_MASK;
+    return ring[frame * AUDIO_INPUT_CHANNELS + channel];
+}
+
+bool audio_input_set_follow(audio_input_follow_t follow, float level) {
+    if (follow >= AUDIO_INPUT_FOLLOW_COUNT || level <= 0.0f || level > 1.0f) {
+        return false;
+    }
+    threshold = (int32_t)(level * 32767.0f);
+    follow_mode = follow;
+    return true;
+}
+
+bool audio_input_set_envelope(float new_attack_ms, float new_release_ms) {
+    if (new_attack_ms < AUDIO_INPUT_MIN_ENV_MS || new_attack_ms > AUDIO_INPUT_MAX_ENV_MS ||
+        new_release_ms < AUDIO_INPUT_MIN_ENV_MS || new_release_ms > AUDIO_INPUT_MAX_ENV_MS) {
+        return false;
+    }
+    attack_ms = new_attack_ms;
+    release_ms = new_release_ms;
+    attack_coef = audio_input_coefficient(attack_ms);
+    release_coef = audio_input_coefficient(release_ms);
+    return true;
+}
+
+bool audio_input_set_mod(audio_input_mod_t mod, float depth) {
+    if (mod >= AUDIO_INPUT_MOD_COUNT || depth < 0.0f || depth > 1.0f) {
+        return false;
+    }
+    mod_depth = (int32_t)(depth * 32768.0f);
+    mod_type = mod;
+    return true;
+}
+
+bool audio_input_set_gain(uint8_t gain) {
+    if (gain < 1 || gain > AUDIO_INPUT_MAX_GAIN) {
+        return false;
+    }
+    input_gain = gain;
+    return true;
+}
+
+/**
+ * Read and filter the next AUDIO_INPUT_BLOCK_SIZE input samples, then gate
+ * the ADSR from the block's final envelope in trigger mode
+ */
+static void AUDIO_HOT_FUNC(audio_input_render_block)(sound_system_t *system) {
+    uint32_t write_frame = audio_input_write_index() / AUDIO_INPUT_CHANNELS;
+    uint32_t distance = (write_frame - state.read_frame) & AUDIO_INPUT_FRAME_MASK;
+
+    // The ADC and PWM run from different clocks, so the distance drifts;
+    // re-centre when a block would overtake the DMA or fall half a ring behind
+    if (distance < AUDIO_INPUT_BLOCK_SIZE || distance > AUDIO_INPUT_FRAMES / 2) {
+        if (state.primed) {
+            stats.slips++;
+        }
+        state.primed = true;
+        distance = 2 * AUDIO_INPUT_BLOCK_SIZE;
+        state.read_frame = (write_frame - distance) & AUDIO_INPUT_FRAME_MASK;
+    }
+    stats.blocks++;
+    stats.distance_total += distance;
+    if (distance < stats.distance_min) stats.distance_min = distance;
+    if (distance > stats.distance_max) stats.distance_max = distance;
+
+    int32_t gain = input_gain;
+    int32_t attack = attack_coef;
+    int32_t release = release_coef;
+    for (int n = 0; n < AUDIO_INPUT_BLOCK_SIZE; n++) {
+        int32_t raw = ring[state.read_frame * AUDIO_INPUT_CHANNELS + AUDIO_INPUT_ADC_CHANNEL];
+        state.read_frame = (state.read_frame + 1) & AUDIO_INPUT_FRAME_MASK;
+
+        // Subtract a slow running average of the bias, then scale to Q15
+        state.dc += raw - (state.dc >> AUDIO_INPUT_DC_SHIFT);
+        int32_t value = ((raw << AUDIO_INPUT_DC_SHIFT) - state.dc) * gain >> (AUDIO_INPUT_DC_SHIFT - 4);
+        if (value > 32767) value = 32767;
+        if (value < -32767) value = -32767;
+        state.block[n] = value;
+
+        // Peak follower: fast rise, slow fall
+        int32_t rectified = value < 0 ? -value : value;
+        int32_t envelope = state.follower >> 15;
+        state.follower += (rectified - envelope) * (rectified > envelope ? attack : release);
+        state.levels[n] = state.follower >> 15;
+    }
+
+    if (follow_mode == AUDIO_INPUT_FOLLOW_TRIGGER) {
+        int32_t envelope = state.follower >> 15;
+        if (!state.gate && envelope >= threshold) {
+            state.gate = true;
+            stats.triggers++;
+            adsr_gate(system, true);
+
+            // The last sample read was converted this many frames ago
+            uint32_t age_ns = (distance - AUDIO_INPUT_BLOCK_SIZE + 1) * frame_period_ns;
+            latency_arm_input(time_us_32() - age_ns / 1000);
+        } else if (state.gate && envelope < threshold / 2) {
+            state.gate = false;
+            adsr_gate(system, false);
+        }
+    }
+}
+
+void AUDIO_HOT_FUNC(audio_input_process)(sound_system_t *system) {
+    if (!enabled) {
+        return;
+    }
+    if (state.block_position == AUDIO_INPUT_BLOCK_SIZE) {
+        audio_input_render_block(system);
+        state.block_position = 0;
+    }
+    state.input = state.block[state.block_position];
+    state.level = state.levels[state.block_position];
+    state.block_position++;
+}
+
+int32_t AUDIO_HOT_FUNC(audio_input_apply)(int32_t value) {
+    if (!enabled) {
+        return value;
+    }
+
+    int32_t depth = mod_depth;
+    switch (mod_type) {
+        case AUDIO_INPUT_MOD_RING: {
+            int32_t modulated = (value * state.input) >> 15;
+            value = (modulated * depth + value * (32768 - depth)) >> 15;
+            break;
+        }
+        case AUDIO_INPUT_MOD_AM: {
+            // (1 + input) / 2 keeps the carrier at half level with no input
+            int32_t modulated = (value * ((state.input + 32768) >> 1)) >> 15;
+            value = (modulated * depth + value * (32768 - depth)) >> 15;
+            break;
+        }
+        default:
+            break;
+    }
+
+    if (follow_mode == AUDIO_INPUT_FOLLOW_LEVEL) {
+        int32_t level = state.level * AUDIO_INPUT_LEVEL_GAIN;
+        if (level > 32768) level = 32768;
+        value = (value * level) >> 15;
+    }
+    return value;
+}
+
+void audio_input_get_stats(audio_input_stats_t *out) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    out->blocks = stats.blocks;
+    out->slips = stats.slips;
+    out->triggers = stats.triggers;
+    out->distance_min = stats.distance_min;
+    out->distance_max = stats.distance_max;
+    out->distance_total = stats.distance_total;
+    restore_interrupts(irq_state);
+}
+
+const char* audio_input_get_mod_name(audio_input_mod_t mod) {
+    switch (mod) {
+        case AUDIO_INPUT_MOD_OFF:  return "off";
+        case AUDIO_INPUT_MOD_RING: return "ring";
+        case AUDIO_INPUT_MOD_AM:   return "am";
+        default:                   return "unknown";
+    }
+}
+
+const char* audio_input_get_follow_name(audio_input_follow_t follow) {
+    switch (follow) {
+        case AUDIO_INPUT_FOLLOW_OFF:     return "off";
+        case AUDIO_INPUT_FOLLOW_LEVEL:   return "level";
+        case AUDIO_INPUT_FOLLOW_TRIGGER: return "trigger";
+        default:                         return "unknown";
+    }
+}
+
+void audio_input_print_status(void) {
+    if (!enabled) {
+        printf("Audio input: off (ADC%d/GPIO%d, its pot is held while on)\n",
+               AUDIO_INPUT_ADC_CHANNEL, 26 + AUDIO_INPUT_ADC_CHANNEL);
+        return;
+    }
+
+    audio_input_stats_t s;
+    audio_input_get_stats(&s);
+    printf("Audio input: ADC%d/GPIO%d, gain %ldx, follow %s (threshold %.0f%%), mod %s %.0f%%\n",
+           AUDIO_INPUT_ADC_CHANNEL, 26 + AUDIO_INPUT_ADC_CHANNEL, (long)input_gain,
+           audio_input_get_follow_name(follow_mode), threshold * 100.0f / 32767.0f,
+           audio_input_get_mod_name(mod_type), mod_depth * 100.0f / 32768.0f);
+    printf("  Envelope %.1f%% (attack %.1f ms, release %.1f ms), gate %s, %lu triggers\n",
+           (state.follower >> 15) * 100.0f / 32767.0f, attack_ms, release_ms,
+           state.gate ? "on" : "off", (unsigned long)s.triggers);
+    if (s.blocks > 0) {
+        // A frame read distance d behind the DMA reaches the pin d + 1 sample periods later
+        float sample_us = 1000000.0f / timebase_get_sample_rate();
+        printf("  ADC to output: min %.0f us, mean %.0f us, max %.0f us; %lu slips in %lu blocks\n",
+               (s.distance_min + 1) * sample_us, ((float)s.distance_total / s.blocks + 1.0f) * sample_us,
+               (s.distance_max + 1) * sample_us, (unsigned long)s.slips, (unsigned long)s.blocks);
+    }
+}
+
+void audio_input_benchmark(void) {
+    static const struct {
+        audio_input_mod_t mod;
+        audio_input_follow_t follow;
+        const char *label;
+    } steps[] = {
+        {AUDIO_INPUT_MOD_OFF,  AUDIO_INPUT_FOLLOW_OFF,   "follower only"},
+        {AUDIO_INPUT_MOD_OFF,  AUDIO_INPUT_FOLLOW_LEVEL, "level"},
+        {AUDIO_INPUT_MOD_RING, AUDIO_INPUT_FOLLOW_LEVEL, "ring + level"},
+        {AUDIO_INPUT_MOD_AM,   AUDIO_INPUT_FOLLOW_LEVEL, "am + level"},
+    };
+    uint32_t step_us[count_of(steps)];
+    volatile int32_t sink = 0;
+
+    if (!enabled) {
+        printf("Audio input is off ('input on' first)\n");
+        return;
+    }
+
+    // Scratch copy so nothing is gated; trigger mode stays out of the
+    // measurement because it would arm a latency trial
+    sound_system_t scratch = g_sound_system;
+    uint8_t saved_mod = mod_type;
+    uint8_t saved_follow = follow_mode;
+    int32_t saved_depth = mod_depth;
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+    input_state_t saved_state = state;
+    audio_input_stats_t saved_stats;
+    audio_input_get_stats(&saved_stats);
+
+    mod_depth = 32768;
+    for (uint i = 0; i < count_of(steps); i++) {
+        mod_type = steps[i].mod;
+        follow_mode = steps[i].follow;
+
+        uint64_t start = time_us_64();
+        for (int n = 0; n < AUDIO_INPUT_BENCH_SAMPLES; n++) {
+            audio_input_process(&scratch);
+            sink += audio_input_apply((n << 6) & 0x7FFF);
+        }
+        step_us[i] = (uint32_t)(time_us_64() - start);
+    }
+
+    mod_type = saved_mod;
+    follow_mode = saved_follow;
+    mod_depth = saved_depth;
+    state = saved_state;
+    stats.blocks = saved_stats.blocks;
+    stats.slips = saved_stats.slips;
+    stats.triggers = saved_stats.triggers;
+    stats.distance_min = saved_stats.distance_min;
+    stats.distance_max = saved_stats.distance_max;
+    stats.distance_total = saved_stats.distance_total;
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    float budget = cycles_per_us * 1000000.0f / AUDIO_INPUT_BENCH_RATE;
+    printf("Audio input benchmark (%.0f MHz, %d-sample blocks, %.0f cycle budget at %d Hz):\n",
+           cycles_per_us, AUDIO_INPUT_BLOCK_SIZE, budget, AUDIO_INPUT_BENCH_RATE);
+    printf("  Path          | Cycles/sample | Budget\n");
+    for (uint i = 0; i < count_of(steps); i++) {
+        float cycles = step_us[i] * cycles_per_us / AUDIO_INPUT_BENCH_SAMPLES;
+        printf("  %-13s | %13.1f | %5.2f%%\n", steps[i].label, cycles, cycles * 100.0f / budget);
+    }
+    printf("  (DMA fills the ring with no CPU time; the pot scan takes its readings from it)\n");
+}
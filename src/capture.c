@@ -0,0 +1,326 @@
+/**
+ * Audio Capture Implementation
+ *
+ * This module tees the rendered (post-envelope) sample stream into a RAM
+ * ring and sends it to the host as an 8-bit mono WAV over the USB CDC
+ * link. The sample interrupt only stores a byte; the transfer is queued
+ * from the main loop in chunks that fit the free USB buffer space, so it
+ * never blocks and never stalls the audio path. Data goes through the
+ * stdio USB driver directly: it takes the driver's lock like printf does,
+ * but skips the CRLF translation that would corrupt binary data. While a
+ * transfer runs, a gate driver replaces USB in the stdio driver list so
+ * console text from any module is dropped instead of landing in the WAV.
+ */
+
+#include "capture.h"
+#include "timebase.h"
+#include "pico/stdio_usb.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+#include <string.h>
+
+_Static_assert((CAPTURE_BUFFER_SIZE & (CAPTURE_BUFFER_SIZE - 1)) == 0,
+               "CAPTURE_BUFFER_SIZE must be a power of two");
+
+#define CAPTURE_MASK (CAPTURE_BUFFER_SIZE - 1)
+#define CAPTURE_UNBOUNDED 0xFFFFFFFFu   // Stream length / WAV size for continuous streams
+
+static uint8_t ring[CAPTURE_BUFFER_SIZE];
+
+// Shared with the sample interrupt
+static volatile uint8_t capture_mode = CAPTURE_OFF;
+static volatile bool ring_frozen = false;
+static volatile uint32_t write_count = 0;
+static volatile uint32_t read_count = 0;
+static volatile uint32_t dropped = 0;
+
+// Capture mode to return to after a transfer
+static bool ring_enabled = false;
+
+// Transfer state (main loop only)
+static bool transfer_active = false;
+static uint32_t transfer_remaining = 0;
+static uint32_t sent = 0;
+static uint8_t wav_header[CAPTURE_WAV_HEADER_SIZE];
+static uint8_t header_sent = 0;
+static uint32_t muted = 0;
+
+/**
+ * Stdio output during a transfer: count and drop the text
+ */
+static void capture_gate_out_chars(const char *buf, int len) {
+    (void)buf;
+    muted += len;
+}
+
+/**
+ * Stdio input during a transfer: still read USB so "capture stop" arrives
+ */
+static int capture_gate_in_chars(char *buf, int len) {
+    return stdio_usb.in_chars(buf, len);
+}
+
+static stdio_driver_t capture_gate = {
+    .out_chars = capture_gate_out_chars,
+    .in_chars = capture_gate_in_chars,
+};
+
+/**
+ * Route stdio through the gate (text muted) or back to USB
+ */
+static void capture_mute_stdio(bool mute) {
+    stdio_set_driver_enabled(&stdio_usb, !mute);
+    stdio_set_driver_enabled(&capture_gate, mute);
+}
+
+static void capture_put_u32(uint8_t *out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static void capture_put_u16(uint8_t *out, uint16_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+}
+
+/**
+ * Queue bytes to USB; count must not exceed tud_cdc_write_available()
+ */
+static void capture_write(const uint8_t *data, uint32_t count) {
+    stdio_usb.out_chars((const char *)data, count);
+}
+
+/**
+ * Fill wav_header for 8-bit unsigned mono PCM at the current sample rate
+ */
+static void capture_build_header(uint32_t data_bytes) {
+    uint32_t rate = (uint32_t)lroundf(timebase_get_sample_rate());
+    uint32_t riff_size = (data_bytes == CAPTURE_UNBOUNDED) ? CAPTURE_UNBOUNDED :
+                         data_bytes + CAPTURE_WAV_HEADER_SIZE - 8;
+
+    memcpy(&wav_header[0], "RIFF", 4);
+    capture_put_u32(&wav_header[4], riff_size);
+    memcpy(&wav_header[8], "WAVEfmt ", 8);
+    capture_put_u32(&wav_header[16], 16);       // fmt chunk size
+    capture_put_u16(&wav_header[20], 1);        // PCM
+    capture_put_u16(&wav_header[22], 1);        // Mono
+    capture_put_u32(&wav_header[24], rate);     // Sample rate
+    capture_put_u32(&wav_header[28], rate);     // Byte rate
+    capture_put_u16(&wav_header[32], 1);        // Block align
+    capture_put_u16(&wav_header[34], 8);        // Bits per sample
+    memcpy(&wav_header[36], "data", 4);
+    capture_put_u32(&wav_header[40], data_bytes);
+    header_sent = 0;
+}
+
+void capture_init(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    capture_mode = CAPTURE_OFF;
+    ring_frozen = false;
+    write_count = 0;
+    read_count = 0;
+    dropped = 0;
+    restore_interrupts(irq_state);
+
+    ring_enabled = false;
+    transfer_active = false;
+
+    printf("Capture initialized (%u-sample ring)\n", (unsigned)CAPTURE_BUFFER_SIZE);
+}
+
+void AUDIO_HOT_FUNC(capture_tap)(uint8_t sample) {
+    switch (capture_mode) {
+        case CAPTURE_RING:
+            if (ring_frozen) {
+                dropped++;
+            } else {
+                ring[write_count & CAPTURE_MASK] = sample;
+                write_count++;
+            }
+            break;
+        case CAPTURE_STREAM:
+            if (write_count - read_count < CAPTURE_BUFFER_SIZE) {
+                ring[write_count & CAPTURE_MASK] = sample;
+                write_count++;
+            } else {
+                dropped++;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void capture_set_ring(bool enabled) {
+    ring_enabled = enabled;
+    if (!transfer_active) {
+        capture_mode = enabled ? CAPTURE_RING : CAPTURE_OFF;
+    }
+}
+
+bool capture_start_dump(void) {
+    if (transfer_active || !stdio_usb_connected()) {
+        return false;
+    }
+
+    // Freeze the ring and send the newest CAPTURE_BUFFER_SIZE samples
+    uint32_t irq_state = save_and_disable_interrupts();
+    ring_frozen = true;
+    dropped = 0;
+    uint32_t available = (write_count < CAPTURE_BUFFER_SIZE) ? write_count : CAPTURE_BUFFER_SIZE;
+    read_count = write_count - available;
+    restore_interrupts(irq_state);
+
+    transfer_remaining = available;
+    sent = 0;
+    capture_build_header(available);
+    printf("WAV %lu\n", (unsigned long)(available + CAPTURE_WAV_HEADER_SIZE));
+    muted = 0;
+    capture_mute_stdio(true);
+    transfer_active = true;
+    return true;
+}
+
+bool capture_start_stream(float seconds) {
+    if (transfer_active || !stdio_usb_connected() || seconds < 0.0f) {
+        return false;
+    }
+
+    uint32_t samples = CAPTURE_UNBOUNDED;
+    if (seconds > 0.0f) {
+        samples = (uint32_t)(seconds * timebase_get_sample_rate());
+    }
+
+    // Start the FIFO empty so the stream begins with live audio
+    uint32_t irq_state = save_and_disable_interrupts();
+    read_count = write_count;
+    dropped = 0;
+    capture_mode = CAPTURE_STREAM;
+    restore_interrupts(irq_state);
+
+    transfer_remaining = samples;
+    sent = 0;
+    capture_build_header(samples);
+    if (samples == CAPTURE_UNBOUNDED) {
+        printf("WAV stream\n");
+    } else {
+        printf("WAV %lu\n", (unsigned long)(samples + CAPTURE_WAV_HEADER_SIZE));
+    }
+    muted = 0;
+    capture_mute_stdio(true);
+    transfer_active = true;
+    return true;
+}
+
+void capture_stop(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    capture_mode = ring_enabled ? CAPTURE_RING : CAPTURE_OFF;
+    ring_frozen = false;
+    restore_interrupts(irq_state);
+
+    if (transfer_active) {
+        transfer_active = false;
+        capture_mute_stdio(false);
+        printf("\nWAV END sent %lu dropped %lu muted %lu\n",
+               (unsigned long)sent, (unsigned long)dropped, (unsigned long)muted);
+    }
+}
+
+void capture_service(void) {
+    if (!transfer_active) {
+        return;
+    }
+    if (!stdio_usb_connected()) {
+        // Host went away; nothing to send to
+        capture_stop();
+        return;
+    }
+
+    uint32_t space = tud_cdc_write_available();
+
+    if (header_sent < CAPTURE_WAV_HEADER_SIZE) {
+        uint32_t count = CAPTURE_WAV_HEADER_SIZE - header_sent;
+        if (count > space) {
+            count = space;
+        }
+        capture_write(&wav_header[header_sent], count);
+        header_sent += count;
+        space -= count;
+        if (header_sent < CAPTURE_WAV_HEADER_SIZE) {
+            return;
+        }
+    }
+
+    uint32_t count = write_count - read_count;
+    if (count > transfer_remaining) {
+        count = transfer_remaining;
+    }
+    if (count > space) {
+        count = space;
+    }
+    if (count > CAPTURE_CHUNK_SIZE) {
+        count = CAPTURE_CHUNK_SIZE;
+    }
+
+    // Stop at the end of the ring; the rest goes out on the next call
+    uint32_t offset = read_count & CAPTURE_MASK;
+    if (count > CAPTURE_BUFFER_SIZE - offset) {
+        count = CAPTURE_BUFFER_SIZE - offset;
+    }
+
+    if (count > 0) {
+        capture_write(&ring[offset], count);
+        read_count += count;
+        sent += count;
+        if (transfer_remaining != CAPTURE_UNBOUNDED) {
+            transfer_remaining -= count;
+        }
+    }
+
+    if (transfer_remaining == 0) {
+        capture_stop();
+    }
+}
+
+uint32_t capture_copy_recent(uint8_t *dest, uint32_t count) {
+    uint32_t end = write_count;
+    if (count > CAPTURE_BUFFER_SIZE / 2) {
+        count = CAPTURE_BUFFER_SIZE / 2;
+    }
+    if (count > end) {
+        count = end;
+    }
+
+    // Two runs when the copy wraps the end of the ring
+    uint32_t start = (end - count) & CAPTURE_MASK;
+    uint32_t first = CAPTURE_BUFFER_SIZE - start;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(dest, &ring[start], first);
+    memcpy(dest + first, ring, count - first);
+    return count;
+}
+
+bool capture_is_transferring(void) {
+    return transfer_active;
+}
+
+void capture_get_stats(capture_stats_t *stats) {
+    stats->captured = write_count;
+    stats->dropped = dropped;
+    stats->sent = sent;
+}
+
+void capture_print_status(void) {
+    static const char *mode_names[] = {"off", "ring", "stream"};
+    capture_stats_t stats;
+    capture_get_stats(&stats);
+
+    printf("Capture: %s, %u-sample ring (%.2f s), %lu captured, %lu dropped, %lu sent\n",
+           mode_names[capture_mode], (unsigned)CAPTURE_BUFFER_SIZE,
+           CAPTURE_BUFFER_SIZE / timebase_get_sample_rate(),
+           (unsigned long)stats.captured, (unsigned long)stats.dropped, (unsigned long)stats.sent);
+}
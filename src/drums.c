@@ -0,0 +1,316 @@
+/**
+ * Drum Voice Implementation
+ *
+ * This module synthesizes a kick (sine with an exponential pitch sweep), a
+ * snare (sine body plus noise) and a hi-hat (one-pole high-passed noise).
+ * The snare and hat share one xorshift noise source, generated once per
+ * sample. Envelopes are Q30 integers decaying by a Q16 loss per sample, so
+ * the per-sample loop is a handful of multiplies per sounding voice and
+ * nothing at all when every voice is silent.
+ */
+
+#include "drums.h"
+#include "waveform_generator.h"
+#include "timebase.h"
+#include "uart_comm.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+#define DRUM_FULL_SCALE (1 << 30)   // Envelope at full level, Q30
+#define DRUM_SILENCE (1 << 16)      // Envelope below which a voice stops (~-84 dB)
+#define DRUM_BENCH_SAMPLES 4096     // Samples timed for the oscillator + drums step
+#define DRUM_BENCH_TRIGGERS 1024    // Triggers timed per voice
+
+// Settings and the coefficients derived from them
+typedef struct {
+    float tune;                     // Hz
+    float decay_ms;                 // Amplitude decay to -60 dB
+    float level;                    // 0.0-1.0
+    int32_t level_q15;
+    int32_t amp_decay;              // Amplitude loss per sample, Q16
+    int32_t sweep_decay;            // Kick pitch / snare tone loss per sample, Q16
+    uint32_t increment;             // Tone phase increment (kick: end of the sweep)
+    uint32_t sweep_step;            // Kick: extra increment at full sweep, >> 15
+    int32_t filter_coef;            // Hat low-pass coefficient, Q15
+} drum_settings_t;
+
+// Per-voice state, written by drums_trigger() and the sample interrupt
+typedef struct {
+    int32_t amp;                    // Amplitude envelope, Q30
+    int32_t sweep;                  // Kick pitch / snare tone envelope, Q30
+    uint32_t phase;
+    int32_t lowpass;                // Hat filter state, Q15
+} drum_state_t;
+
+static drum_settings_t settings[DRUM_VOICE_COUNT];
+static drum_state_t voices[DRUM_VOICE_COUNT];
+static volatile uint8_t active_voices = 0;  // Bit per sounding voice
+
+static uint32_t noise_state = 0x6C078965;
+
+/**
+ * Q16 loss per sample for a decay to -60 dB in decay_ms
+ */
+static int32_t drums_decay_loss(float decay_ms, float rate) {
+    float samples = decay_ms * rate / 1000.0f;
+    float coef = powf(10.0f, -3.0f / samples);
+    int32_t loss = (int32_t)lroundf((1.0f - coef) * 65536.0f);
+    return loss > 0 ? loss : 1;
+}
+
+static void drums_compute(drum_voice_t voice) {
+    drum_settings_t *s = &settings[voice];
+    float rate = timebase_get_sample_rate();
+    float tune = fminf(s->tune, rate * 0.45f);
+
+    s->level_q15 = (int32_t)(s->level * 32768.0f);
+    s->amp_decay = drums_decay_loss(s->decay_ms, rate);
+    s->increment = (uint32_t)(tune * 4294967296.0f / rate);
+    s->sweep_step = 0;
+    s->sweep_decay = 0;
+    s->filter_coef = 0;
+
+    switch (voice) {
+        case DRUM_KICK: {
+            float start = fminf(tune * DRUM_KICK_SWEEP, rate * 0.45f);
+            s->sweep_step = ((uint32_t)(start * 4294967296.0f / rate) - s->increment) >> 15;
+            s->sweep_decay = drums_decay_loss(DRUM_KICK_SWEEP_MS, rate);
+            break;
+        }
+        case DRUM_SNARE:
+            s->sweep_decay = drums_decay_loss(s->decay_ms * 0.5f, rate);
+            break;
+        case DRUM_HAT:
+            s->filter_coef = (int32_t)((1.0f - expf(-2.0f * (float)M_PI * tune / rate)) * 32768.0f);
+            break;
+        default:
+            break;
+    }
+}
+
+void drums_init(void) {
+    static const float defaults[DRUM_VOICE_COUNT][2] = {
+        {DRUM_KICK_TUNE, DRUM_KICK_DECAY_MS},
+        {DRUM_SNARE_TUNE, DRUM_SNARE_DECAY_MS},
+        {DRUM_HAT_TUNE, DRUM_HAT_DECAY_MS}
+    };
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        voices[i].amp = 0;
+        voices[i].sweep = 0;
+        settings[i].tune = defaults[i][0];
+        settings[i].decay_ms = defaults[i][1];
+        settings[i].level = 1.0f;
+        drums_compute(i);
+    }
+    active_voices = 0;
+    restore_interrupts(irq_state);
+
+    printf("Drums initialized (%d voices)\n", DRUM_VOICE_COUNT);
+}
+
+void drums_refresh_rates(void) {
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        drums_compute(i);
+    }
+}
+
+bool drums_set_voice(drum_voice_t voice, float tune, float decay_ms, float level) {
+    if (voice >= DRUM_VOICE_COUNT || tune < MIN_FREQUENCY || tune > MAX_FREQUENCY ||
+        decay_ms < DRUM_MIN_DECAY_MS || decay_ms > DRUM_MAX_DECAY_MS ||
+        level < 0.0f || level > 1.0f) {
+        return false;
+    }
+
+    // Each coefficient is one word; a hit in progress may use a mix for one sample
+    settings[voice].tune = tune;
+    settings[voice].decay_ms = decay_ms;
+    settings[voice].level = level;
+    drums_compute(voice);
+    return true;
+}
+
+void AUDIO_HOT_FUNC(drums_trigger)(drum_voice_t voice, int32_t velocity) {
+    if (voice >= DRUM_VOICE_COUNT) {
+        return;
+    }
+    int32_t amp = velocity * settings[voice].level_q15;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    voices[voice].amp = amp;
+    voices[voice].sweep = (voice == DRUM_SNARE) ? amp : DRUM_FULL_SCALE;
+    voices[voice].phase = 0;
+    active_voices |= 1u << voice;
+    restore_interrupts(irq_state);
+}
+
+static int32_t AUDIO_HOT_FUNC(drums_noise)(void) {
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    return (int32_t)(noise_state >> 16) - 32768;
+}
+
+static int32_t AUDIO_HOT_FUNC(drums_sine)(uint32_t phase) {
+    return ((int32_t)generate_sine_wave(phase >> 16) - 128) << 8;
+}
+
+int32_t AUDIO_HOT_FUNC(drums_process)(void) {
+    uint8_t active = active_voices;
+    if (active == 0) {
+        return 0;
+    }
+
+    int32_t mix = 0;
+    int32_t noise = 0;
+    if (active & ((1u << DRUM_SNARE) | (1u << DRUM_HAT))) {
+        noise = drums_noise();
+    }
+
+    if (active & (1u << DRUM_KICK)) {
+        drum_state_t *v = &voices[DRUM_KICK];
+        const drum_settings_t *s = &settings[DRUM_KICK];
+        mix += (drums_sine(v->phase) * (v->amp >> 15)) >> 15;
+        v->phase += s->increment + (uint32_t)(v->sweep >> 15) * s->sweep_step;
+        v->sweep -= (v->sweep >> 16) * s->sweep_decay;
+        v->amp -= (v->amp >> 16) * s->amp_decay;
+        if (v->amp < DRUM_SILENCE) {
+            v->amp = 0;
+            active &= ~(1u << DRUM_KICK);
+        }
+    }
+
+    if (active & (1u << DRUM_SNARE)) {
+        drum_state_t *v = &voices[DRUM_SNARE];
+        const drum_settings_t *s = &settings[DRUM_SNARE];
+        // Half body, half noise
+        mix += (drums_sine(v->phase) * (v->sweep >> 15) + noise * (v->amp >> 15)) >> 16;
+        v->phase += s->increment;
+        v->sweep -= (v->sweep >> 16) * s->sweep_decay;
+        v->amp -= (v->amp >> 16) * s->amp_decay;
+        if (v->amp < DRUM_SILENCE) {
+            v->amp = 0;
+            active &= ~(1u << DRUM_SNARE);
+        }
+    }
+
+    if (active & (1u << DRUM_HAT)) {
+        drum_state_t *v = &voices[DRUM_HAT];
+        const drum_settings_t *s = &settings[DRUM_HAT];
+        v->lowpass += ((noise - v->lowpass) * s->filter_coef) >> 15;
+        // The high-passed noise spans twice the Q15 range and the envelope
+        // is Q14 here, so one extra bit of shift brings the peak to full scale
+        mix += ((noise - v->lowpass) * (v->amp >> 16)) >> 15;
+        v->amp -= (v->amp >> 16) * s->amp_decay;
+        if (v->amp < DRUM_SILENCE) {
+            v->amp = 0;
+            active &= ~(1u << DRUM_HAT);
+        }
+    }
+
+    active_voices = active;
+
+    if (mix > 32767) mix = 32767;
+    if (mix < -32768) mix = -32768;
+    return mix;
+}
+
+bool AUDIO_HOT_FUNC(drums_active)(void) {
+    return active_voices != 0;
+}
+
+const char* drums_get_voice_name(drum_voice_t voice) {
+    switch (voice) {
+        case DRUM_KICK:  return "kick";
+        case DRUM_SNARE: return "snare";
+        case DRUM_HAT:   return "hat";
+        default:         return "unknown";
+    }
+}
+
+void drums_print_status(void) {
+    printf("Drums:");
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        printf(" %s %.0f Hz %.0f ms %.0f%%%s", drums_get_voice_name(i), settings[i].tune,
+               settings[i].decay_ms, settings[i].level * 100.0f,
+               (active_voices & (1u << i)) ? " (sounding)" : "");
+        printf(i < DRUM_VOICE_COUNT - 1 ? "," : "\n");
+    }
+}
+
+void drums_benchmark(sound_system_t *system) {
+    uint32_t hit_us[DRUM_VOICE_COUNT];
+    uint32_t hit_samples[DRUM_VOICE_COUNT];
+    uint32_t trigger_us[DRUM_VOICE_COUNT];
+    uint32_t mix_us;
+    sound_system_t scratch = *system;
+
+    scratch.adsr_state = ADSR_SUSTAIN;
+    scratch.envelope_level = scratch.sustain_level;
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+    drum_state_t saved_voices[DRUM_VOICE_COUNT];
+    uint8_t saved_active = active_voices;
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        saved_voices[i] = voices[i];
+    }
+
+    // One full hit per voice, from the trigger until the voice stops
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        active_voices = 0;
+        uint64_t start = time_us_64();
+        for (int n = 0; n < DRUM_BENCH_TRIGGERS; n++) {
+            drums_trigger(i, 32768);
+        }
+        trigger_us[i] = (uint32_t)(time_us_64() - start);
+
+        uint32_t samples = 0;
+        start = time_us_64();
+        while (drums_active()) {
+            drums_process();
+            samples++;
+        }
+        hit_us[i] = (uint32_t)(time_us_64() - start);
+        hit_samples[i] = samples;
+    }
+
+    // Oscillator with all three voices sounding
+    active_voices = 0;
+    uint64_t start = time_us_64();
+    for (int n = 0; n < DRUM_BENCH_SAMPLES; n++) {
+        if (active_voices != (1u << DRUM_VOICE_COUNT) - 1) {
+            for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+                if (!(active_voices & (1u << i))) {
+                    drums_trigger(i, 32768);
+                }
+            }
+        }
+        generate_waveform_sample(&scratch);
+    }
+    mix_us = (uint32_t)(time_us_64() - start);
+
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        voices[i] = saved_voices[i];
+    }
+    active_voices = saved_active;
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    float rate = timebase_get_sample_rate();
+    float budget = clock_get_hz(clk_sys) / rate;
+    printf("Drum benchmark (%.0f MHz, %.0f cycles per sample at %.0f Hz):\n",
+           cycles_per_us, budget, rate);
+    printf("  Voice | Samples/hit | Cycles/sample | Cycles/hit | Trigger cycles\n");
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        float hit_cycles = hit_us[i] * cycles_per_us;
+        printf("  %-5s | %11lu | %13.1f | %10.0f | %14.1f\n", drums_get_voice_name(i),
+               (unsigned long)hit_samples[i],
+               hit_samples[i] ? hit_cycles / hit_samples[i] : 0.0f, hit_cycles,
+               trigger_us[i] * cycles_per_us / DRUM_BENCH_TRIGGERS);
+    }
+    float mix_cycles = mix_us * cycles_per_us / DRUM_BENCH_SAMPLES;
+    printf("  %s + all drums: %.1f cycles/sample (%.0f%% of the sample period)\n",
+           uart_get_waveform_name(scratch.current_waveform), mix_cycles, 100.0f * mix_cycles / budget);
+}
@@ -0,0 +1,443 @@
+/**
+ * Granular Synthesis Implementation
+ *
+ * This module plays up to GRANULAR_MAX_GRAINS short Hann-windowed grains
+ * from a source buffer: a snapshot of the capture ring in RAM, or a sample
+ * image in flash. Sources are a power of two long, so a grain's read
+ * position is a 32-bit phase accumulator over the whole source, exactly
+ * like the oscillator's, and wraps for free. The window is a second phase
+ * accumulator that ends the grain when it wraps.
+ *
+ * The grain pool is a fixed array owned by the sample interrupt: grains are
+ * started at their exact sample inside each block and finished grains are
+ * replaced by the last active one, so there is no allocation and no list.
+ * Settings reach the interrupt through a double-buffered parameter set that
+ * the main loop fills and publishes with a single index write; neither side
+ * waits on the other or masks interrupts. Grains only render while their
+ * source is the published one, so once the main loop has published "no
+ * source" the interrupt no longer reads the capture snapshot and it can be
+ * rewritten in place.
+ */
+
+#include "granular.h"
+#include "capture.h"
+#include "waveform_generator.h"
+#include "timebase.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/regs/addressmap.h"
+#include <string.h>
+
+_Static_assert(GRANULAR_MAX_GRAINS <= 255, "GRANULAR_MAX_GRAINS must fit the grain counters");
+_Static_assert((1 << GRANULAR_CAPTURE_BITS) <= CAPTURE_BUFFER_SIZE / 2,
+               "The capture snapshot must fit in half the capture ring");
+
+#define GRANULAR_CAPTURE_SIZE (1 << GRANULAR_CAPTURE_BITS)
+#define GRANULAR_WINDOW_SIZE (1 << GRANULAR_WINDOW_BITS)
+#define GRANULAR_WINDOW_SHIFT (32 - GRANULAR_WINDOW_BITS)
+#define GRANULAR_BENCH_SAMPLES 4096     // Samples timed per benchmark step
+#define GRANULAR_BENCH_RATE 44100       // Sample rate the budget is reported for
+
+// One grain; both positions are 32-bit phases over their full range
+typedef struct {
+    const int8_t *data;
+    uint32_t position;                  // Source phase, index = position >> shift
+    uint32_t increment;                 // Source phase per output sample (pitch)
+    uint32_t window_phase;              // Grain ends when this wraps
+    uint32_t window_increment;
+    uint32_t mask;                      // Source length - 1
+    uint8_t shift;                      // 32 - log2(source length)
+    uint8_t delay;                      // Samples into the current block before the grain starts
+} grain_t;
+
+// Everything the sample interrupt reads, published as a whole
+typedef struct {
+    const int8_t *data;                 // NULL = no source
+    uint8_t bits;                       // log2 of the source length
+    float pitch_scale;                  // Grain increment per oscillator phase increment
+    uint32_t window_increment;          // 2^32 / grain length in samples
+    uint32_t interval;                  // Samples between grain starts
+    uint32_t jitter;                    // Random interval range in samples
+    uint32_t position;                  // Start phase
+    uint32_t spray;                     // Random start phase range
+    int32_t gain;                       // Q15 output gain for the expected overlap
+} granular_params_t;
+
+// Q15 Hann window, one grain
+static int16_t window[GRANULAR_WINDOW_SIZE];
+
+// Capture snapshot, signed
+static int8_t capture_source[GRANULAR_CAPTURE_SIZE];
+
+// Settings (main loop only)
+static granular_source_t source = GRANULAR_SOURCE_NONE;
+static const int8_t *source_data = NULL;
+static uint8_t source_bits = 0;
+static float source_rate = 0.0f;
+static float density = 40.0f;           // Grains per second
+static float size_ms = 80.0f;
+static float spray = 0.1f;              // Fraction of the source
+static float jitter = 0.5f;
+static float position = 0.5f;
+
+// Published parameters; the interrupt reads params[active_params]
+static granular_params_t params[2];
+static volatile uint8_t active_params = 0;
+
+// Grain pool and scheduler (sample interrupt only)
+static grain_t pool[GRANULAR_MAX_GRAINS];
+static uint8_t active_count = 0;
+static uint32_t spawn_countdown = 0;
+static uint32_t random_state = 0x6D2B79F5u;
+static volatile granular_stats_t stats;
+
+// Rendered block, consumed one sample per interrupt (Q15)
+static int32_t block[GRANULAR_BLOCK_SIZE];
+static uint8_t block_position = GRANULAR_BLOCK_SIZE;
+
+static inline uint32_t granular_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+/**
+ * Uniform random value in [0, range) without a division
+ */
+static inline uint32_t granular_random_below(uint32_t range) {
+    return (uint32_t)(((uint64_t)granular_random() * range) >> 32);
+}
+
+/**
+ * Build a parameter set from the settings and hand it to the sample interrupt
+ */
+static void granular_publish(void) {
+    float rate = timebase_get_sample_rate();
+    float length = rate * size_ms / 1000.0f;
+    float interval = rate / density;
+    float overlap = density * size_ms / 1000.0f;
+
+    uint8_t next = active_params ^ 1;
+    granular_params_t *p = &params[next];
+    p->data = source_data;
+    p->bits = source_bits;
+    p->pitch_scale = source_data ? source_rate / (GRANULAR_ROOT_FREQUENCY * (float)(1u << source_bits)) : 0.0f;
+    p->window_increment = (uint32_t)(4294967296.0f / length) + 1;
+    p->interval = interval > 1.0f ? (uint32_t)interval : 1;
+    p->jitter = (uint32_t)(2.0f * jitter * p->interval);
+    p->position = (uint32_t)(position * 4294967295.0f);
+    p->spray = (uint32_t)(spray * 4294967295.0f);
+    // Uncorrelated grains add up as the square root of their number
+    p->gain = (int32_t)(32767.0f / sqrtf(overlap > 1.0f ? overlap : 1.0f));
+
+    // The interrupt cannot run in the middle of this store
+    active_params = next;
+}
+
+void granular_init(void) {
+    for (int i = 0; i < GRANULAR_WINDOW_SIZE; i++) {
+        window[i] = (int16_t)lroundf(32767.0f * (0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / GRANULAR_WINDOW_SIZE)));
+    }
+    memset(capture_source, 0, sizeof(capture_source));
+    source = GRANULAR_SOURCE_NONE;
+    source_data = NULL;
+    granular_publish();
+
+    printf("Granular synthesis initialized (%d grains, %d-sample windows, %.2f s capture snapshot)\n",
+           GRANULAR_MAX_GRAINS, GRANULAR_WINDOW_SIZE, GRANULAR_CAPTURE_SIZE / timebase_get_sample_rate());
+}
+
+void granular_refresh_rates(void) {
+    granular_publish();
+}
+
+bool granular_load_source(granular_source_t new_source) {
+    if (new_source == GRANULAR_SOURCE_CAPTURE) {
+        capture_stats_t captured;
+        capture_get_stats(&captured);
+        if (captured.captured == 0) {
+            return false;
+        }
+
+        // Unpublish the source first: every interrupt from here on retires
+        // the grains still on it instead of reading the snapshot
+        source = GRANULAR_SOURCE_NONE;
+        source_data = NULL;
+        granular_publish();
+        __dmb();
+
+        uint32_t count = capture_copy_recent((uint8_t *)capture_source, GRANULAR_CAPTURE_SIZE);
+        for (uint32_t i = 0; i < count; i++) {
+            capture_source[i] = (int8_t)((uint8_t)capture_source[i] - 128);
+        }
+        memset(&capture_source[count], 0, GRANULAR_CAPTURE_SIZE - count);
+        source_data = capture_source;
+        source_bits = GRANULAR_CAPTURE_BITS;
+        source_rate = timebase_get_sample_rate();
+    } else if (new_source == GRANULAR_SOURCE_FLASH) {
+        const granular_image_header_t *image =
+            (const granular_image_header_t *)(XIP_BASE + GRANULAR_FLASH_OFFSET);
+        if (image->magic != GRANULAR_IMAGE_MAGIC ||
+            image->length_bits < GRANULAR_MIN_SOURCE_BITS || image->length_bits > GRANULAR_MAX_SOURCE_BITS ||
+            image->sample_rate < 8000 || image->sample_rate > 192000) {
+            return false;
+        }
+        source_data = (const int8_t *)(image + 1);
+        source_bits = image->length_bits;
+        source_rate = image->sample_rate;
+    } else {
+        return false;
+    }
+
+    source = new_source;
+    granular_publish();
+    return true;
+}
+
+bool granular_set_scheduler(float new_density, float new_size_ms, float new_spray, float new_jitter) {
+    if (new_density < GRANULAR_MIN_DENSITY || new_density > GRANULAR_MAX_DENSITY ||
+        new_size_ms < GRANULAR_MIN_SIZE_MS || new_size_ms > GRANULAR_MAX_SIZE_MS ||
+        new_spray < 0.0f || new_spray > 1.0f || new_jitter < 0.0f || new_jitter > 1.0f) {
+        return false;
+    }
+    density = new_density;
+    size_ms = new_size_ms;
+    spray = new_spray;
+    jitter = new_jitter;
+    granular_publish();
+    return true;
+}
+
+void granular_set_position(float new_position) {
+    if (new_position < 0.0f) new_position = 0.0f;
+    if (new_position > 1.0f) new_position = 1.0f;
+    position = new_position;
+    granular_publish();
+}
+
+/**
+ * Start a grain delay samples into the next block
+ */
+static void AUDIO_HOT_FUNC(granular_spawn)(const granular_params_t *p, uint32_t phase_increment, uint32_t delay) {
+    if (active_count == GRANULAR_MAX_GRAINS) {
+        stats.skipped++;
+        return;
+    }
+
+    grain_t *grain = &pool[active_count++];
+    grain->data = p->data;
+    grain->position = p->position + granular_random_below(p->spray);
+    grain->increment = (uint32_t)(phase_increment * p->pitch_scale);
+    grain->window_phase = 0;
+    grain->window_increment = p->window_increment;
+    grain->mask = (1u << p->bits) - 1;
+    grain->shift = 32 - p->bits;
+    grain->delay = delay;
+    stats.spawned++;
+}
+
+/**
+ * Render count samples of every active grain into out (Q15), retiring
+ * grains whose window has ended or whose source is no longer published
+ */
+static void AUDIO_HOT_FUNC(granular_render_block)(int32_t *out, uint32_t count, const int8_t *source_buffer,
+                                                  int32_t gain) {
+    for (uint32_t n = 0; n < count; n++) {
+        out[n] = 0;
+    }
+
+    uint32_t i = 0;
+    while (i < active_count) {
+        grain_t *grain = &pool[i];
+        const int8_t *data = grain->data;
+        if (data != source_buffer) {
+            // The main loop may be rewriting the old source
+            *grain = pool[--active_count];
+            continue;
+        }
+        uint32_t pos = grain->position;
+        uint32_t increment = grain->increment;
+        uint32_t window_phase = grain->window_phase;
+        uint32_t window_increment = grain->window_increment;
+        uint32_t mask = grain->mask;
+        uint32_t shift = grain->shift;
+        bool finished = false;
+
+        for (uint32_t n = grain->delay; n < count; n++) {
+            // Linear interpolation with the top 8 bits of the fractional position
+            uint32_t index = pos >> shift;
+            int32_t s0 = data[index];
+            int32_t s1 = data[(index + 1) & mask];
+            int32_t frac = (pos >> (shift - 8)) & 0xFF;
+            int32_t value = (s0 << 8) + (s1 - s0) * frac;
+
+            out[n] += (value * window[window_phase >> GRANULAR_WINDOW_SHIFT]) >> 15;
+            pos += increment;
+
+            uint32_t next = window_phase + window_increment;
+            if (next < window_phase) {
+                finished = true;
+                break;
+            }
+            window_phase = next;
+        }
+
+        if (finished) {
+            // The last grain has not been rendered yet; it takes this slot
+            *grain = pool[--active_count];
+            continue;
+        }
+        grain->position = pos;
+        grain->window_phase = window_phase;
+        grain->delay = 0;
+        i++;
+    }
+
+    for (uint32_t n = 0; n < count; n++) {
+        int32_t value = (int32_t)(((int64_t)out[n] * gain) >> 15);
+        if (value > 32767) value = 32767;
+        if (value < -32768) value = -32768;
+        out[n] = value;
+    }
+}
+
+int32_t AUDIO_HOT_FUNC(granular_process)(uint32_t phase_increment) {
+    if (block_position == GRANULAR_BLOCK_SIZE) {
+        const granular_params_t *p = &params[active_params];
+
+        if (p->data) {
+            // A density change takes effect at once rather than after the old interval
+            if (spawn_countdown > p->interval + p->jitter) {
+                spawn_countdown = p->interval;
+            }
+            // Start each grain due in this block on its exact sample; pitch
+            // (including modulation) is picked up when a grain starts
+            while (spawn_countdown < GRANULAR_BLOCK_SIZE) {
+                granular_spawn(p, phase_increment, spawn_countdown);
+                uint32_t interval = p->interval - p->jitter / 2 + granular_random_below(p->jitter + 1);
+                spawn_countdown += interval ? interval : 1;
+            }
+            spawn_countdown -= GRANULAR_BLOCK_SIZE;
+        }
+
+        granular_render_block(block, GRANULAR_BLOCK_SIZE, p->data, p->gain);
+        stats.active = active_count;
+        if (active_count > stats.peak) {
+            stats.peak = active_count;
+        }
+        block_position = 0;
+    }
+    return block[block_position++];
+}
+
+void granular_get_stats(granular_stats_t *out) {
+    out->spawned = stats.spawned;
+    out->skipped = stats.skipped;
+    out->active = stats.active;
+    out->peak = stats.peak;
+}
+
+const char* granular_get_source_name(granular_source_t source_id) {
+    switch (source_id) {
+        case GRANULAR_SOURCE_NONE:    return "none";
+        case GRANULAR_SOURCE_CAPTURE: return "capture";
+        case GRANULAR_SOURCE_FLASH:   return "flash";
+        default:                      return "unknown";
+    }
+}
+
+void granular_print_status(void) {
+    granular_stats_t s;
+    granular_get_stats(&s);
+
+    if (source == GRANULAR_SOURCE_NONE) {
+        printf("Granular: no source ('capture on', then 'granular capture'), %d-grain pool\n",
+               GRANULAR_MAX_GRAINS);
+    } else {
+        printf("Granular: %s source, %lu samples (%.2f s at %.0f Hz), %d-grain pool\n",
+               granular_get_source_name(source), (unsigned long)(1u << source_bits),
+               (1u << source_bits) / source_rate, source_rate, GRANULAR_MAX_GRAINS);
+    }
+    printf("  Scheduler: %.1f grains/s, %.1f ms, position %.0f%%, spray %.0f%%, jitter %.0f%%\n",
+           density, size_ms, position * 100.0f, spray * 100.0f, jitter * 100.0f);
+    printf("  Grains: %d active, %d peak, %lu started, %lu skipped (pool full)\n",
+           s.active, s.peak, (unsigned long)s.spawned, (unsigned long)s.skipped);
+}
+
+void granular_benchmark(void) {
+    static const uint8_t counts[] = {1, 8, 16, 32, 48, 64};
+    static grain_t saved_pool[GRANULAR_MAX_GRAINS];
+    static int32_t bench_block[GRANULAR_BLOCK_SIZE];
+    uint32_t block_us[count_of(counts)];
+
+    // Measure with the current source so flash cache misses are included
+    const int8_t *data = source_data ? source_data : capture_source;
+    uint8_t bits = source_data ? source_bits : GRANULAR_CAPTURE_BITS;
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+    uint8_t saved_count = active_count;
+    memcpy(saved_pool, pool, sizeof(pool));
+
+    for (uint i = 0; i < count_of(counts); i++) {
+        // Grains spread over the source, unshifted pitch, windows that
+        // cannot end during the measurement
+        active_count = (counts[i] < GRANULAR_MAX_GRAINS) ? counts[i] : GRANULAR_MAX_GRAINS;
+        for (int g = 0; g < active_count; g++) {
+            pool[g] = (grain_t){
+                .data = data,
+                .position = granular_random(),
+                .increment = 1u << (32 - bits),
+                .window_phase = 0x40000000u,
+                .window_increment = 1,
+                .mask = (1u << bits) - 1,
+                .shift = 32 - bits,
+                .delay = 0
+            };
+        }
+
+        uint64_t start = time_us_64();
+        for (int n = 0; n < GRANULAR_BENCH_SAMPLES; n += GRANULAR_BLOCK_SIZE) {
+            granular_render_block(bench_block, GRANULAR_BLOCK_SIZE, data, 32767);
+        }
+        block_us[i] = (uint32_t)(time_us_64() - start);
+    }
+
+    memcpy(pool, saved_pool, sizeof(pool));
+    active_count = saved_count;
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    printf("Granular benchmark (%.0f MHz, %s source, %d-sample blocks):\n", cycles_per_us,
+           granular_get_source_name(source_data ? source : GRANULAR_SOURCE_CAPTURE), GRANULAR_BLOCK_SIZE);
+    printf("  Grains | Cycles/sample\n");
+    for (uint i = 0; i < count_of(counts); i++) {
+        if (counts[i] > GRANULAR_MAX_GRAINS) {
+            continue;
+        }
+        printf("  %6d | %13.1f\n", counts[i], block_us[i] * cycles_per_us / GRANULAR_BENCH_SAMPLES);
+    }
+
+    // Cost of one more grain from the two largest measured counts, against
+    // the budget left in a sample period by the rest of the interrupt
+    uint last = count_of(counts) - 1;
+    while (last > 1 && counts[last] > GRANULAR_MAX_GRAINS) {
+        last--;
+    }
+    float per_grain = (block_us[last] - block_us[0]) * cycles_per_us /
+                      ((float)GRANULAR_BENCH_SAMPLES * (counts[last] - counts[0]));
+    float fixed = block_us[0] * cycles_per_us / GRANULAR_BENCH_SAMPLES - per_grain;
+
+    isr_stats_t isr;
+    waveform_get_isr_stats(&isr);
+    float isr_load = isr.count ? (float)isr.total_duration / isr.count : 0.0f;
+    float budget = cycles_per_us * 1000000.0f / GRANULAR_BENCH_RATE;
+    printf("  %.2f cycles per grain-sample, %.0f cycle budget at %d Hz (ISR average %.0f)\n",
+           per_grain, budget, GRANULAR_BENCH_RATE, isr_load);
+    if (per_grain > 0.0f) {
+        int fit = (int)((budget - isr_load - fixed) / per_grain);
+        printf("  Concurrent grains that fit at %d Hz: %d (pool holds %d)\n",
+               GRANULAR_BENCH_RATE, fit, GRANULAR_MAX_GRAINS);
+    }
+}
@@ -0,0 +1,316 @@
+/**
+ * Karplus-Strong Implementation
+ *
+ * This module implements an extended Karplus-Strong plucked string. Each
+ * string is a noise-filled delay line fed back through a one-zero damping
+ * filter and a first-order allpass that supplies the fractional part of the
+ * period, so strings stay in tune at high pitches. Delay lines come from a
+ * fixed pool sized for MIN_FREQUENCY at the highest sample rate; the
+ * per-sample loop is integer only.
+ */
+
+#include "karplus_strong.h"
+#include "waveform_generator.h"
+#include "timebase.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+
+#define KS_MIN_LENGTH 2             // Shortest usable delay line
+#define KS_ALLPASS_MIN_DELAY 0.1f   // Allpass delay range is 0.1-1.1 samples
+#define KS_PLUCK_LEVEL 16384        // Excitation noise amplitude, Q15
+#define KS_SILENCE_LEVEL 64         // Peak below which a string is released (below 8-bit LSB)
+#define KS_MAX_LOSS 32767           // Loop gain limit, Q15
+#define KS_BENCH_SAMPLES 4096       // Samples timed per benchmark step
+#define KS_BENCH_RATE 44100         // Sample rate the string count is reported for
+
+typedef struct {
+    int16_t *line;              // Delay line from the pool, NULL when silent
+    uint16_t length;            // Integer part of the loop delay
+    uint16_t position;          // Read/write index
+    int32_t last;               // Previous delay output (damping filter state)
+    int32_t allpass_in;         // Allpass x[n-1]
+    int32_t allpass_out;        // Allpass y[n-1]
+    int32_t allpass_coef;       // Fractional delay coefficient, Q15
+    int32_t smoothing;          // Damping filter weight of the previous sample, Q15
+    int32_t loss;               // Per-trip gain, Q15
+    int32_t loss_error;         // Rounding error carried into the next loss product
+    int32_t peak;               // Largest output over the current period
+    uint32_t serial;            // Pluck order, oldest is stolen first
+    uint32_t start;             // Sample count at which the string starts sounding
+} ks_string_t;
+
+// Fixed pool of delay lines and a stack of free line indices
+static int16_t delay_pool[KS_POOL_LINES][KS_DELAY_MAX_LENGTH];
+static uint8_t pool_free_list[KS_POOL_LINES];
+static volatile uint8_t pool_free_count;
+
+static ks_string_t strings[KS_MAX_STRINGS];
+static uint32_t pluck_serial = 0;
+
+static float decay_time = KS_DEFAULT_DECAY;
+static float brightness = KS_DEFAULT_BRIGHTNESS;
+
+static uint32_t noise_state = 0x9E3779B9;
+
+static int16_t *ks_pool_alloc(void) {
+    if (pool_free_count == 0) {
+        return NULL;
+    }
+    return delay_pool[pool_free_list[--pool_free_count]];
+}
+
+static void AUDIO_HOT_FUNC(ks_pool_free)(int16_t *line) {
+    pool_free_list[pool_free_count++] = (uint8_t)((line - delay_pool[0]) / KS_DELAY_MAX_LENGTH);
+}
+
+static int32_t ks_noise(void) {
+    noise_state ^= noise_state << 13;
+    noise_state ^= noise_state >> 17;
+    noise_state ^= noise_state << 5;
+    return (int32_t)(noise_state >> 16) - 32768;
+}
+
+void ks_init(void) {
+    ks_reset();
+    decay_time = KS_DEFAULT_DECAY;
+    brightness = KS_DEFAULT_BRIGHTNESS;
+
+    printf("Karplus-Strong initialized (%d strings, %u-sample delay lines)\n",
+           KS_MAX_STRINGS, (unsigned)KS_DELAY_MAX_LENGTH);
+}
+
+void ks_reset(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (int i = 0; i < KS_MAX_STRINGS; i++) {
+        strings[i].line = NULL;
+    }
+    for (int i = 0; i < KS_POOL_LINES; i++) {
+        pool_free_list[i] = i;
+    }
+    pool_free_count = KS_POOL_LINES;
+    restore_interrupts(irq_state);
+}
+
+bool ks_set_damping(float decay, float bright) {
+    if (decay <= 0.0f || bright < 0.0f || bright > 1.0f) {
+        return false;
+    }
+    decay_time = decay;
+    brightness = bright;
+    return true;
+}
+
+bool ks_pluck(float frequency) {
+    return ks_pluck_at(frequency, timebase_get_sample_count());
+}
+
+bool ks_pluck_at(float frequency, uint32_t start_sample) {
+    float rate = timebase_get_sample_rate();
+    float w = 2.0f * (float)M_PI * frequency / rate;
+
+    // Gain per trip round the loop so the fundamental falls 60 dB in decay_time
+    float trip_gain = powf(10.0f, -3.0f / (frequency * decay_time));
+
+    // Damping filter y = (1 - s) x[n] + s x[n-1], |H|^2 = 1 - 2s(1 - s)(1 - cos w).
+    // High strings make many trips per second; where the filter would take
+    // more than half of the requested loss (in dB), s is reduced to that
+    // (decay stretching) so high notes still ring. The rest comes from the
+    // loss multiply, which keeps decaying where the rounded filter stalls.
+    float s = 0.5f * (1.0f - brightness);
+    float max_loss = (1.0f - trip_gain) / (2.0f * (1.0f - cosf(w)));
+    if (s * (1.0f - s) > max_loss) {
+        s = 0.5f * (1.0f - sqrtf(1.0f - 4.0f * max_loss));
+    }
+
+    // The filter's delay and gain at the fundamental are taken out of the
+    // delay line and the loop loss
+    float re = (1.0f - s) + s * cosf(w);
+    float im = s * sinf(w);
+    float filter_delay = atan2f(im, re) / w;
+    float filter_gain = sqrtf(re * re + im * im);
+
+    float remaining = rate / frequency - filter_delay;
+    int32_t length = (int32_t)(remaining - KS_ALLPASS_MIN_DELAY);
+    if (length < KS_MIN_LENGTH || length > KS_DELAY_MAX_LENGTH) {
+        return false;
+    }
+    // Allpass coefficient with exactly the remaining phase delay at the fundamental
+    float fraction = remaining - length;
+    float allpass_coef = sinf(0.5f * w * (1.0f - fraction)) / sinf(0.5f * w * (1.0f + fraction));
+
+    int32_t loss = (int32_t)(trip_gain / filter_gain * 32768.0f);
+    if (loss > KS_MAX_LOSS) {
+        loss = KS_MAX_LOSS;
+    }
+
+    // Take a free slot, or stop the oldest string and reuse its line
+    uint32_t irq_state = save_and_disable_interrupts();
+    ks_string_t *string = NULL;
+    int16_t *line = NULL;
+    for (int i = 0; i < KS_MAX_STRINGS; i++) {
+        if (strings[i].line == NULL) {
+            string = &strings[i];
+            line = ks_pool_alloc();
+            break;
+        }
+    }
+    if (line == NULL) {
+        string = &strings[0];
+        for (int i = 1; i < KS_MAX_STRINGS; i++) {
+            if (strings[i].serial < string->serial) {
+                string = &strings[i];
+            }
+        }
+        line = string->line;
+        string->line = NULL;
+    }
+    restore_interrupts(irq_state);
+
+    // Fill the excitation outside the critical section, with the mean removed
+    int32_t sum = 0;
+    for (int i = 0; i < length; i++) {
+        line[i] = (int16_t)((ks_noise() * KS_PLUCK_LEVEL) >> 15);
+        sum += line[i];
+    }
+    int32_t mean = sum / length;
+    for (int i = 0; i < length; i++) {
+        line[i] -= mean;
+    }
+
+    ks_string_t tuned = {
+        .line = line,
+        .length = (uint16_t)length,
+        .position = 0,
+        .last = 0,
+        .allpass_in = 0,
+        .allpass_out = 0,
+        .allpass_coef = (int32_t)(allpass_coef * 32768.0f),
+        .smoothing = (int32_t)(s * 32768.0f),
+        .loss = loss,
+        .loss_error = 0,
+        .peak = 0,
+        .serial = ++pluck_serial,
+        .start = start_sample
+    };
+
+    irq_state = save_and_disable_interrupts();
+    *string = tuned;
+    restore_interrupts(irq_state);
+    return true;
+}
+
+int32_t AUDIO_HOT_FUNC(ks_process)(void) {
+    uint32_t now = timebase_get_sample_count();
+    int32_t mix = 0;
+
+    for (int i = 0; i < KS_MAX_STRINGS; i++) {
+        ks_string_t *string = &strings[i];
+        if (string->line == NULL) {
+            continue;
+        }
+        if ((int32_t)(now - string->start) < 0) {
+            continue;
+        }
+
+        int32_t x = string->line[string->position];
+
+        // Damping: one-zero low-pass and per-trip loss. Products are rounded
+        // (truncation biases every trip and builds a DC offset). The loss is
+        // within a few LSB of unity, so its rounding error is carried to the
+        // next sample; otherwise quiet strings would stop decaying.
+        int32_t damped = x + (((string->last - x) * string->smoothing + 16384) >> 15);
+        int32_t scaled = damped * string->loss + string->loss_error;
+        damped = (scaled + 16384) >> 15;
+        string->loss_error = scaled - (damped << 15);
+        string->last = x;
+
+        // Fractional delay: y[n] = c (x[n] - y[n-1]) + x[n-1]
+        int32_t y = ((string->allpass_coef * (damped - string->allpass_out) + 16384) >> 15) +
+                    string->allpass_in;
+        if (y > 32767) y = 32767;
+        if (y < -32768) y = -32768;
+        string->allpass_in = damped;
+        string->allpass_out = y;
+
+        string->line[string->position] = (int16_t)y;
+        mix += x;
+
+        int32_t magnitude = x < 0 ? -x : x;
+        if (magnitude > string->peak) {
+            string->peak = magnitude;
+        }
+
+        // Once per period, release strings that have died away
+        if (++string->position == string->length) {
+            string->position = 0;
+            if (string->peak < KS_SILENCE_LEVEL) {
+                ks_pool_free(string->line);
+                string->line = NULL;
+            }
+            string->peak = 0;
+        }
+    }
+
+    if (mix > 32767) mix = 32767;
+    if (mix < -32768) mix = -32768;
+    return mix;
+}
+
+uint8_t ks_get_active_strings(void) {
+    uint8_t active = 0;
+    for (int i = 0; i < KS_MAX_STRINGS; i++) {
+        if (strings[i].line != NULL) {
+            active++;
+        }
+    }
+    return active;
+}
+
+void ks_print_status(void) {
+    printf("Strings: %d/%d active, pool %d/%d free (decay %.2f s, brightness %.0f%%)\n",
+           ks_get_active_strings(), KS_MAX_STRINGS, pool_free_count, KS_POOL_LINES,
+           decay_time, brightness * 100.0f);
+}
+
+void ks_benchmark(void) {
+    static const float bench_frequencies[KS_MAX_STRINGS] = {82.4f, 110.0f, 146.8f, 196.0f};
+    uint32_t elapsed_us[KS_MAX_STRINGS + 1];
+
+    ks_reset();
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (int count = 0; count <= KS_MAX_STRINGS; count++) {
+        for (int i = 0; i < count; i++) {
+            ks_pluck(bench_frequencies[i]);
+        }
+        uint64_t start = time_us_64();
+        for (int n = 0; n < KS_BENCH_SAMPLES; n++) {
+            ks_process();
+        }
+        elapsed_us[count] = (uint32_t)(time_us_64() - start);
+        ks_reset();
+    }
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    printf("Karplus-Strong benchmark (%.0f MHz):\n", cycles_per_us);
+    printf("  Strings | Cycles/sample\n");
+    for (int count = 0; count <= KS_MAX_STRINGS; count++) {
+        printf("  %7d | %13.1f\n", count, elapsed_us[count] * cycles_per_us / KS_BENCH_SAMPLES);
+    }
+
+    // Budget left in a 44.1 kHz sample period after the rest of the interrupt
+    isr_stats_t stats;
+    waveform_get_isr_stats(&stats);
+    float per_string = (elapsed_us[KS_MAX_STRINGS] - elapsed_us[0]) * cycles_per_us /
+                       ((float)KS_BENCH_SAMPLES * KS_MAX_STRINGS);
+    float budget = cycles_per_us * 1000000.0f / KS_BENCH_RATE;
+    float isr_load = stats.count ? (float)stats.total_duration / stats.count : 0.0f;
+    printf("  %.1f cycles per string, %.0f cycle budget at %d Hz (ISR average %.0f)\n",
+           per_string, budget, KS_BENCH_RATE, isr_load);
+    if (per_string > 0.0f) {
+        printf("  Strings that fit at %d Hz: %d (pool holds %d)\n", KS_BENCH_RATE,
+               (int)((budget - isr_load) / per_string), KS_POOL_LINES);
+    }
+}
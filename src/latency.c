@@ -0,0 +1,216 @@
+/**
+ * Latency Harness Implementation
+ *
+ * This module measures the time from an input (button edge, serial
+ * command or audio input trigger) to the first rendered sample whose envelope crosses
+ * LATENCY_ENVELOPE_THRESHOLD. Button edges are timestamped by a GPIO
+ * interrupt, so the polling interval and debounce logic are part of the
+ * measurement. Each trial is split into input-to-handler (polling, debounce,
+ * command parsing) and handler-to-sound (envelope attack, sample period).
+ */
+
+#include "latency.h"
+#include "timebase.h"
+#include "hardware/sync.h"
+
+typedef struct {
+    uint32_t handled_us[LATENCY_MAX_TRIALS];    // Input to note-on handler
+    uint32_t total_us[LATENCY_MAX_TRIALS];      // Input to sample at the PWM output
+    uint32_t count;                             // Trials recorded (may exceed LATENCY_MAX_TRIALS)
+} latency_trials_t;
+
+static latency_trials_t trials[LATENCY_SRC_COUNT];
+
+// Earliest button edge since the last note (set by the GPIO interrupt)
+static volatile bool edge_pending = false;
+static volatile uint32_t edge_time = 0;
+static uint32_t last_rise_time = 0;
+
+// Trial in flight, completed by the sample interrupt
+static volatile bool trial_armed = false;
+static volatile bool trial_complete = false;
+static volatile uint32_t sound_time = 0;
+static latency_source_t trial_source;
+static uint32_t trial_input_time;
+static uint32_t trial_handled_time;
+
+static void latency_gpio_irq(void) {
+    uint32_t events = gpio_get_irq_event_mask(OUTPUT_TOGGLE_PIN);
+    if (events == 0) {
+        return;
+    }
+    gpio_acknowledge_irq(OUTPUT_TOGGLE_PIN, events);
+    uint32_t now = time_us_32();
+
+    // A press starts with a falling edge after the pin was high for a while;
+    // later edges of the same bounce burst, and release bounce, are ignored
+    if ((events & GPIO_IRQ_EDGE_FALL) && !edge_pending &&
+        now - last_rise_time > LATENCY_EDGE_STABLE_US) {
+        edge_time = now;
+        edge_pending = true;
+    }
+    if (events & GPIO_IRQ_EDGE_RISE) {
+        last_rise_time = now;
+    }
+}
+
+void latency_init(void) {
+    latency_reset();
+
+    // A raw handler for this pin only, so other modules can take button edges
+    gpio_set_irq_enabled(OUTPUT_TOGGLE_PIN, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    gpio_add_raw_irq_handler(OUTPUT_TOGGLE_PIN, latency_gpio_irq);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    printf("Latency harness initialized (threshold %.0f%% envelope)\n",
+           LATENCY_ENVELOPE_THRESHOLD * 100.0f);
+}
+
+void latency_arm(latency_source_t source, uint32_t input_time_us) {
+    uint32_t now = time_us_32();
+
+    // A note that is still sounding cannot show when the new one starts
+    if (g_sound_system.envelope_level >= LATENCY_ENVELOPE_THRESHOLD) {
+        edge_pending = false;
+        return;
+    }
+
+    if (source == LATENCY_SRC_BUTTON) {
+        if (!edge_pending || now - edge_time > LATENCY_EDGE_MAX_AGE_US) {
+            edge_pending = false;
+            return;
+        }
+        input_time_us = edge_time;
+        edge_pending = false;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    trial_source = source;
+    trial_input_time = input_time_us;
+    trial_handled_time = now;
+    trial_complete = false;
+    trial_armed = true;
+    restore_interrupts(irq_state);
+}
+
+void AUDIO_HOT_FUNC(latency_arm_input)(uint32_t input_time_us) {
+    // Already in the sample interrupt, so nothing can run in between
+    if (g_sound_system.envelope_level >= LATENCY_ENVELOPE_THRESHOLD) {
+        return;
+    }
+    trial_source = LATENCY_SRC_INPUT;
+    trial_input_time = input_time_us;
+    trial_handled_time = time_us_32();
+    trial_complete = false;
+    trial_armed = true;
+}
+
+void latency_discard_edge(void) {
+    edge_pending = false;
+}
+
+void AUDIO_HOT_FUNC(latency_tap)(float envelope) {
+    if (trial_armed && envelope >= LATENCY_ENVELOPE_THRESHOLD) {
+        sound_time = time_us_32();
+        trial_armed = false;
+        trial_complete = true;
+    }
+}
+
+void latency_service(void) {
+    if (!trial_complete) {
+        return;
+    }
+    trial_complete = false;
+
+    // The level written in the interrupt reaches the pin at the next wrap
+    uint32_t sample_period_us = (uint32_t)(1000000.0f / timebase_get_sample_rate());
+
+    latency_trials_t *t = &trials[trial_source];
+    uint32_t slot = t->count % LATENCY_MAX_TRIALS;
+    t->handled_us[slot] = trial_handled_time - trial_input_time;
+    t->total_us[slot] = sound_time - trial_input_time + sample_period_us;
+    t->count++;
+}
+
+void latency_reset(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (int i = 0; i < LATENCY_SRC_COUNT; i++) {
+        trials[i].count = 0;
+    }
+    trial_armed = false;
+    trial_complete = false;
+    restore_interrupts(irq_state);
+}
+
+const char* latency_get_source_name(latency_source_t source) {
+    switch (source) {
+        case LATENCY_SRC_BUTTON: return "Button";
+        case LATENCY_SRC_SERIAL: return "Serial";
+        case LATENCY_SRC_INPUT:  return "Audio in";
+        default:                 return "Unknown";
+    }
+}
+
+/**
+ * Sort values in place (at most LATENCY_MAX_TRIALS entries)
+ */
+static void latency_sort(uint32_t *values, uint32_t count) {
+    for (uint32_t i = 1; i < count; i++) {
+        uint32_t value = values[i];
+        uint32_t j = i;
+        while (j > 0 && values[j - 1] > value) {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = value;
+    }
+}
+
+/**
+ * Nearest-rank percentile of sorted values
+ */
+static uint32_t latency_percentile(const uint32_t *sorted, uint32_t count, uint32_t percent) {
+    uint32_t rank = (percent * count + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+static void latency_print_row(const char *label, const uint32_t *values, uint32_t count) {
+    uint32_t sorted[LATENCY_MAX_TRIALS];
+    for (uint32_t i = 0; i < count; i++) {
+        sorted[i] = values[i];
+    }
+    latency_sort(sorted, count);
+
+    printf("    %-18s %8.2f %8.2f %8.2f %8.2f %8.2f\n", label,
+           sorted[0] / 1000.0f,
+           latency_percentile(sorted, count, 50) / 1000.0f,
+           latency_percentile(sorted, count, 90) / 1000.0f,
+           latency_percentile(sorted, count, 99) / 1000.0f,
+           sorted[count - 1] / 1000.0f);
+}
+
+void latency_print_report(void) {
+    printf("Input-to-sound latency (ms, envelope >= %.0f%%):\n", LATENCY_ENVELOPE_THRESHOLD * 100.0f);
+
+    for (int source = 0; source < LATENCY_SRC_COUNT; source++) {
+        latency_trials_t *t = &trials[source];
+        uint32_t count = t->count < LATENCY_MAX_TRIALS ? t->count : LATENCY_MAX_TRIALS;
+
+        printf("  %s: %lu trials", latency_get_source_name(source), (unsigned long)t->count);
+        if (count == 0) {
+            printf("\n");
+            continue;
+        }
+        printf(" (last %lu used)\n", (unsigned long)count);
+        printf("    %-18s %8s %8s %8s %8s %8s\n", "", "min", "p50", "p90", "p99", "max");
+
+        uint32_t to_sound[LATENCY_MAX_TRIALS];
+        for (uint32_t i = 0; i < count; i++) {
+            to_sound[i] = t->total_us[i] - t->handled_us[i];
+        }
+        latency_print_row("Input to handler", t->handled_us, count);
+        latency_print_row("Handler to sound", to_sound, count);
+        latency_print_row("Total", t->total_us, count);
+    }
+}
@@ -3,16 +3,24 @@
  * 
  * A comprehensive sound generation system featuring:
  * - Multiple waveforms (square, triangle, sawtooth, sine)
+ * - Karplus-Strong plucked string voice
+ * - Additive synthesis (up to 64 harmonics)
  * - Variable frequency control (20Hz - 20kHz)
  * - ADSR envelope control
  * - User interface with buttons and LEDs
  * - UART status reporting
+ * - Audio capture to WAV over USB
+ * - Step sequencer and arpeggiator with sample-accurate timing
+ * - Synthesized kick, snare and hi-hat voices
+ * - Microtonal tuning tables and optional 64-bit phase
+ * - Deep idle with a lowered clock while output is off
  * 
  * Hardware connections:
  * - GPIO0: PWM audio output
  * - GPIO2: Waveform selection button
  * - GPIO3: Output toggle button
  * - GPIO4-7: LED indicators for waveforms
+ * - GPIO8: Drum pad button (optional)
  * - GPIO26-29: ADC inputs for potentiometers
  */
 
@@ -21,26 +29,44 @@
 #include "adsr_envelope.h"
 #include "ui_controls.h"
 #include "uart_comm.h"
+#include "modulation.h"
+#include "oversampling.h"
+#include "spectrum_analyzer.h"
+#include "karplus_strong.h"
+#include "additive.h"
+#include "granular.h"
+#include "audio_input.h"
+#include "drums.h"
+#include "tuning.h"
+#include "power.h"
+#include "capture.h"
+#include "latency.h"
+#include "sequencer.h"
 
 // Global system state
 sound_system_t g_sound_system = {
     .current_waveform = WAVEFORM_SQUARE,
     .frequency = 440.0f,
     .duty_cycle = 0.5f,
+    .morph_position = 0.0f,
+    .filter_cutoff = MAX_FREQUENCY,
     .output_enabled = false,
     .phase_accumulator = 0,
     .phase_increment = 0,
+    .phase_fraction = 0,
+    .phase_increment_fraction = 0,
     .attack_time = 0.1f,
     .decay_time = 0.2f,
     .sustain_level = 0.7f,
     .release_time = 0.3f,
     .adsr_state = ADSR_IDLE,
     .envelope_level = 0.0f,
-    .adsr_timer = 0.0f,
     .waveform_button_pressed = false,
     .output_button_pressed = false,
     .last_waveform_press = 0,
-    .last_output_press = 0
+    .last_output_press = 0,
+    .drum_button_pressed = false,
+    .last_drum_press = 0
 };
 
 /**
@@ -52,8 +78,21 @@ void system_init(void) {
     
     // Initialize subsystems
     waveform_generator_init();
+    tuning_init();
     adsr_envelope_init();
+    modulation_init();
+    oversampling_init();
+    ks_init();
+    additive_init();
+    drums_init();
+    granular_init();
+    capture_init();
+    sequencer_init();
+    spectrum_analyzer_init();
     ui_controls_init();
+    audio_input_init();
+    latency_init();
+    power_init();
     uart_comm_init();
     
     // Print startup information
@@ -77,15 +116,33 @@ void system_update(void) {
         ui_read_potentiometers(&g_sound_system);
         ui_update_leds(&g_sound_system);
         
-        // Update ADSR envelope
-        adsr_update(&g_sound_system, delta_time);
+        // Refresh ADSR curve coefficients (the envelope itself runs per sample)
+        adsr_update(&g_sound_system);
         
         // Update phase accumulator for waveform generation
         update_phase_accumulator(&g_sound_system);
         
+        // Evaluate control-rate modulation routes for this block
+        modulation_update_control(&g_sound_system);
+        
         last_update_time = current_time;
     }
     
+    // Handle serial commands
+    uart_poll_commands(&g_sound_system);
+    
+    // Queue sequencer steps that are about to start
+    sequencer_service(&g_sound_system);
+    
+    // Queue captured audio to USB (non-blocking)
+    capture_service();
+    
+    // Record completed latency trials
+    latency_service();
+    
+    // Sleep until a button or serial event once nothing can be heard
+    power_service(&g_sound_system);
+    
     // Periodic UART status update (every 5 seconds)
     if ((current_time - last_uart_update) > 5000000) {
         uart_periodic_update(&g_sound_system);
@@ -0,0 +1,361 @@
+/**
+ * Modulation Implementation
+ *
+ * This module provides fixed-point LFOs and a small routing matrix that
+ * modulates pitch, duty cycle, amplitude and filter cutoff. Control-rate
+ * routes are evaluated once per control block in the main loop, audio-rate
+ * routes once per sample in the PWM interrupt.
+ */
+
+#include "modulation.h"
+#include "waveform_generator.h"
+#include "timebase.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+#define MOD_PITCH_TABLE_SIZE 66     // 2^x for x = -1..1 in 64 steps, plus guard
+#define MOD_DUTY_MIN 3277           // 5% duty threshold
+#define MOD_DUTY_MAX 62258          // 95% duty threshold
+#define MOD_CUTOFF_MIN 33           // ~0.1% filter coefficient
+#define MOD_MORPH_MAX ((int32_t)MORPH_POSITION_MAX << 15)
+#define MOD_BENCH_SAMPLES 4096      // Samples timed per benchmark step
+#define MOD_BENCH_BLOCKS 1024       // Control blocks timed per benchmark step
+
+typedef struct {
+    uint32_t phase;
+    uint32_t increment;
+    lfo_shape_t shape;
+    float rate;
+    int32_t held;               // Sample and hold value
+} lfo_t;
+
+static lfo_t lfos[MOD_LFO_COUNT];
+static mod_route_t routes[MOD_MAX_ROUTES];
+
+// Packed copies of the active routes, split by evaluation rate
+static mod_route_t control_routes[MOD_MAX_ROUTES];
+static mod_route_t audio_routes[MOD_MAX_ROUTES];
+static uint8_t control_route_count;
+static uint8_t audio_route_count;
+
+// Unmodulated parameters and control-rate sums from the last control block
+static uint32_t base_increment;
+static uint32_t base_fraction;      // Fractional increment, 1/2^32
+static int32_t base_duty_threshold;
+static int32_t base_cutoff;
+static int32_t base_morph;
+static int32_t control_sum[MOD_DEST_COUNT];
+
+static mod_output_t control_output;
+static mod_output_t audio_output;
+
+// Pitch multipliers in Q16
+static uint32_t pitch_table[MOD_PITCH_TABLE_SIZE];
+
+static uint32_t noise_state = 0x12345678;
+
+static int32_t AUDIO_HOT_FUNC(lfo_value)(const lfo_t *lfo) {
+    uint16_t phase = lfo->phase >> 16;
+
+    switch (lfo->shape) {
+        case LFO_SHAPE_SINE:
+            return ((int32_t)generate_sine_wave(phase) - 128) << 8;
+        case LFO_SHAPE_TRIANGLE:
+            if (phase < 32768) {
+                return (int32_t)phase * 2 - 32768;
+            }
+            return 32767 - ((int32_t)phase - 32768) * 2;
+        case LFO_SHAPE_SAWTOOTH:
+            return (int32_t)phase - 32768;
+        case LFO_SHAPE_SQUARE:
+            return (phase < 32768) ? 32767 : -32768;
+        case LFO_SHAPE_RANDOM:
+            return lfo->held;
+        default:
+            return 0;
+    }
+}
+
+static void AUDIO_HOT_FUNC(lfo_advance)(lfo_t *lfo) {
+    uint32_t previous = lfo->phase;
+    lfo->phase += lfo->increment;
+
+    if (lfo->shape == LFO_SHAPE_RANDOM && lfo->phase < previous) {
+        // Xorshift32, new held value on every wrap
+        noise_state ^= noise_state << 13;
+        noise_state ^= noise_state >> 17;
+        noise_state ^= noise_state << 5;
+        lfo->held = (int32_t)(noise_state >> 16) - 32768;
+    }
+}
+
+static int32_t AUDIO_HOT_FUNC(route_contribution)(const mod_route_t *route) {
+    int32_t value = lfo_value(&lfos[route->source]);
+
+    if (route->destination == MOD_DEST_AMPLITUDE) {
+        // Tremolo only ever pulls the level down from the envelope
+        value = (value - 32767) >> 1;
+    }
+    return (value * route->depth) >> 15;
+}
+
+static int32_t AUDIO_HOT_FUNC(clamp_i32)(int32_t value, int32_t min, int32_t max) {
+    if (value < min) return min;
+    if (value > max) return max;
+    return value;
+}
+
+static void AUDIO_HOT_FUNC(apply_sums)(const int32_t *sum, mod_output_t *out) {
+    // Pitch: interpolate 2^(sum/32768) from the table
+    uint32_t pitch_pos = (uint32_t)(clamp_i32(sum[MOD_DEST_PITCH], -32768, 32768) + 32768);
+    uint32_t index = pitch_pos >> 10;
+    uint32_t frac = pitch_pos & 1023;
+    uint32_t factor = pitch_table[index] +
+                      (((pitch_table[index + 1] - pitch_table[index]) * frac) >> 10);
+    uint64_t scaled = (uint64_t)base_increment * factor;
+    if (scaled >= (0x7FFFFFFFull << 16)) {
+        out->phase_increment = 0x7FFFFFFF;
+        out->phase_fraction = 0;
+    } else {
+        // 32.32 fixed point, so a fractional base increment survives the pitch factor
+        uint64_t increment = (scaled << 16) + (((uint64_t)base_fraction * factor) >> 16);
+        out->phase_increment = (uint32_t)(increment >> 32);
+        out->phase_fraction = (uint32_t)increment;
+    }
+
+    out->duty_threshold = (uint16_t)clamp_i32(base_duty_threshold + sum[MOD_DEST_DUTY],
+                                              MOD_DUTY_MIN, MOD_DUTY_MAX);
+    out->gain = clamp_i32(32768 + sum[MOD_DEST_AMPLITUDE], 0, 32768);
+    out->cutoff = clamp_i32(base_cutoff + sum[MOD_DEST_CUTOFF], MOD_CUTOFF_MIN, 32768);
+    out->morph = clamp_i32(base_morph + sum[MOD_DEST_MORPH] * 3 / 2, 0, MOD_MORPH_MAX);
+}
+
+static void rebuild_route_lists(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+
+    control_route_count = 0;
+    audio_route_count = 0;
+    for (int i = 0; i < MOD_MAX_ROUTES; i++) {
+        if (!routes[i].active) {
+            continue;
+        }
+        if (routes[i].rate == MOD_RATE_AUDIO) {
+            audio_routes[audio_route_count++] = routes[i];
+        } else {
+            control_routes[control_route_count++] = routes[i];
+        }
+    }
+
+    restore_interrupts(irq_state);
+}
+
+void modulation_init(void) {
+    for (int i = 0; i < MOD_PITCH_TABLE_SIZE; i++) {
+        float octaves = (float)(i - 32) / 32.0f;
+        pitch_table[i] = (uint32_t)(powf(2.0f, octaves) * 65536.0f);
+    }
+
+    for (int i = 0; i < MOD_LFO_COUNT; i++) {
+        lfos[i].phase = 0;
+        lfos[i].held = 0;
+        modulation_set_lfo(i, LFO_SHAPE_SINE, 1.0f + i * 2.0f);
+    }
+
+    memset(routes, 0, sizeof(routes));
+    memset(control_sum, 0, sizeof(control_sum));
+    rebuild_route_lists();
+
+    printf("Modulation initialized (%d LFOs, %d routes)\n", MOD_LFO_COUNT, MOD_MAX_ROUTES);
+}
+
+bool modulation_set_lfo(uint8_t lfo, lfo_shape_t shape, float rate_hz) {
+    if (lfo >= MOD_LFO_COUNT || shape >= LFO_SHAPE_COUNT) {
+        return false;
+    }
+
+    if (rate_hz < MOD_LFO_MIN_RATE) rate_hz = MOD_LFO_MIN_RATE;
+    if (rate_hz > MOD_LFO_MAX_RATE) rate_hz = MOD_LFO_MAX_RATE;
+
+    lfos[lfo].shape = shape;
+    lfos[lfo].rate = rate_hz;
+    lfos[lfo].increment = (uint32_t)((rate_hz * 4294967296.0f) / timebase_get_sample_rate());
+    return true;
+}
+
+void modulation_refresh_rates(void) {
+    for (int i = 0; i < MOD_LFO_COUNT; i++) {
+        lfos[i].increment = (uint32_t)((lfos[i].rate * 4294967296.0f) / timebase_get_sample_rate());
+    }
+}
+
+bool modulation_set_route(uint8_t slot, mod_source_t source, mod_destination_t destination,
+                          float depth, mod_rate_t rate) {
+    if (slot >= MOD_MAX_ROUTES || source >= MOD_SRC_COUNT || destination >= MOD_DEST_COUNT) {
+        return false;
+    }
+
+    if (depth < -1.0f) depth = -1.0f;
+    if (depth > 1.0f) depth = 1.0f;
+
+    routes[slot].active = true;
+    routes[slot].source = source;
+    routes[slot].destination = destination;
+    routes[slot].rate = rate;
+    routes[slot].depth = (int16_t)(depth * 32767.0f);
+    rebuild_route_lists();
+    return true;
+}
+
+bool modulation_clear_route(uint8_t slot) {
+    if (slot >= MOD_MAX_ROUTES) {
+        return false;
+    }
+    routes[slot].active = false;
+    rebuild_route_lists();
+    return true;
+}
+
+void modulation_update_control(sound_system_t *system) {
+    base_duty_threshold = (int32_t)(system->duty_cycle * 65535.0f);
+    base_morph = (int32_t)(system->morph_position * 32768.0f);
+
+    if (system->filter_cutoff >= MAX_FREQUENCY) {
+        base_cutoff = 32768; // Filter bypassed
+    } else {
+        float coef = 1.0f - expf(-2.0f * (float)M_PI * system->filter_cutoff / timebase_get_sample_rate());
+        base_cutoff = (int32_t)(coef * 32768.0f);
+    }
+
+    int32_t sum[MOD_DEST_COUNT] = {0};
+    for (int i = 0; i < control_route_count; i++) {
+        sum[control_routes[i].destination] += route_contribution(&control_routes[i]);
+    }
+
+    // Publish atomically with respect to the sample interrupt. The pitch is
+    // read inside, so a sequencer retune that lands meanwhile is not undone.
+    uint32_t irq_state = save_and_disable_interrupts();
+    base_increment = system->phase_increment;
+    base_fraction = system->phase_increment_fraction;
+    memcpy(control_sum, sum, sizeof(control_sum));
+    apply_sums(sum, &control_output);
+    restore_interrupts(irq_state);
+}
+
+void AUDIO_HOT_FUNC(modulation_set_base_increment)(uint32_t phase_increment, uint32_t fraction) {
+    base_increment = phase_increment;
+    base_fraction = fraction;
+    apply_sums(control_sum, &control_output);
+}
+
+const mod_output_t* AUDIO_HOT_FUNC(modulation_process_sample)(void) {
+    for (int i = 0; i < MOD_LFO_COUNT; i++) {
+        lfo_advance(&lfos[i]);
+    }
+
+    if (audio_route_count == 0) {
+        return &control_output;
+    }
+
+    int32_t sum[MOD_DEST_COUNT];
+    memcpy(sum, control_sum, sizeof(sum));
+    for (int i = 0; i < audio_route_count; i++) {
+        sum[audio_routes[i].destination] += route_contribution(&audio_routes[i]);
+    }
+
+    apply_sums(sum, &audio_output);
+    return &audio_output;
+}
+
+const char* modulation_get_shape_name(lfo_shape_t shape) {
+    switch (shape) {
+        case LFO_SHAPE_SINE:     return "sine";
+        case LFO_SHAPE_TRIANGLE: return "triangle";
+        case LFO_SHAPE_SAWTOOTH: return "saw";
+        case LFO_SHAPE_SQUARE:   return "square";
+        case LFO_SHAPE_RANDOM:   return "random";
+        default:                 return "unknown";
+    }
+}
+
+const char* modulation_get_destination_name(mod_destination_t destination) {
+    switch (destination) {
+        case MOD_DEST_PITCH:     return "pitch";
+        case MOD_DEST_DUTY:      return "duty";
+        case MOD_DEST_AMPLITUDE: return "amp";
+        case MOD_DEST_CUTOFF:    return "cutoff";
+        case MOD_DEST_MORPH:     return "morph";
+        default:                 return "unknown";
+    }
+}
+
+void modulation_print_status(void) {
+    printf("Modulation:\n");
+    for (int i = 0; i < MOD_LFO_COUNT; i++) {
+        printf("  LFO%d: %s %.2f Hz\n", i + 1, modulation_get_shape_name(lfos[i].shape), lfos[i].rate);
+    }
+    for (int i = 0; i < MOD_MAX_ROUTES; i++) {
+        if (routes[i].active) {
+            printf("  Route %d: LFO%d -> %s %.0f%% (%s rate)\n", i,
+                   routes[i].source + 1,
+                   modulation_get_destination_name(routes[i].destination),
+                   routes[i].depth * 100.0f / 32767.0f,
+                   routes[i].rate == MOD_RATE_AUDIO ? "audio" : "control");
+        }
+    }
+    printf("  Active routes: %d control, %d audio\n", control_route_count, audio_route_count);
+}
+
+void modulation_benchmark(sound_system_t *system) {
+    static uint32_t audio_us[MOD_MAX_ROUTES + 1];
+    static uint32_t control_us[MOD_MAX_ROUTES + 1];
+    mod_route_t saved_routes[MOD_MAX_ROUTES];
+
+    memcpy(saved_routes, routes, sizeof(routes));
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+
+    for (int count = 0; count <= MOD_MAX_ROUTES; count++) {
+        for (int i = 0; i < MOD_MAX_ROUTES; i++) {
+            routes[i].active = i < count;
+            routes[i].source = i % MOD_SRC_COUNT;
+            routes[i].destination = i % MOD_DEST_COUNT;
+            routes[i].rate = MOD_RATE_AUDIO;
+            routes[i].depth = 16384;
+        }
+        rebuild_route_lists();
+
+        uint64_t start = time_us_64();
+        for (int n = 0; n < MOD_BENCH_SAMPLES; n++) {
+            modulation_process_sample();
+        }
+        audio_us[count] = (uint32_t)(time_us_64() - start);
+
+        for (int i = 0; i < MOD_MAX_ROUTES; i++) {
+            routes[i].rate = MOD_RATE_CONTROL;
+        }
+        rebuild_route_lists();
+
+        start = time_us_64();
+        for (int n = 0; n < MOD_BENCH_BLOCKS; n++) {
+            modulation_update_control(system);
+        }
+        control_us[count] = (uint32_t)(time_us_64() - start);
+    }
+
+    memcpy(routes, saved_routes, sizeof(routes));
+    rebuild_route_lists();
+    modulation_update_control(system);
+
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    printf("Modulation benchmark (%.0f MHz):\n", cycles_per_us);
+    printf("  Routes | Audio-rate cycles/sample | Control-rate cycles/block\n");
+    for (int count = 0; count <= MOD_MAX_ROUTES; count++) {
+        printf("  %6d | %24.1f | %25.1f\n", count,
+               audio_us[count] * cycles_per_us / MOD_BENCH_SAMPLES,
+               control_us[count] * cycles_per_us / MOD_BENCH_BLOCKS);
+    }
+}
@@ -0,0 +1,261 @@
+/**
+ * Oversampling Implementation
+ *
+ * Oscillators can run at 2x or 4x the output rate. The oversampled stream
+ * is brought back down by one or two polyphase half-band FIR stages in
+ * fixed point, which removes most of the aliasing that naive waveforms
+ * fold into the audible band at high frequencies.
+ */
+
+#include "oversampling.h"
+#include "waveform_generator.h"
+#include "uart_comm.h"
+#include "timebase.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+#define HALFBAND_CENTER ((HALFBAND_TAPS - 1) / 2)
+#define HALFBAND_COEFS ((HALFBAND_TAPS + 1) / 4)   // Non-zero odd taps per side
+#define HALFBAND_KAISER_BETA 7.0f                  // ~70 dB stopband
+#define OVERSAMPLE_BENCH_SAMPLES 4096
+#define OVERSAMPLE_BENCH_PASSBAND 16000.0f         // Report aliases landing below this (max)
+#define ALIAS_SWEEP_TONES 128                      // Test tones across the folding range
+#define ALIAS_SETTLE_SAMPLES HALFBAND_TAPS         // Output samples dropped before measuring
+#define ALIAS_MEASURE_SAMPLES 256                  // Output samples correlated per tone
+#define ALIAS_TONE_LEVEL 16384.0f                  // Test tone amplitude (half scale, Q15)
+
+typedef struct {
+    int32_t history[2 * HALFBAND_TAPS];   // Doubled so the window is contiguous
+    uint8_t pos;
+} halfband_t;
+
+// Odd-tap coefficients in Q15; the centre tap is 0.5 and even taps are zero
+static int32_t halfband_coefs[HALFBAND_COEFS];
+
+static halfband_t stage_one;
+static halfband_t stage_two;
+static halfband_t measure_one;      // Separate stages so measuring leaves the audio path alone
+static halfband_t measure_two;
+static uint8_t oversample_factor = 1;
+
+static float bessel_i0(float x) {
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 25; k++) {
+        term *= (x / (2.0f * k)) * (x / (2.0f * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void AUDIO_SCRATCH_FUNC(halfband_push)(halfband_t *hb, int32_t sample) {
+    hb->history[hb->pos] = sample;
+    hb->history[hb->pos + HALFBAND_TAPS] = sample;
+    if (++hb->pos >= HALFBAND_TAPS) {
+        hb->pos = 0;
+    }
+}
+
+/**
+ * Push two input samples and produce one output sample. Polyphase form:
+ * the centre tap branch is a plain delay, the other branch only touches
+ * the symmetric odd taps, so each output costs HALFBAND_COEFS multiplies.
+ */
+static int32_t AUDIO_SCRATCH_FUNC(halfband_decimate)(halfband_t *hb, int32_t first, int32_t second) {
+    halfband_push(hb, first);
+    halfband_push(hb, second);
+
+    // history[pos] is the oldest sample, history[pos + TAPS - 1] the newest
+    const int32_t *window = &hb->history[hb->pos];
+    int64_t acc = (int64_t)window[HALFBAND_CENTER] << 14;
+    for (int k = 0; k < HALFBAND_COEFS; k++) {
+        int offset = 2 * k + 1;
+        acc += (int64_t)halfband_coefs[k] *
+               (window[HALFBAND_CENTER - offset] + window[HALFBAND_CENTER + offset]);
+    }
+    return (int32_t)(acc >> 15);
+}
+
+/**
+ * Run one output sample's worth of input through the stages for a factor
+ */
+static int32_t AUDIO_HOT_FUNC(decimate_stages)(halfband_t *one, halfband_t *two, uint8_t factor,
+                                               const int32_t *input) {
+    if (factor == 4) {
+        int32_t first = halfband_decimate(one, input[0], input[1]);
+        int32_t second = halfband_decimate(one, input[2], input[3]);
+        return halfband_decimate(two, first, second);
+    }
+    if (factor == 2) {
+        return halfband_decimate(two, input[0], input[1]);
+    }
+    return input[0];
+}
+
+void oversampling_init(void) {
+    // Kaiser-windowed sinc, scaled for unity gain at DC
+    float coefs[HALFBAND_COEFS];
+    float sum = 0.5f;
+    float i0_beta = bessel_i0(HALFBAND_KAISER_BETA);
+
+    for (int k = 0; k < HALFBAND_COEFS; k++) {
+        int offset = 2 * k + 1;
+        float ratio = (float)offset / HALFBAND_CENTER;
+        float window = bessel_i0(HALFBAND_KAISER_BETA * sqrtf(1.0f - ratio * ratio)) / i0_beta;
+        coefs[k] = sinf((float)M_PI * offset / 2.0f) / ((float)M_PI * offset) * window;
+        sum += 2.0f * coefs[k];
+    }
+    for (int k = 0; k < HALFBAND_COEFS; k++) {
+        halfband_coefs[k] = (int32_t)lrintf(coefs[k] / sum * 32768.0f);
+    }
+
+    oversampling_set_factor(OVERSAMPLE_FACTOR);
+    printf("Oversampling initialized (%dx, %d-tap half-band)\n", oversample_factor, HALFBAND_TAPS);
+}
+
+bool oversampling_set_factor(uint8_t factor) {
+    if (factor != 1 && factor != 2 && factor != 4) {
+        return false;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    memset(&stage_one, 0, sizeof(stage_one));
+    memset(&stage_two, 0, sizeof(stage_two));
+    oversample_factor = factor;
+    restore_interrupts(irq_state);
+    return true;
+}
+
+uint8_t AUDIO_HOT_FUNC(oversampling_get_factor)(void) {
+    return oversample_factor;
+}
+
+int32_t AUDIO_HOT_FUNC(oversampling_decimate)(const int32_t *input) {
+    return decimate_stages(&stage_one, &stage_two, oversample_factor, input);
+}
+
+/**
+ * Feed a Q15 test tone through the fixed-point decimator and measure the
+ * level of what comes out at its alias frequency
+ * @return Output amplitude relative to the input amplitude
+ */
+static float oversampling_tone_gain(uint8_t factor, float frequency, float output_rate) {
+    float input_rate = output_rate * factor;
+    float alias = fmodf(frequency, output_rate);
+    if (alias > output_rate / 2.0f) {
+        alias = output_rate - alias;
+    }
+
+    // Rotating phasors instead of sinf(): float phase loses precision long
+    // before the measurement ends at these sample counts
+    float in_step = 2.0f * (float)M_PI * frequency / input_rate;
+    float in_cos = cosf(in_step), in_sin = sinf(in_step);
+    float out_step = 2.0f * (float)M_PI * alias / output_rate;
+    float out_cos = cosf(out_step), out_sin = sinf(out_step);
+    float in_re = 1.0f, in_im = 0.0f;
+    float out_re = 1.0f, out_im = 0.0f;
+
+    memset(&measure_one, 0, sizeof(measure_one));
+    memset(&measure_two, 0, sizeof(measure_two));
+
+    // Hann-windowed correlation with the alias picks out its amplitude and
+    // ignores the rounding noise of the fixed-point path
+    float sum_re = 0.0f, sum_im = 0.0f, window_sum = 0.0f;
+    for (int n = 0; n < ALIAS_SETTLE_SAMPLES + ALIAS_MEASURE_SAMPLES; n++) {
+        int32_t input[OVERSAMPLE_MAX_FACTOR];
+        for (int i = 0; i < factor; i++) {
+            input[i] = (int32_t)lrintf(ALIAS_TONE_LEVEL * in_im);
+            float re = in_re * in_cos - in_im * in_sin;
+            in_im = in_re * in_sin + in_im * in_cos;
+            in_re = re;
+        }
+        int32_t output = decimate_stages(&measure_one, &measure_two, factor, input);
+
+        int m = n - ALIAS_SETTLE_SAMPLES;
+        if (m >= 0) {
+            float window = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * (m + 0.5f) / ALIAS_MEASURE_SAMPLES);
+            sum_re += window * output * out_re;
+            sum_im += window * output * out_im;
+            window_sum += window;
+            float re = out_re * out_cos - out_im * out_sin;
+            out_im = out_re * out_sin + out_im * out_cos;
+            out_re = re;
+        }
+    }
+    return 2.0f * sqrtf(sum_re * sum_re + sum_im * sum_im) / window_sum / ALIAS_TONE_LEVEL;
+}
+
+float oversampling_measure_alias_rejection(uint8_t factor, float passband, float *worst_frequency) {
+    float output_rate = timebase_get_sample_rate();
+    float input_rate = output_rate * factor;
+    float low = output_rate - passband;
+    float high = input_rate / 2.0f;
+    float worst = 0.0f;
+
+    // Every tone from the first folding frequency up to the input Nyquist;
+    // skip the ones whose alias lands above the passband edge
+    for (int i = 0; i < ALIAS_SWEEP_TONES; i++) {
+        float frequency = low + (high - low) * i / (ALIAS_SWEEP_TONES - 1);
+        float folded = fmodf(frequency, output_rate);
+        if (folded > output_rate / 2.0f) {
+            folded = output_rate - folded;
+        }
+        if (folded > passband) {
+            continue;
+        }
+        float gain = oversampling_tone_gain(factor, frequency, output_rate);
+        if (gain > worst) {
+            worst = gain;
+            if (worst_frequency) {
+                *worst_frequency = frequency;
+            }
+        }
+    }
+    return 20.0f * log10f(worst + 1e-9f);
+}
+
+void oversampling_benchmark(sound_system_t *system) {
+    static const uint8_t factors[] = {1, 2, 4};
+    uint32_t elapsed_us[count_of(factors)];
+    uint8_t saved_factor = oversample_factor;
+    sound_system_t scratch = *system;
+
+    scratch.adsr_state = ADSR_SUSTAIN;
+    scratch.envelope_level = scratch.sustain_level;
+
+    // Keep the sample interrupt out of the measurement
+    uint32_t irq_state = save_and_disable_interrupts();
+    for (uint i = 0; i < count_of(factors); i++) {
+        oversampling_set_factor(factors[i]);
+        uint64_t start = time_us_64();
+        for (int n = 0; n < OVERSAMPLE_BENCH_SAMPLES; n++) {
+            generate_waveform_sample(&scratch);
+        }
+        elapsed_us[i] = (uint32_t)(time_us_64() - start);
+    }
+    oversampling_set_factor(saved_factor);
+    restore_interrupts(irq_state);
+
+    float cycles_per_us = clock_get_hz(clk_sys) / 1000000.0f;
+    float output_rate = timebase_get_sample_rate();
+    float passband = fminf(OVERSAMPLE_BENCH_PASSBAND, output_rate * 0.36f);
+    printf("Oversampling benchmark (%s, %.0f MHz):\n",
+           uart_get_waveform_name(scratch.current_waveform), cycles_per_us);
+    printf("  Factor | Cycles/output sample | Measured alias rejection below %.0f Hz\n",
+           passband);
+
+    for (uint i = 0; i < count_of(factors); i++) {
+        uint8_t factor = factors[i];
+        float cycles = elapsed_us[i] * cycles_per_us / OVERSAMPLE_BENCH_SAMPLES;
+        if (factor == 1) {
+            printf("  %5dx | %20.1f | none\n", factor, cycles);
+            continue;
+        }
+
+        float worst_frequency = 0.0f;
+        float rejection = oversampling_measure_alias_rejection(factor, passband, &worst_frequency);
+        printf("  %5dx | %20.1f | %.1f dB (worst tone %.0f Hz)\n", factor, cycles, rejection,
+               worst_frequency);
+    }
+}
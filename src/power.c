@@ -0,0 +1,217 @@
+/**
+ * Power Management Implementation
+ *
+ * This module puts the system into deep idle when nothing can be heard:
+ * output off, envelope idle, no drum tails, sequencer stopped, audio input
+ * off and no USB transfer. The sample interrupt is stopped with the output
+ * held at the DC bias, clk_sys drops to POWER_IDLE_CLOCK_KHZ and core 0 sleeps in WFI
+ * until a button edge or received character (core 1 already waits in WFE
+ * between spectrum captures). Waking restores the clock before anything
+ * else runs, so the wake-up cost is a PLL relock plus one PWM retiming.
+ */
+
+#include "power.h"
+#include "waveform_generator.h"
+#include "drums.h"
+#include "sequencer.h"
+#include "capture.h"
+#include "audio_input.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "tusb.h"
+
+// Buttons whose edges only matter for waking; the output toggle's edges are
+// also taken by the latency harness, so it is not claimed here
+#define POWER_WAKE_PIN_MASK ((1u << WAVEFORM_BUTTON_PIN) | (1u << DRUM_BUTTON_PIN))
+
+static const uint wake_pins[] = {WAVEFORM_BUTTON_PIN, OUTPUT_TOGGLE_PIN, DRUM_BUTTON_PIN};
+
+static bool enabled = true;
+static uint32_t quiet_since = 0;
+static volatile bool serial_pending = false;
+
+static power_stats_t stats;
+static uint64_t stats_start = 0;
+
+static void power_chars_available(void *param) {
+    (void)param;
+    serial_pending = true;
+}
+
+/**
+ * Button wake interrupt. It runs after every other GPIO handler and clears
+ * the button edges still pending (the output toggle's too when no other
+ * handler took it); the idle loop reads the pin levels itself.
+ */
+static void power_gpio_irq(void) {
+    for (uint i = 0; i < count_of(wake_pins); i++) {
+        uint32_t events = gpio_get_irq_event_mask(wake_pins[i]);
+        if (events) {
+            gpio_acknowledge_irq(wake_pins[i], events);
+        }
+    }
+}
+
+void power_init(void) {
+    stdio_set_chars_available_callback(power_chars_available, NULL);
+
+    // The output toggle wakes through its falling edge, left enabled since
+    // the latency harness may use it as well
+    gpio_set_irq_enabled(OUTPUT_TOGGLE_PIN, GPIO_IRQ_EDGE_FALL, true);
+    gpio_add_raw_irq_handler_with_order_priority_masked(POWER_WAKE_PIN_MASK, power_gpio_irq,
+                                                        PICO_SHARED_IRQ_HANDLER_LOWEST_ORDER_PRIORITY);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    power_reset_stats();
+    quiet_since = time_us_32();
+
+    printf("Power management initialized (deep idle after %d ms at %d MHz)\n",
+           POWER_IDLE_DELAY_MS, POWER_IDLE_CLOCK_KHZ / 1000);
+}
+
+void power_set_enabled(bool enable) {
+    enabled = enable;
+    quiet_since = time_us_32();
+}
+
+bool power_is_enabled(void) {
+    return enabled;
+}
+
+static bool power_buttons_released(void) {
+    return gpio_get(WAVEFORM_BUTTON_PIN) && gpio_get(OUTPUT_TOGGLE_PIN) && gpio_get(DRUM_BUTTON_PIN);
+}
+
+static bool power_is_silent(const sound_system_t *system) {
+    return !system->output_enabled && system->adsr_state == ADSR_IDLE && !drums_active() &&
+           !sequencer_is_running() && !capture_is_transferring() && !audio_input_is_enabled() &&
+           power_buttons_released();
+}
+
+static void power_set_wake_irqs(bool enable) {
+    gpio_set_irq_enabled(WAVEFORM_BUTTON_PIN, GPIO_IRQ_EDGE_FALL, enable);
+    gpio_set_irq_enabled(DRUM_BUTTON_PIN, GPIO_IRQ_EDGE_FALL, enable);
+}
+
+/**
+ * Check for a wake-up event (interrupts disabled, so none can slip in
+ * between the check and WFI)
+ * @return Wake source, or POWER_WAKE_SOURCE_COUNT for none
+ */
+static power_wake_source_t power_wake_event(void) {
+    if (serial_pending) {
+        return POWER_WAKE_SERIAL;
+    }
+    if (!power_buttons_released()) {
+        return POWER_WAKE_BUTTON;
+    }
+    return POWER_WAKE_SOURCE_COUNT;
+}
+
+static void power_deep_idle(void) {
+    uint64_t enter_time = time_us_64();
+
+    // Characters reported before idle but not read yet still wake it
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (tud_cdc_available() == 0) {
+        serial_pending = false;
+    }
+    restore_interrupts(irq_state);
+
+    waveform_set_sample_interrupt(false);
+    bool clocked_down = timebase_enter_idle_clock(POWER_IDLE_CLOCK_KHZ);
+    power_set_wake_irqs(true);
+
+    // Sleep until an event; every interrupt (including the USB stack's
+    // periodic service) ends WFI, so check and go back to sleep
+    power_wake_source_t source;
+    uint64_t awake_us = 0;
+    uint64_t awake_start = time_us_64();
+    while (true) {
+        uint32_t irq_state = save_and_disable_interrupts();
+        source = power_wake_event();
+        if (source == POWER_WAKE_SOURCE_COUNT) {
+            awake_us += time_us_64() - awake_start;
+            __wfi();
+            awake_start = time_us_64();
+        }
+        restore_interrupts(irq_state);
+        if (source != POWER_WAKE_SOURCE_COUNT) {
+            break;
+        }
+    }
+
+    uint64_t wake_time = time_us_64();
+    power_set_wake_irqs(false);
+    if (clocked_down) {
+        timebase_exit_idle_clock();
+    }
+    waveform_set_sample_interrupt(true);
+    uint32_t wake_us = (uint32_t)(time_us_64() - wake_time);
+
+    stats.entries++;
+    stats.wakes[source]++;
+    stats.idle_us += wake_time - enter_time;
+    stats.idle_awake_us += awake_us + (wake_time - awake_start);
+    stats.wake_last_us = wake_us;
+    stats.wake_total_us += wake_us;
+    if (wake_us > stats.wake_max_us) {
+        stats.wake_max_us = wake_us;
+    }
+}
+
+void power_service(sound_system_t *system) {
+    uint32_t now = time_us_32();
+    if (!enabled || !power_is_silent(system)) {
+        quiet_since = now;
+        return;
+    }
+    if (now - quiet_since < POWER_IDLE_DELAY_MS * 1000u) {
+        return;
+    }
+
+    power_deep_idle();
+    quiet_since = time_us_32();
+}
+
+void power_get_stats(power_stats_t *out) {
+    *out = stats;
+    out->elapsed_us = time_us_64() - stats_start;
+}
+
+void power_reset_stats(void) {
+    stats = (power_stats_t){0};
+    stats_start = time_us_64();
+}
+
+void power_print_status(void) {
+    power_stats_t s;
+    power_get_stats(&s);
+
+    uint64_t active_us = s.elapsed_us - s.idle_us;
+    float idle_share = s.elapsed_us ? (float)s.idle_us / s.elapsed_us : 0.0f;
+    float awake_share = s.idle_us ? (float)s.idle_awake_us / s.idle_us : 0.0f;
+    float active_mhz = clock_get_hz(clk_sys) / 1000000.0f;
+    float idle_mhz = fminf(POWER_IDLE_CLOCK_KHZ / 1000.0f, active_mhz);
+
+    // Core 0 never sleeps while active; in idle it is awake for awake_share
+    float active_ma = POWER_STATIC_MA + POWER_MA_PER_MHZ * active_mhz;
+    float idle_ma = POWER_STATIC_MA + POWER_MA_PER_MHZ * idle_mhz *
+                    (POWER_WFI_SHARE + (1.0f - POWER_WFI_SHARE) * awake_share);
+    float average_ma = active_ma * (1.0f - idle_share) + idle_ma * idle_share;
+
+    printf("Power: deep idle %s (after %d ms silence, %.0f MHz)\n",
+           enabled ? "enabled" : "disabled", POWER_IDLE_DELAY_MS, idle_mhz);
+    printf("  Residency: active %.1f s, idle %.1f s (%.1f%%), %lu entries\n",
+           active_us / 1000000.0f, s.idle_us / 1000000.0f, idle_share * 100.0f,
+           (unsigned long)s.entries);
+    printf("  Idle core 0 awake: %.2f%% (USB and wake-up interrupts)\n", awake_share * 100.0f);
+    printf("  Wakes: %lu button, %lu serial\n", (unsigned long)s.wakes[POWER_WAKE_BUTTON],
+           (unsigned long)s.wakes[POWER_WAKE_SERIAL]);
+    if (s.entries > 0) {
+        printf("  Wake to audio: last %lu us, mean %lu us, max %lu us (+ up to one sample period)\n",
+               (unsigned long)s.wake_last_us, (unsigned long)(s.wake_total_us / s.entries),
+               (unsigned long)s.wake_max_us);
+    }
+    printf("  Estimated current: active %.1f mA at %.0f MHz, idle %.1f mA, average %.1f mA\n",
+           active_ma, active_mhz, idle_ma, average_ma);
+}
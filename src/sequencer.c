@@ -0,0 +1,479 @@
+/**
+ * Step Sequencer Implementation
+ *
+ * This module runs a tempo-synced step sequencer and arpeggiator off the
+ * sample counter. The main loop turns steps that start within
+ * SEQ_LOOKAHEAD_MS into timestamped events (frequency, waveform, note on,
+ * note off) and pushes them into a fixed-size binary heap. The sample
+ * interrupt pops every event that is due on the current sample before it
+ * renders, so notes start on exact sample boundaries no matter when the
+ * main loop got to them. Drum hits ride the same queue.
+ */
+
+#include "sequencer.h"
+#include "adsr_envelope.h"
+#include "drums.h"
+#include "karplus_strong.h"
+#include "modulation.h"
+#include "waveform_generator.h"
+#include "timebase.h"
+#include "tuning.h"
+#include "uart_comm.h"
+#include "hardware/sync.h"
+
+// Event queue (min-heap on time, then queue order); pushed by the main loop
+// with interrupts disabled, popped by the sample interrupt
+static seq_event_t queue[SEQ_QUEUE_SIZE];
+static volatile uint8_t queue_count = 0;
+static uint32_t queue_order = 0;
+static volatile seq_stats_t stats;
+
+// Pattern
+static seq_step_t pattern[SEQ_MAX_STEPS];
+static uint8_t pattern_length = 8;
+static float tempo = SEQ_DEFAULT_TEMPO;
+
+// Arpeggiator
+static arp_mode_t arp_mode = ARP_OFF;
+static uint8_t arp_octaves = 1;
+static int8_t arp_notes[SEQ_ARP_MAX_NOTES] = {0, 4, 7};
+static uint8_t arp_note_count = 3;
+static uint32_t arp_noise = 0x2545F491;
+
+// Playback position
+static bool running = false;
+static float root_frequency = 440.0f;
+static uint32_t next_step_time;     // Sample count of the next step
+static uint32_t next_step_fraction; // Fractional sample of the next step, Q16
+static uint32_t step_index;         // Steps played since start
+
+static const seq_step_t default_pattern[] = {
+    {0, 50, -1, 0}, {12, 25, -1, 0}, {7, 50, -1, 0}, {3, 50, -1, 0},
+    {0, 50, -1, 0}, {7, 25, -1, 0}, {10, 50, -1, 0}, {12, 75, -1, 0}
+};
+
+static bool AUDIO_HOT_FUNC(seq_event_before)(const seq_event_t *a, const seq_event_t *b) {
+    int32_t delta = (int32_t)(a->time - b->time);
+    return delta < 0 || (delta == 0 && (int32_t)(a->order - b->order) < 0);
+}
+
+static void AUDIO_HOT_FUNC(seq_queue_pop)(void) {
+    uint8_t count = --queue_count;
+    seq_event_t last = queue[count];
+    uint8_t index = 0;
+
+    // Sift the last event down from the root
+    while (true) {
+        uint8_t child = index * 2 + 1;
+        if (child >= count) {
+            break;
+        }
+        if (child + 1 < count && seq_event_before(&queue[child + 1], &queue[child])) {
+            child++;
+        }
+        if (!seq_event_before(&queue[child], &last)) {
+            break;
+        }
+        queue[index] = queue[child];
+        index = child;
+    }
+    queue[index] = last;
+}
+
+/**
+ * Add an event to the queue
+ * @return false if the queue is full
+ */
+static bool seq_queue_push(seq_event_t *event) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (queue_count == SEQ_QUEUE_SIZE) {
+        stats.dropped++;
+        restore_interrupts(irq_state);
+        return false;
+    }
+
+    event->order = queue_order++;
+    uint8_t index = queue_count++;
+    while (index > 0) {
+        uint8_t parent = (index - 1) / 2;
+        if (!seq_event_before(event, &queue[parent])) {
+            break;
+        }
+        queue[index] = queue[parent];
+        index = parent;
+    }
+    queue[index] = *event;
+    restore_interrupts(irq_state);
+    return true;
+}
+
+static void AUDIO_HOT_FUNC(seq_apply)(sound_system_t *system, const seq_event_t *event) {
+    switch (event->type) {
+        case SEQ_EVENT_NOTE_ON:
+            adsr_gate(system, true);
+            break;
+        case SEQ_EVENT_NOTE_OFF:
+            adsr_gate(system, false);
+            break;
+        case SEQ_EVENT_FREQUENCY:
+            system->frequency = event->frequency;
+            system->phase_increment = event->phase_increment;
+            system->phase_increment_fraction = event->phase_fraction;
+            modulation_set_base_increment(event->phase_increment, event->phase_fraction);
+            break;
+        case SEQ_EVENT_WAVEFORM:
+            waveform_select(system, event->waveform);
+            break;
+        case SEQ_EVENT_DRUM:
+            for (int voice = 0; voice < DRUM_VOICE_COUNT; voice++) {
+                if (event->drums & (1u << voice)) {
+                    drums_trigger(voice, 32768);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void AUDIO_HOT_FUNC(sequencer_process)(sound_system_t *system) {
+    if (queue_count == 0) {
+        return;
+    }
+
+    uint32_t now = timebase_get_sample_count();
+    while (queue_count > 0 && (int32_t)(now - queue[0].time) >= 0) {
+        seq_event_t event = queue[0];
+        seq_queue_pop();
+
+        uint32_t late = now - event.time;
+        if (late > 0) {
+            stats.late++;
+            if (late > stats.max_late) {
+                stats.max_late = late;
+            }
+        }
+        stats.events++;
+        seq_apply(system, &event);
+    }
+}
+
+void sequencer_init(void) {
+    sequencer_clear();
+    for (uint i = 0; i < count_of(default_pattern); i++) {
+        pattern[i] = default_pattern[i];
+    }
+    pattern_length = count_of(default_pattern);
+    tempo = SEQ_DEFAULT_TEMPO;
+    running = false;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    queue_count = 0;
+    stats.events = 0;
+    stats.late = 0;
+    stats.max_late = 0;
+    stats.dropped = 0;
+    restore_interrupts(irq_state);
+
+    printf("Sequencer initialized (%d steps, %d-event queue)\n", SEQ_MAX_STEPS, SEQ_QUEUE_SIZE);
+}
+
+void sequencer_start(sound_system_t *system) {
+    if (running) {
+        return;
+    }
+
+    root_frequency = system->frequency;
+    step_index = 0;
+    next_step_fraction = 0;
+
+    // First step one lookahead from now, so it is queued before it is due
+    uint32_t irq_state = save_and_disable_interrupts();
+    stats.events = 0;
+    stats.late = 0;
+    stats.max_late = 0;
+    stats.dropped = 0;
+    next_step_time = timebase_get_sample_count() +
+                     (uint32_t)(timebase_get_sample_rate() * SEQ_LOOKAHEAD_MS / 1000.0f);
+    restore_interrupts(irq_state);
+
+    running = true;
+    printf("Sequencer started (%.1f BPM, root %.1f Hz)\n", tempo, root_frequency);
+}
+
+void sequencer_stop(sound_system_t *system) {
+    if (!running) {
+        return;
+    }
+    running = false;
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    queue_count = 0;
+    restore_interrupts(irq_state);
+
+    adsr_note_off(system);
+    printf("Sequencer stopped\n");
+}
+
+bool sequencer_is_running(void) {
+    return running;
+}
+
+bool sequencer_set_tempo(float bpm) {
+    if (bpm < SEQ_MIN_TEMPO || bpm > SEQ_MAX_TEMPO) {
+        return false;
+    }
+    tempo = bpm;
+    return true;
+}
+
+bool sequencer_set_length(uint8_t length) {
+    if (length < 1 || length > SEQ_MAX_STEPS) {
+        return false;
+    }
+    pattern_length = length;
+    return true;
+}
+
+bool sequencer_set_step(uint8_t index, int note, int gate, int waveform) {
+    if (index >= SEQ_MAX_STEPS || gate < 1 || gate > 100 || waveform >= WAVEFORM_COUNT) {
+        return false;
+    }
+    if (note != SEQ_REST && (note < -SEQ_NOTE_RANGE || note > SEQ_NOTE_RANGE)) {
+        return false;
+    }
+    pattern[index].note = note;
+    pattern[index].gate = gate;
+    pattern[index].waveform = waveform < 0 ? -1 : waveform;
+    return true;
+}
+
+bool sequencer_set_drums(uint8_t index, uint8_t drums) {
+    if (index >= SEQ_MAX_STEPS || drums >= (1u << DRUM_VOICE_COUNT)) {
+        return false;
+    }
+    pattern[index].drums = drums;
+    return true;
+}
+
+void sequencer_clear(void) {
+    for (int i = 0; i < SEQ_MAX_STEPS; i++) {
+        pattern[i].note = SEQ_REST;
+        pattern[i].gate = 50;
+        pattern[i].waveform = -1;
+        pattern[i].drums = 0;
+    }
+}
+
+void sequencer_set_root(float frequency) {
+    root_frequency = frequency;
+}
+
+bool sequencer_set_arp(arp_mode_t mode, uint8_t octaves) {
+    if (mode >= ARP_MODE_COUNT || octaves < 1 || octaves > SEQ_ARP_MAX_OCTAVES) {
+        return false;
+    }
+    arp_mode = mode;
+    arp_octaves = octaves;
+    return true;
+}
+
+bool sequencer_set_arp_notes(const int8_t *notes, uint8_t count) {
+    if (count < 1 || count > SEQ_ARP_MAX_NOTES) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (notes[i] < -SEQ_NOTE_RANGE || notes[i] > SEQ_NOTE_RANGE) {
+            return false;
+        }
+    }
+
+    // Insertion sort, low to high
+    for (int i = 0; i < count; i++) {
+        int8_t note = notes[i];
+        int j = i;
+        while (j > 0 && arp_notes[j - 1] > note) {
+            arp_notes[j] = arp_notes[j - 1];
+            j--;
+        }
+        arp_notes[j] = note;
+    }
+    arp_note_count = count;
+    return true;
+}
+
+const char* sequencer_get_arp_mode_name(arp_mode_t mode) {
+    switch (mode) {
+        case ARP_OFF:    return "off";
+        case ARP_UP:     return "up";
+        case ARP_DOWN:   return "down";
+        case ARP_UPDOWN: return "updown";
+        case ARP_RANDOM: return "random";
+        default:         return "unknown";
+    }
+}
+
+/**
+ * Arpeggiator note for a step: the held notes repeated over arp_octaves
+ * periods of the active scale (12 semitones, or the Scala degree count)
+ */
+static int seq_arp_note(uint32_t step) {
+    uint32_t span = arp_note_count * arp_octaves;
+    uint32_t index;
+
+    switch (arp_mode) {
+        case ARP_DOWN:
+            index = span - 1 - step % span;
+            break;
+        case ARP_UPDOWN: {
+            // Top and bottom notes are not repeated at the turns
+            uint32_t period = (span > 1) ? 2 * span - 2 : 1;
+            index = step % period;
+            if (index >= span) {
+                index = period - index;
+            }
+            break;
+        }
+        case ARP_RANDOM:
+            arp_noise ^= arp_noise << 13;
+            arp_noise ^= arp_noise >> 17;
+            arp_noise ^= arp_noise << 5;
+            index = arp_noise % span;
+            break;
+        default:
+            index = step % span;
+            break;
+    }
+    return arp_notes[index % arp_note_count] + tuning_degree_count() * (int)(index / arp_note_count);
+}
+
+/**
+ * Queue the events of one step starting at sample time
+ */
+static void seq_schedule_step(sound_system_t *system, uint32_t time, uint32_t step_samples) {
+    seq_step_t step = pattern[step_index % pattern_length];
+    int note = step.note;
+    if (arp_mode != ARP_OFF) {
+        // The arpeggiator plays over the pattern's drums
+        note = seq_arp_note(step_index);
+        step.gate = SEQ_ARP_GATE;
+        step.waveform = -1;
+    }
+    step_index++;
+
+    seq_event_t event = {.time = time};
+    if (step.drums) {
+        event.type = SEQ_EVENT_DRUM;
+        event.drums = step.drums;
+        seq_queue_push(&event);
+    }
+    uint8_t waveform = system->current_waveform;
+    if (step.waveform >= 0) {
+        waveform = step.waveform;
+        event.type = SEQ_EVENT_WAVEFORM;
+        event.waveform = waveform;
+        seq_queue_push(&event);
+    }
+    if (note == SEQ_REST) {
+        return;
+    }
+
+    float frequency;
+    int root_note = tuning_nearest(root_frequency, -1);
+    if (root_note >= 0) {
+        // Notes count scale steps, so a 12-note just scale plays pure intervals
+        frequency = tuning_note_frequency(root_note + note);
+        event.phase_increment = tuning_note_increment(root_note + note, &event.phase_fraction);
+    } else {
+        frequency = root_frequency * exp2f(note / 12.0f);
+        if (frequency < MIN_FREQUENCY) frequency = MIN_FREQUENCY;
+        if (frequency > MAX_FREQUENCY) frequency = MAX_FREQUENCY;
+        event.phase_increment = tuning_frequency_to_increment(frequency, &event.phase_fraction);
+    }
+
+    event.type = SEQ_EVENT_FREQUENCY;
+    event.frequency = frequency;
+    seq_queue_push(&event);
+
+    // Strings are filled now and start sounding on the note's sample
+    if (waveform == WAVEFORM_PLUCK) {
+        ks_pluck_at(frequency, time);
+    }
+
+    event.type = SEQ_EVENT_NOTE_ON;
+    seq_queue_push(&event);
+
+    uint32_t gate_samples = step_samples * step.gate / 100;
+    event.type = SEQ_EVENT_NOTE_OFF;
+    event.time = time + (gate_samples > 0 ? gate_samples : 1);
+    seq_queue_push(&event);
+}
+
+void sequencer_service(sound_system_t *system) {
+    if (!running) {
+        return;
+    }
+
+    float rate = timebase_get_sample_rate();
+    uint32_t lookahead = (uint32_t)(rate * SEQ_LOOKAHEAD_MS / 1000.0f);
+
+    // Step length in Q16 samples, so steps do not drift at non-integer lengths
+    uint64_t step_length = (uint64_t)((double)rate * 60.0 * 65536.0 / (tempo * SEQ_STEPS_PER_BEAT));
+    uint32_t now = timebase_get_sample_count();
+
+    while ((int32_t)(next_step_time - now) < (int32_t)lookahead) {
+        seq_schedule_step(system, next_step_time, (uint32_t)(step_length >> 16));
+
+        uint64_t advance = next_step_fraction + step_length;
+        next_step_time += (uint32_t)(advance >> 16);
+        next_step_fraction = (uint32_t)(advance & 0xFFFF);
+    }
+}
+
+void sequencer_get_stats(seq_stats_t *stats_out) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    stats_out->events = stats.events;
+    stats_out->late = stats.late;
+    stats_out->max_late = stats.max_late;
+    stats_out->dropped = stats.dropped;
+    restore_interrupts(irq_state);
+}
+
+void sequencer_print_status(void) {
+    seq_stats_t timing;
+    sequencer_get_stats(&timing);
+
+    printf("Sequencer: %s, %.1f BPM, %d steps, root %.1f Hz\n",
+           running ? "running" : "stopped", tempo, pattern_length, root_frequency);
+    printf("  Steps:");
+    for (int i = 0; i < pattern_length; i++) {
+        if (pattern[i].note == SEQ_REST) {
+            printf(" -");
+        } else {
+            printf(" %+d/%d%%", pattern[i].note, pattern[i].gate);
+        }
+        if (pattern[i].waveform >= 0) {
+            printf("(%s)", uart_get_waveform_name(pattern[i].waveform));
+        }
+        char separator = '[';
+        for (int voice = 0; voice < DRUM_VOICE_COUNT; voice++) {
+            if (pattern[i].drums & (1u << voice)) {
+                printf("%c%s", separator, drums_get_voice_name(voice));
+                separator = '+';
+            }
+        }
+        if (separator != '[') {
+            printf("]");
+        }
+    }
+    printf("\n");
+    printf("  Arpeggiator: %s, %d octave%s, notes", sequencer_get_arp_mode_name(arp_mode),
+           arp_octaves, arp_octaves > 1 ? "s" : "");
+    for (int i = 0; i < arp_note_count; i++) {
+        printf(" %+d", arp_notes[i]);
+    }
+    printf("\n");
+    printf("  Events: %lu applied, %lu late (jitter %lu samples), %lu dropped\n",
+           (unsigned long)timing.events, (unsigned long)timing.late,
+           (unsigned long)timing.max_late, (unsigned long)timing.dropped);
+}
@@ -0,0 +1,274 @@
+/**
+ * Spectrum Analyzer Implementation
+ *
+ * This module taps the rendered output stream into a capture buffer and
+ * analyzes it on core 1 with a fixed-point radix-4 FFT. The peak
+ * frequency, THD and noise floor are published for the status output, so
+ * the device can check that what it renders matches the set frequency.
+ */
+
+#include "spectrum_analyzer.h"
+#include "timebase.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+_Static_assert(SPECTRUM_FFT_SIZE == 256 || SPECTRUM_FFT_SIZE == 1024,
+               "SPECTRUM_FFT_SIZE must be a power of four (256 or 1024)");
+
+#define SPECTRUM_SKIP_BINS 3        // DC and window leakage bins ignored for peak search
+#define SPECTRUM_LOBE_BINS 2        // Hann main lobe half-width in bins
+#define SPECTRUM_MIN_LEVEL_DB -40.0f // Weaker peaks are not used for the self-test
+
+// Full-scale sine after Hann window and 1/N scaling: amplitude 2^23 / 4
+#define SPECTRUM_FULL_SCALE_POWER 4398046511104.0f  // (2^21)^2
+
+// Twiddle factors cos/sin(2*pi*k/N) and Hann window, Q15
+static int16_t twiddle_cos[SPECTRUM_FFT_SIZE];
+static int16_t twiddle_sin[SPECTRUM_FFT_SIZE];
+static int16_t hann_window[SPECTRUM_FFT_SIZE];
+
+// Filled by the sample interrupt, consumed by core 1
+static uint8_t capture_buffer[SPECTRUM_FFT_SIZE];
+static volatile uint16_t capture_index = 0;
+static volatile bool capture_ready = false;
+
+// Core 1 working data
+static int32_t fft_data[2 * SPECTRUM_FFT_SIZE];
+static float bin_power[SPECTRUM_FFT_SIZE / 2];
+static bool bin_excluded[SPECTRUM_FFT_SIZE / 2];
+
+// Latest result, published with a sequence counter (odd while writing)
+static spectrum_result_t latest_result;
+static volatile uint32_t result_sequence = 0;
+
+static void CORE1_SCRATCH_FUNC(spectrum_digit_reverse)(int32_t *data, uint16_t n) {
+    int digits = 0;
+    for (uint16_t m = n; m > 1; m >>= 2) {
+        digits++;
+    }
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t reversed = 0;
+        uint16_t value = i;
+        for (int d = 0; d < digits; d++) {
+            reversed = (reversed << 2) | (value & 3);
+            value >>= 2;
+        }
+        if (reversed > i) {
+            int32_t re = data[2 * i];
+            int32_t im = data[2 * i + 1];
+            data[2 * i] = data[2 * reversed];
+            data[2 * i + 1] = data[2 * reversed + 1];
+            data[2 * reversed] = re;
+            data[2 * reversed + 1] = im;
+        }
+    }
+}
+
+void CORE1_SCRATCH_FUNC(spectrum_fft)(int32_t *data, uint16_t n) {
+    uint16_t table_step = SPECTRUM_FFT_SIZE / n;
+
+    for (uint16_t span = n; span > 1; span >>= 2) {
+        uint16_t quarter = span >> 2;
+        uint16_t step = table_step * (n / span);
+
+        for (uint16_t j = 0; j < quarter; j++) {
+            int32_t w1c = twiddle_cos[j * step],     w1s = twiddle_sin[j * step];
+            int32_t w2c = twiddle_cos[2 * j * step], w2s = twiddle_sin[2 * j * step];
+            int32_t w3c = twiddle_cos[3 * j * step], w3s = twiddle_sin[3 * j * step];
+
+            for (uint16_t i = j; i < n; i += span) {
+                int32_t *a = &data[2 * i];
+                int32_t *b = &data[2 * (i + quarter)];
+                int32_t *c = &data[2 * (i + 2 * quarter)];
+                int32_t *d = &data[2 * (i + 3 * quarter)];
+
+                int32_t t0r = a[0] + c[0], t0i = a[1] + c[1];
+                int32_t t1r = a[0] - c[0], t1i = a[1] - c[1];
+                int32_t t2r = b[0] + d[0], t2i = b[1] + d[1];
+                int32_t t3r = b[0] - d[0], t3i = b[1] - d[1];
+
+                // Butterfly outputs, scaled by 1/4 to keep headroom
+                int32_t x0r = (t0r + t2r) >> 2, x0i = (t0i + t2i) >> 2;
+                int32_t x1r = (t1r + t3i) >> 2, x1i = (t1i - t3r) >> 2;
+                int32_t x2r = (t0r - t2r) >> 2, x2i = (t0i - t2i) >> 2;
+                int32_t x3r = (t1r - t3i) >> 2, x3i = (t1i + t3r) >> 2;
+
+                // Multiply by conj twiddles e^(-j*2*pi*k/span)
+                a[0] = x0r;
+                a[1] = x0i;
+                b[0] = (int32_t)(((int64_t)x1r * w1c + (int64_t)x1i * w1s) >> 15);
+                b[1] = (int32_t)(((int64_t)x1i * w1c - (int64_t)x1r * w1s) >> 15);
+                c[0] = (int32_t)(((int64_t)x2r * w2c + (int64_t)x2i * w2s) >> 15);
+                c[1] = (int32_t)(((int64_t)x2i * w2c - (int64_t)x2r * w2s) >> 15);
+                d[0] = (int32_t)(((int64_t)x3r * w3c + (int64_t)x3i * w3s) >> 15);
+                d[1] = (int32_t)(((int64_t)x3i * w3c - (int64_t)x3r * w3s) >> 15);
+            }
+        }
+    }
+
+    spectrum_digit_reverse(data, n);
+}
+
+static float CORE1_HOT_FUNC(spectrum_band_power)(int center, int half_width) {
+    float power = 0.0f;
+    for (int k = center - half_width; k <= center + half_width; k++) {
+        if (k >= 0 && k < SPECTRUM_FFT_SIZE / 2) {
+            power += bin_power[k];
+            bin_excluded[k] = true;
+        }
+    }
+    return power;
+}
+
+static void CORE1_HOT_FUNC(spectrum_analyze)(spectrum_result_t *result) {
+    const int bins = SPECTRUM_FFT_SIZE / 2;
+    const float bin_width = timebase_get_sample_rate() / SPECTRUM_FFT_SIZE;
+
+    for (int k = 0; k < bins; k++) {
+        float re = (float)fft_data[2 * k];
+        float im = (float)fft_data[2 * k + 1];
+        bin_power[k] = re * re + im * im + 1.0f;   // +1 keeps logf finite
+        bin_excluded[k] = k < SPECTRUM_SKIP_BINS;
+    }
+
+    int peak = SPECTRUM_SKIP_BINS;
+    for (int k = SPECTRUM_SKIP_BINS + 1; k < bins - 1; k++) {
+        if (bin_power[k] > bin_power[peak]) {
+            peak = k;
+        }
+    }
+
+    // Parabolic interpolation on log magnitude around the peak bin
+    float alpha = logf(bin_power[peak - 1]);
+    float beta = logf(bin_power[peak]);
+    float gamma = logf(bin_power[peak + 1]);
+    float denominator = alpha - 2.0f * beta + gamma;
+    float offset = (denominator != 0.0f) ? 0.5f * (alpha - gamma) / denominator : 0.0f;
+    result->peak_frequency = (peak + offset) * bin_width;
+    result->peak_level_db = 10.0f * log10f(bin_power[peak] / SPECTRUM_FULL_SCALE_POWER);
+
+    float fundamental = spectrum_band_power(peak, SPECTRUM_LOBE_BINS);
+    float harmonics = 0.0f;
+    for (int h = 2; h <= SPECTRUM_MAX_HARMONIC; h++) {
+        int center = (int)lrintf(h * (peak + offset));
+        if (center + SPECTRUM_LOBE_BINS >= bins) {
+            break;
+        }
+        harmonics += spectrum_band_power(center, SPECTRUM_LOBE_BINS);
+    }
+    result->thd_percent = sqrtf(harmonics / fundamental) * 100.0f;
+
+    float noise = 0.0f;
+    int noise_bins = 0;
+    for (int k = 0; k < bins; k++) {
+        if (!bin_excluded[k]) {
+            noise += bin_power[k];
+            noise_bins++;
+        }
+    }
+    result->noise_floor_db = (noise_bins > 0)
+        ? 10.0f * log10f(noise / noise_bins / SPECTRUM_FULL_SCALE_POWER)
+        : -200.0f;
+}
+
+/**
+ * Window the full capture buffer into Q23, then hand it back to the interrupt
+ */
+static void CORE1_HOT_FUNC(spectrum_window_capture)(void) {
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        int32_t sample = ((int32_t)capture_buffer[i] - 128) << 16;
+        fft_data[2 * i] = (int32_t)(((int64_t)sample * hann_window[i]) >> 15);
+        fft_data[2 * i + 1] = 0;
+    }
+    capture_index = 0;
+    __dmb();
+    capture_ready = false;
+}
+
+static void CORE1_HOT_FUNC(spectrum_core1_entry)(void) {
+    spectrum_result_t result = {0};
+
+    while (true) {
+        while (!capture_ready) {
+            __wfe();
+        }
+
+        spectrum_window_capture();
+        spectrum_fft(fft_data, SPECTRUM_FFT_SIZE);
+        spectrum_analyze(&result);
+        result.frames++;
+
+        result_sequence++;
+        __dmb();
+        latest_result = result;
+        __dmb();
+        result_sequence++;
+    }
+}
+
+void spectrum_analyzer_init(void) {
+    for (int k = 0; k < SPECTRUM_FFT_SIZE; k++) {
+        float angle = 2.0f * (float)M_PI * k / SPECTRUM_FFT_SIZE;
+        twiddle_cos[k] = (int16_t)lrintf(cosf(angle) * 32767.0f);
+        twiddle_sin[k] = (int16_t)lrintf(sinf(angle) * 32767.0f);
+        hann_window[k] = (int16_t)lrintf((0.5f - 0.5f * cosf(angle)) * 32767.0f);
+    }
+
+    multicore_launch_core1(spectrum_core1_entry);
+    printf("Spectrum analyzer initialized (%d-point FFT on core 1)\n", SPECTRUM_FFT_SIZE);
+}
+
+void AUDIO_HOT_FUNC(spectrum_tap)(uint8_t sample) {
+    if (capture_ready) {
+        return;
+    }
+
+    capture_buffer[capture_index++] = sample;
+    if (capture_index >= SPECTRUM_FFT_SIZE) {
+        capture_ready = true;
+        __sev(); // Wake core 1
+    }
+}
+
+bool spectrum_get_result(spectrum_result_t *result) {
+    uint32_t sequence;
+    do {
+        sequence = result_sequence;
+        __dmb();
+        *result = latest_result;
+        __dmb();
+    } while ((sequence & 1) || sequence != result_sequence);
+
+    return result->frames > 0;
+}
+
+void spectrum_print_status(sound_system_t *system) {
+    spectrum_result_t result;
+
+    if (!spectrum_get_result(&result)) {
+        printf("Spectrum: no analysis yet\n");
+        return;
+    }
+
+    printf("Spectrum (%d-point FFT, frame %lu):\n", SPECTRUM_FFT_SIZE, (unsigned long)result.frames);
+    printf("  Peak: %.1f Hz at %.1f dBFS\n", result.peak_frequency, result.peak_level_db);
+    printf("  THD: %.2f%%\n", result.thd_percent);
+    printf("  Noise floor: %.1f dBFS/bin\n", result.noise_floor_db);
+
+    float bin_width = timebase_get_sample_rate() / SPECTRUM_FFT_SIZE;
+    if (!system->output_enabled || result.peak_level_db < SPECTRUM_MIN_LEVEL_DB) {
+        printf("  Self-test: skipped (no signal)\n");
+        return;
+    }
+    if (system->frequency < SPECTRUM_SKIP_BINS * bin_width) {
+        printf("  Self-test: skipped (below %.0f Hz resolution)\n", SPECTRUM_SKIP_BINS * bin_width);
+        return;
+    }
+
+    float tolerance = bin_width / 2.0f;
+    float error = result.peak_frequency - system->frequency;
+    printf("  Self-test: %s (set %.1f Hz, error %.1f Hz, tolerance %.1f Hz)\n",
+           fabsf(error) <= tolerance ? "PASS" : "FAIL",
+           system->frequency, error, tolerance);
+}
@@ -0,0 +1,211 @@
+/**
+ * Timebase Implementation
+ *
+ * This module derives the audio PWM divider and wrap from the actual
+ * clk_sys frequency, so the sample rate (and therefore every pitch) is
+ * right on both 125 MHz and 150 MHz parts and after overclocking. All
+ * rate-dependent increments are recomputed from the exact achieved rate.
+ */
+
+#include "timebase.h"
+#include "waveform_generator.h"
+#include "adsr_envelope.h"
+#include "modulation.h"
+#include "karplus_strong.h"
+#include "drums.h"
+#include "granular.h"
+#include "audio_input.h"
+#include "tuning.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/vreg.h"
+
+#define TIMEBASE_MEASURE_MS 500     // Sample clock measurement window
+
+static const uint32_t supported_rates[] = {22050, 44100, 48000, TIMEBASE_MAX_SAMPLE_RATE};
+
+static uint32_t nominal_rate = SAMPLE_RATE;
+static float actual_rate = SAMPLE_RATE;
+static uint16_t pwm_levels = 256;
+static uint32_t pwm_divider = 1;
+static volatile uint32_t sample_counter = 0;
+static uint32_t resume_khz = 0;     // Clock to restore after deep idle
+
+/**
+ * Program the PWM slice for nominal_rate at the current clk_sys. The divider
+ * stays an integer to avoid fractional-divider jitter; the rounding error of
+ * the wrap is absorbed by using the exact achieved rate everywhere else.
+ */
+static void timebase_apply(void) {
+    uint32_t sys_hz = clock_get_hz(clk_sys);
+    uint32_t divider = 1;
+
+    while ((sys_hz / divider) / nominal_rate > 65536) {
+        divider++;
+    }
+
+    uint32_t period = (sys_hz / divider + nominal_rate / 2) / nominal_rate;
+    uint slice = pwm_gpio_to_slice_num(PWM_OUTPUT_PIN);
+    pwm_set_clkdiv_int_frac(slice, divider, 0);
+    pwm_set_wrap(slice, period - 1);
+
+    pwm_divider = divider;
+    pwm_levels = period;
+    actual_rate = (float)sys_hz / ((float)divider * period);
+}
+
+static void timebase_recompute(sound_system_t *system) {
+    // Note increments first; the oscillator increment may come from the table
+    tuning_refresh_rates();
+    update_phase_accumulator(system);
+    adsr_update(system);
+    modulation_refresh_rates();
+    modulation_update_control(system);
+    drums_refresh_rates();
+    granular_refresh_rates();
+    audio_input_refresh_rates();
+
+    // String delay lines were tuned for the old rate
+    ks_reset();
+}
+
+void timebase_init(void) {
+    if (TIMEBASE_SYS_CLOCK_KHZ != 0) {
+        if (TIMEBASE_SYS_CLOCK_KHZ > TIMEBASE_VREG_BOOST_KHZ) {
+            vreg_set_voltage(VREG_VOLTAGE_1_20);
+            sleep_ms(10);
+        }
+        set_sys_clock_khz(TIMEBASE_SYS_CLOCK_KHZ, true);
+    }
+
+    timebase_apply();
+    printf("Timebase initialized (clk_sys %.1f MHz, %.2f Hz sample rate)\n",
+           clock_get_hz(clk_sys) / 1000000.0f, actual_rate);
+}
+
+bool timebase_set_sample_rate(sound_system_t *system, uint32_t sample_rate) {
+    bool supported = false;
+    for (uint i = 0; i < count_of(supported_rates); i++) {
+        if (supported_rates[i] == sample_rate) {
+            supported = true;
+        }
+    }
+    if (!supported) {
+        return false;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    nominal_rate = sample_rate;
+    timebase_apply();
+    timebase_recompute(system);
+    restore_interrupts(irq_state);
+
+    printf("Sample rate: %.2f Hz (requested %lu Hz)\n", actual_rate, (unsigned long)sample_rate);
+    return true;
+}
+
+bool timebase_set_system_clock(sound_system_t *system, uint32_t khz) {
+    if (khz < TIMEBASE_MIN_SYS_CLOCK_KHZ || khz > TIMEBASE_MAX_SYS_CLOCK_KHZ) {
+        return false;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+
+    // Raise the core voltage before speeding up, lower it after slowing down
+    if (khz > TIMEBASE_VREG_BOOST_KHZ) {
+        vreg_set_voltage(VREG_VOLTAGE_1_20);
+        busy_wait_us(10000);
+    }
+    bool ok = set_sys_clock_khz(khz, false);
+    if (ok && khz <= TIMEBASE_VREG_BOOST_KHZ) {
+        vreg_set_voltage(VREG_VOLTAGE_DEFAULT);
+    }
+
+    timebase_apply();
+    timebase_recompute(system);
+    restore_interrupts(irq_state);
+
+    if (ok) {
+        printf("System clock: %.1f MHz, sample rate %.2f Hz\n",
+               clock_get_hz(clk_sys) / 1000000.0f, actual_rate);
+    }
+    return ok;
+}
+
+bool timebase_enter_idle_clock(uint32_t khz) {
+    uint32_t current_khz = clock_get_hz(clk_sys) / 1000;
+    if (khz >= current_khz) {
+        return false;
+    }
+
+    uint32_t irq_state = save_and_disable_interrupts();
+    bool ok = set_sys_clock_khz(khz, false);
+    if (ok) {
+        resume_khz = current_khz;
+        timebase_apply();
+        pwm_set_gpio_level(PWM_OUTPUT_PIN, pwm_levels >> 1);
+    }
+    restore_interrupts(irq_state);
+    return ok;
+}
+
+void timebase_exit_idle_clock(void) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    set_sys_clock_khz(resume_khz, true);
+    timebase_apply();
+    pwm_set_gpio_level(PWM_OUTPUT_PIN, pwm_levels >> 1);
+    restore_interrupts(irq_state);
+}
+
+float AUDIO_HOT_FUNC(timebase_get_sample_rate)(void) {
+    return actual_rate;
+}
+
+uint32_t timebase_get_nominal_rate(void) {
+    return nominal_rate;
+}
+
+uint16_t AUDIO_HOT_FUNC(timebase_get_pwm_levels)(void) {
+    return pwm_levels;
+}
+
+uint32_t timebase_get_pwm_divider(void) {
+    return pwm_divider;
+}
+
+void AUDIO_HOT_FUNC(timebase_count_sample)(void) {
+    sample_counter++;
+}
+
+uint32_t AUDIO_HOT_FUNC(timebase_get_sample_count)(void) {
+    return sample_counter;
+}
+
+void timebase_print_status(void) {
+    printf("Timebase: clk_sys %.1f MHz, divider %lu, wrap %u\n",
+           clock_get_hz(clk_sys) / 1000000.0f, (unsigned long)pwm_divider, pwm_levels - 1);
+    printf("Sample Rate: %.2f Hz (nominal %lu Hz, %.3f cents)\n",
+           actual_rate, (unsigned long)nominal_rate,
+           1200.0f * log2f(actual_rate / nominal_rate));
+}
+
+void timebase_measure_pitch(sound_system_t *system) {
+    uint32_t start_count = sample_counter;
+    uint64_t start = time_us_64();
+    sleep_ms(TIMEBASE_MEASURE_MS);
+    uint32_t counted = sample_counter - start_count;
+    uint64_t elapsed = time_us_64() - start;
+
+    float measured_rate = counted * 1000000.0f / (float)elapsed;
+    uint32_t fraction = tuning_is_high_precision() ? system->phase_increment_fraction : 0;
+    float produced = (float)((system->phase_increment + fraction / 4294967296.0) * measured_rate / 4294967296.0);
+
+    printf("Pitch measurement (%lu samples in %llu us):\n",
+           (unsigned long)counted, (unsigned long long)elapsed);
+    printf("  Measured sample rate: %.2f Hz (timebase %.2f Hz, %.2f cents)\n",
+           measured_rate, actual_rate, 1200.0f * log2f(measured_rate / actual_rate));
+    printf("  Set frequency: %.2f Hz, produced: %.2f Hz, error %.2f cents\n",
+           system->frequency, produced, 1200.0f * log2f(produced / system->frequency));
+    printf("  Error if increments assumed %lu Hz: %.2f cents\n",
+           (unsigned long)nominal_rate, 1200.0f * log2f(measured_rate / nominal_rate));
+}
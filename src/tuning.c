@@ -0,0 +1,334 @@
+/**
+ * Tuning Implementation
+ *
+ * This module quantizes pitch to a scale (12-TET, 5-limit just intonation
+ * or Scala-style degrees) and precomputes a table of every note between
+ * MIN_FREQUENCY and MAX_FREQUENCY with its phase increment as a 32.32
+ * fixed-point value. The table is built in double precision, so a note's
+ * increment is exact to well below a thousandth of a cent; the fractional
+ * half is only used by the oscillator in 64-bit phase mode.
+ */
+
+#include "tuning.h"
+#include "timebase.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TUNING_TWO_POW_32 4294967296.0
+#define TUNING_TWO_POW_64 18446744073709551616.0
+#define TUNING_CHECK_STEPS_PER_OCTAVE 96    // Eighth-semitone sweep for the error report
+
+_Static_assert((1 << TUNING_TABLE_PERIODS) >= MAX_FREQUENCY / MIN_FREQUENCY,
+               "TUNING_TABLE_PERIODS octaves must span MIN_FREQUENCY-MAX_FREQUENCY");
+
+// 5-limit just intonation over the root, degrees 1-12 (1/1 implied)
+static const double just_ratios[] = {
+    16.0 / 15.0, 9.0 / 8.0, 6.0 / 5.0, 5.0 / 4.0, 4.0 / 3.0, 45.0 / 32.0,
+    3.0 / 2.0, 8.0 / 5.0, 5.0 / 3.0, 9.0 / 5.0, 15.0 / 8.0, 2.0
+};
+
+static double equal_ratios[12];
+static double scala_ratios[TUNING_MAX_DEGREES];
+static uint8_t scala_count = 0;
+
+static tuning_mode_t mode = TUNING_CONTINUOUS;
+static float root_frequency = TUNING_DEFAULT_ROOT;
+static volatile bool high_precision = false;
+
+// Note table, ascending
+static float note_frequency[TUNING_MAX_NOTES];
+static uint64_t note_increment[TUNING_MAX_NOTES];
+static int note_count = 0;
+
+static uint64_t tuning_exact_increment(double frequency) {
+    return (uint64_t)(frequency / timebase_get_sample_rate() * TUNING_TWO_POW_64 + 0.5);
+}
+
+static void tuning_build(void) {
+    const double *ratios = equal_ratios;
+    uint8_t count = count_of(equal_ratios);
+    if (mode == TUNING_JUST) {
+        ratios = just_ratios;
+        count = count_of(just_ratios);
+    } else if (mode == TUNING_SCALA && scala_count > 0) {
+        ratios = scala_ratios;
+        count = scala_count;
+    }
+
+    // Start from the period at or below MIN_FREQUENCY
+    double period = ratios[count - 1];
+    int octave = (int)floor(log(MIN_FREQUENCY / (double)root_frequency) / log(period));
+    note_count = 0;
+    while (note_count < TUNING_MAX_NOTES) {
+        double base = root_frequency * pow(period, octave++);
+        if (base > MAX_FREQUENCY) {
+            break;
+        }
+        for (int degree = 0; degree < count && note_count < TUNING_MAX_NOTES; degree++) {
+            double frequency = base * (degree == 0 ? 1.0 : ratios[degree - 1]);
+            if (frequency < MIN_FREQUENCY || frequency > MAX_FREQUENCY) {
+                continue;
+            }
+            note_frequency[note_count] = (float)frequency;
+            note_increment[note_count] = tuning_exact_increment(frequency);
+            note_count++;
+        }
+    }
+}
+
+void tuning_init(void) {
+    for (int i = 0; i < 12; i++) {
+        equal_ratios[i] = pow(2.0, (i + 1) / 12.0);
+    }
+    scala_count = 0;
+    mode = TUNING_CONTINUOUS;
+    root_frequency = TUNING_DEFAULT_ROOT;
+    high_precision = false;
+    tuning_build();
+
+    printf("Tuning initialized (%s, %d table notes)\n", tuning_get_mode_name(mode), note_count);
+}
+
+bool tuning_set_mode(tuning_mode_t new_mode) {
+    if (new_mode >= TUNING_MODE_COUNT || (new_mode == TUNING_SCALA && scala_count == 0)) {
+        return false;
+    }
+    mode = new_mode;
+    tuning_build();
+    return true;
+}
+
+tuning_mode_t tuning_get_mode(void) {
+    return mode;
+}
+
+bool tuning_is_quantized(void) {
+    return mode != TUNING_CONTINUOUS;
+}
+
+int tuning_degree_count(void) {
+    if (mode == TUNING_JUST) {
+        return count_of(just_ratios);
+    }
+    if (mode == TUNING_SCALA && scala_count > 0) {
+        return scala_count;
+    }
+    return count_of(equal_ratios);
+}
+
+bool tuning_set_root(float frequency) {
+    if (frequency < MIN_FREQUENCY || frequency > MAX_FREQUENCY) {
+        return false;
+    }
+    root_frequency = frequency;
+    tuning_build();
+    return true;
+}
+
+bool tuning_load_degrees(const float *cents, uint8_t count, bool append) {
+    uint8_t start = append ? scala_count : 0;
+    if (count == 0 || start + count > TUNING_MAX_DEGREES) {
+        return false;
+    }
+
+    // Degrees must rise from the root (or the last loaded degree)
+    float previous = start > 0 ? 1200.0f * log2f((float)scala_ratios[start - 1]) : 0.0f;
+    for (uint8_t i = 0; i < count; i++) {
+        if (cents[i] <= previous) {
+            return false;
+        }
+        previous = cents[i];
+    }
+
+    // Each degree recurs at most once per period, plus once more where the
+    // range starts part-way into a period; a short period with many degrees
+    // would not fit the table
+    double periods = log2((double)MAX_FREQUENCY / MIN_FREQUENCY) * 1200.0 / previous;
+    if ((start + count) * (floor(periods) + 1.0) > TUNING_MAX_NOTES) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        scala_ratios[start + i] = pow(2.0, cents[i] / 1200.0);
+    }
+    scala_count = start + count;
+    if (mode == TUNING_SCALA) {
+        tuning_build();
+    }
+    return true;
+}
+
+bool tuning_parse_pitch(const char *text, float *cents) {
+    char *end;
+    if (strchr(text, '.')) {
+        *cents = strtof(text, &end);
+        return *end == '\0' && *cents > 0.0f;
+    }
+
+    long numerator = strtol(text, &end, 10);
+    long denominator = 1;
+    if (*end == '/') {
+        denominator = strtol(end + 1, &end, 10);
+    }
+    if (*end != '\0' || numerator <= 0 || denominator <= 0) {
+        return false;
+    }
+    *cents = (float)(1200.0 * log2((double)numerator / denominator));
+    return *cents > 0.0f;
+}
+
+void tuning_set_high_precision(bool high) {
+    high_precision = high;
+}
+
+bool AUDIO_HOT_FUNC(tuning_is_high_precision)(void) {
+    return high_precision;
+}
+
+void tuning_refresh_rates(void) {
+    tuning_build();
+}
+
+/**
+ * First table index whose frequency is at or above the given one
+ */
+static int tuning_search(float frequency) {
+    int low = 0;
+    int high = note_count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (note_frequency[mid] < frequency) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+int tuning_nearest(float frequency, int previous) {
+    if (mode == TUNING_CONTINUOUS || note_count == 0) {
+        return -1;
+    }
+
+    // Stay on the previous note until the input is well into the next step
+    if (previous >= 0 && previous < note_count) {
+        float current = note_frequency[previous];
+        int neighbour = frequency >= current ? previous + 1 : previous - 1;
+        if (neighbour < 0 || neighbour >= note_count) {
+            return previous;
+        }
+        float position = logf(frequency / current) / logf(note_frequency[neighbour] / current);
+        if (position < TUNING_HYSTERESIS) {
+            return previous;
+        }
+    }
+
+    int above = tuning_search(frequency);
+    if (above == 0) {
+        return 0;
+    }
+    if (above == note_count) {
+        return note_count - 1;
+    }
+    // Nearest in pitch, not in Hz
+    return (frequency * frequency < note_frequency[above - 1] * note_frequency[above]) ? above - 1 : above;
+}
+
+int tuning_note_count(void) {
+    return note_count;
+}
+
+static int tuning_clamp_note(int note) {
+    if (note < 0) return 0;
+    if (note >= note_count) return note_count - 1;
+    return note;
+}
+
+float tuning_note_frequency(int note) {
+    return note_frequency[tuning_clamp_note(note)];
+}
+
+uint32_t tuning_note_increment(int note, uint32_t *fraction) {
+    uint64_t increment = note_increment[tuning_clamp_note(note)];
+    *fraction = (uint32_t)increment;
+    return (uint32_t)(increment >> 32);
+}
+
+uint32_t tuning_frequency_to_increment(float frequency, uint32_t *fraction) {
+    if (mode != TUNING_CONTINUOUS) {
+        int note = tuning_search(frequency);
+        if (note < note_count && note_frequency[note] == frequency) {
+            return tuning_note_increment(note, fraction);
+        }
+    }
+
+    uint64_t increment = tuning_exact_increment(frequency);
+    *fraction = (uint32_t)increment;
+    return (uint32_t)(increment >> 32);
+}
+
+const char* tuning_get_mode_name(tuning_mode_t tuning_mode) {
+    switch (tuning_mode) {
+        case TUNING_CONTINUOUS: return "off";
+        case TUNING_EQUAL:      return "12tet";
+        case TUNING_JUST:       return "just";
+        case TUNING_SCALA:      return "scala";
+        default:                return "unknown";
+    }
+}
+
+void tuning_print_status(void) {
+    printf("Tuning: %s, root %.2f Hz, %d table notes, %d-bit phase\n",
+           tuning_get_mode_name(mode), root_frequency, note_count, high_precision ? 64 : 32);
+    if (scala_count > 0) {
+        printf("  Scala degrees (cents):");
+        for (int i = 0; i < scala_count; i++) {
+            printf(" %.2f", 1200.0 * log2(scala_ratios[i]));
+        }
+        printf("\n");
+    }
+}
+
+void tuning_print_error_report(void) {
+    static const char *labels[] = {"float math", "32-bit", "64-bit"};
+    double worst_cents[3] = {0.0, 0.0, 0.0};
+    double worst_at[3] = {0.0, 0.0, 0.0};
+    double worst_drift[3] = {0.0, 0.0, 0.0};
+    float rate = timebase_get_sample_rate();
+    int steps = (int)(log2((double)MAX_FREQUENCY / MIN_FREQUENCY) * TUNING_CHECK_STEPS_PER_OCTAVE);
+
+    for (int i = 0; i <= steps; i++) {
+        double frequency = MIN_FREQUENCY * pow(2.0, (double)i / TUNING_CHECK_STEPS_PER_OCTAVE);
+        double ideal = frequency / rate * TUNING_TWO_POW_32;
+        uint64_t exact = tuning_exact_increment(frequency);
+        double produced[3] = {
+            (uint32_t)(((float)frequency * 4294967296.0f) / rate),
+            (double)(exact >> 32),
+            exact / TUNING_TWO_POW_32
+        };
+
+        for (int p = 0; p < 3; p++) {
+            // Errors are far below a cent, so use the first-order form of log2
+            double error = produced[p] - ideal;
+            double cents = fabs(error / ideal) * 1200.0 / M_LN2;
+            double drift = fabs(error) / TUNING_TWO_POW_32 * rate * 3600.0;
+            if (cents > worst_cents[p]) {
+                worst_cents[p] = cents;
+                worst_at[p] = frequency;
+            }
+            if (drift > worst_drift[p]) {
+                worst_drift[p] = drift;
+            }
+        }
+    }
+
+    printf("Pitch error, %d-%d Hz at %.2f Hz (%d frequencies):\n",
+           MIN_FREQUENCY, MAX_FREQUENCY, rate, steps + 1);
+    printf("  Increment  | Worst cents | at Hz    | Worst drift (cycles/hour)\n");
+    for (int p = 0; p < 3; p++) {
+        printf("  %-10s | %11.2e | %8.2f | %.2e\n", labels[p], worst_cents[p], worst_at[p],
+               worst_drift[p]);
+    }
+    printf("  Oscillator: %s\n", high_precision ? "64-bit phase" : "32-bit phase");
+}
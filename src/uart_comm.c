@@ -6,6 +6,31 @@
  */
 
 #include "uart_comm.h"
+#include "waveform_generator.h"
+#include "modulation.h"
+#include "oversampling.h"
+#include "spectrum_analyzer.h"
+#include "timebase.h"
+#include "karplus_strong.h"
+#include "additive.h"
+#include "granular.h"
+#include "drums.h"
+#include "ui_controls.h"
+#include "capture.h"
+#include "latency.h"
+#include "adsr_envelope.h"
+#include "sequencer.h"
+#include "tuning.h"
+#include "power.h"
+#include "audio_input.h"
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+#define UART_COMMAND_MAX_LENGTH 64
+
+// Arrival time of the first character of the command being handled
+static uint32_t command_start_time = 0;
 
 void uart_comm_init(void) {
     // UART is initialized via stdio_init_all() in main
@@ -20,6 +45,12 @@ void uart_print_startup_info(void) {
     printf("\n");
     printf("Features:\n");
     printf("- Multiple waveforms: Square, Triangle, Sawtooth, Sine\n");
+    printf("- Morph oscillator blending the four shapes\n");
+    printf("- Karplus-Strong plucked string voice\n");
+    printf("- Additive synthesis with up to %d harmonics\n", ADDITIVE_MAX_PARTIALS);
+    printf("- Granular voice with up to %d grains\n", GRANULAR_MAX_GRAINS);
+    printf("- Audio input: envelope follower, ring and amplitude modulation\n");
+    printf("- Step sequencer and arpeggiator\n");
     printf("- Frequency range: 20Hz - 20kHz\n");
     printf("- Variable duty cycle for square wave\n");
     printf("- ADSR envelope control\n");
@@ -38,6 +69,8 @@ void uart_print_startup_info(void) {
     printf("- GPIO27: ADSR Release potentiometer (mux B)\n");
     printf("- GPIO0: PWM audio output\n");
     printf("\n");
+    printf("Type 'help' for serial commands\n");
+    printf("\n");
     printf("System ready!\n");
     printf("=====================================\n");
     printf("\n");
@@ -49,6 +82,10 @@ const char* uart_get_waveform_name(waveform_type_t waveform) {
         case WAVEFORM_TRIANGLE: return "Triangle";
         case WAVEFORM_SAWTOOTH: return "Sawtooth";
         case WAVEFORM_SINE:     return "Sine";
+        case WAVEFORM_PLUCK:    return "Pluck";
+        case WAVEFORM_ADDITIVE: return "Additive";
+        case WAVEFORM_MORPH:    return "Morph";
+        case WAVEFORM_GRANULAR: return "Granular";
         default:                return "Unknown";
     }
 }
@@ -69,6 +106,7 @@ void uart_print_status(sound_system_t *system) {
     printf("Waveform: %s\n", uart_get_waveform_name(system->current_waveform));
     printf("Frequency: %.1f Hz\n", system->frequency);
     printf("Duty Cycle: %.1f%%\n", system->duty_cycle * 100.0f);
+    printf("Morph: %.2f (0 square, 1 triangle, 2 sawtooth, 3 sine)\n", system->morph_position);
     printf("Output: %s\n", system->output_enabled ? "ON" : "OFF");
     printf("\nADSR Parameters:\n");
     printf("  Attack: %.3f s\n", system->attack_time);
@@ -78,12 +116,36 @@ void uart_print_status(sound_system_t *system) {
     printf("ADSR State: %s\n", uart_get_adsr_state_name(system->adsr_state));
     printf("Envelope Level: %.1f%%\n", system->envelope_level * 100.0f);
     printf("Phase: 0x%08X\n", system->phase_accumulator);
+    printf("Oversampling: %dx\n", oversampling_get_factor());
+    timebase_print_status();
+    waveform_print_isr_stats();
+    if (system->filter_cutoff < MAX_FREQUENCY) {
+        printf("Filter Cutoff: %.1f Hz\n", system->filter_cutoff);
+    } else {
+        printf("Filter Cutoff: Off\n");
+    }
+    tuning_print_status();
+    ks_print_status();
+    additive_print_status(system);
+    granular_print_status();
+    drums_print_status();
+    capture_print_status();
+    sequencer_print_status();
+    power_print_status();
+    audio_input_print_status();
+    modulation_print_status();
+    spectrum_print_status(system);
     printf("--------------------\n\n");
 }
 
 void uart_periodic_update(sound_system_t *system) {
     static bool first_update = true;
     
+    // Console text is muted during a WAV transfer; skip the formatting
+    if (capture_is_transferring()) {
+        return;
+    }
+    
     if (first_update) {
         printf("Starting periodic status updates...\n");
         first_update = false;
@@ -93,7 +155,707 @@ void uart_periodic_update(sound_system_t *system) {
     printf("Waveform: %s, ", uart_get_waveform_name(system->current_waveform));
     printf("Freq: %.1fHz, ", system->frequency);
     printf("Output: %s, ", system->output_enabled ? "ON" : "OFF");
-    printf("ADSR: %s (%.1f%%)\n", 
+    printf("ADSR: %s (%.1f%%)", 
            uart_get_adsr_state_name(system->adsr_state),
            system->envelope_level * 100.0f);
-}
\ No newline at end of file
+    
+    spectrum_result_t spectrum;
+    if (system->output_enabled && spectrum_get_result(&spectrum)) {
+        printf(", Peak: %.1fHz, THD: %.1f%%", spectrum.peak_frequency, spectrum.thd_percent);
+    }
+    printf("\n");
+}
+
+void uart_print_help(void) {
+    printf("\nSerial commands:\n");
+    printf("  help                                   Show this list\n");
+    printf("  status                                 Print system status\n");
+    printf("  lfo <1-3> <shape> <rate_hz>            Shapes: sine triangle saw square random\n");
+    printf("  route <0-7> <1-3> <dest> <depth_%%> [audio]\n");
+    printf("                                         LFO to pitch/duty/amp/cutoff/morph, control rate by default\n");
+    printf("  route <0-7> off                        Clear a route\n");
+    printf("  cutoff <hz>                            Low-pass cutoff (0 = off)\n");
+    printf("  spectrum                               Print output analysis and self-test\n");
+    printf("  rate <22050|44100|48000|96000>         Audio sample rate\n");
+    printf("  clock <mhz>                            System clock (overclock up to %d MHz)\n",
+           TIMEBASE_MAX_SYS_CLOCK_KHZ / 1000);
+    printf("  pitch                                  Measure sample rate and pitch error\n");
+    printf("  isr [reset]                            Sample interrupt latency/duration\n");
+    printf("  oversample <1|2|4>                     Internal oscillator oversampling\n");
+    printf("  note <on|off>                          Start/release a note (like the output button)\n");
+    printf("  power [on|off|reset]                   Deep idle when silent, residency and wake-up latency\n");
+    printf("  latency [reset]                        Input-to-sound latency percentiles\n");
+    printf("  input [on|off]                         Sample ADC%d at audio rate (its pot is held)\n",
+           AUDIO_INPUT_ADC_CHANNEL);
+    printf("  input follow <off|level|trigger> [threshold_%%]\n");
+    printf("                                         Envelope follower scales the voice or gates the ADSR\n");
+    printf("  input env <attack_ms> <release_ms>     Envelope follower times\n");
+    printf("  input mod <off|ring|am> [depth_%%]      Modulate the voice by the input\n");
+    printf("  input gain <1-%d>                      Input gain\n", AUDIO_INPUT_MAX_GAIN);
+    printf("  tuning [off|12tet|just|scala]          Quantize pitch to a scale (off = continuous pot)\n");
+    printf("  tuning root <hz>                       Frequency of scale degree 0\n");
+    printf("  tuning phase <32|64>                   Oscillator phase accumulator width\n");
+    printf("  tuning check                           Worst pitch error per increment precision\n");
+    printf("  scale [+] <cents|ratio>...             Load (or append) Scala degrees, last = period\n");
+    printf("  morph                                  Morph voice (duty pot: square-triangle-saw-sine)\n");
+    printf("  pluck                                  Pluck a string at the current frequency\n");
+    printf("  string <decay_s> <brightness_%%>        String damping for the next plucks\n");
+    printf("  additive <preset>                      Additive voice: saw square triangle organ\n");
+    printf("  partials <1-%d>                        Number of harmonics summed\n", ADDITIVE_MAX_PARTIALS);
+    printf("  partial <n> <level_%%>                  Level of harmonic n (-100 to 100)\n");
+    printf("  granular [capture|flash]               Granular voice (duty pot: position), load a source\n");
+    printf("  granular pos <0-100>                   Where in the source grains start\n");
+    printf("  grains <per_s> <size_ms> [spray_%%] [jitter_%%]\n");
+    printf("                                         Grain density, length, start and timing spread\n");
+    printf("  drum <kick|snare|hat> [velocity_%%]     Hit a drum voice (no voice: settings)\n");
+    printf("  drum set <voice> <tune_hz> <decay_ms> [level_%%]\n");
+    printf("                                         Kick end pitch, snare tone or hat cutoff\n");
+    printf("  drum pad <voice>                       Voice played by the drum pad button\n");
+    printf("  capture [on|off]                       Keep the last %u output samples in RAM\n",
+           (unsigned)CAPTURE_BUFFER_SIZE);
+    printf("  capture dump                           Send the capture ring as a WAV\n");
+    printf("  capture stream [seconds]               Stream live output as a WAV (0/none = until stop)\n");
+    printf("  capture stop                           End a dump or stream\n");
+    printf("  seq [start|stop|clear]                 Step sequencer status / transport\n");
+    printf("  seq tempo <bpm>                        Tempo %d-%d BPM (4 steps per beat)\n",
+           SEQ_MIN_TEMPO, SEQ_MAX_TEMPO);
+    printf("  seq length <1-%d>                      Pattern length\n", SEQ_MAX_STEPS);
+    printf("  seq step <n> <semitones|rest> [gate_%%] [waveform]\n");
+    printf("                                         Edit step n (notes relative to the frequency pot)\n");
+    printf("  seq drum <n> <kick|snare|hat|off>...   Drum voices hit on step n\n");
+    printf("  arp <off|up|down|updown|random> [octaves]\n");
+    printf("                                         Arpeggiate the held notes instead of the pattern\n");
+    printf("  arp notes <semitones...>               Notes held by the arpeggiator (up to %d)\n",
+           SEQ_ARP_MAX_NOTES);
+    printf("  bench mod                              Time modulation cost per route count\n");
+    printf("  bench os                               Time oversampling cost and alias rejection\n");
+    printf("  bench ks                               Time string cost and strings per sample\n");
+    printf("  bench add                              Time additive cost and partials per sample\n");
+    printf("  bench drums                            Time drum cost per sample and per hit\n");
+    printf("  bench grains                           Time grain cost and concurrent grains per sample\n");
+    printf("  bench input                            Time the audio input path per sample\n");
+    printf("\n");
+}
+
+static int uart_parse_shape(const char *name) {
+    for (int i = 0; i < LFO_SHAPE_COUNT; i++) {
+        if (strcmp(name, modulation_get_shape_name(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int uart_parse_destination(const char *name) {
+    for (int i = 0; i < MOD_DEST_COUNT; i++) {
+        if (strcmp(name, modulation_get_destination_name(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Parse a modulation matrix slot number
+ * @return Slot, or -1 if the text is not a number from 0 to MOD_MAX_ROUTES-1
+ */
+static int uart_parse_slot(const char *text) {
+    char *end;
+    long slot = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || slot < 0 || slot >= MOD_MAX_ROUTES) {
+        return -1;
+    }
+    return (int)slot;
+}
+
+static int uart_parse_preset(const char *name) {
+    for (int i = 0; i < ADDITIVE_PRESET_COUNT; i++) {
+        if (strcmp(name, additive_get_preset_name(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void uart_command_partial(char *args) {
+    char *harmonic = strtok(args, " ");
+    char *level = strtok(NULL, " ");
+    
+    if (!harmonic || !level ||
+        !additive_set_partial(atoi(harmonic), strtof(level, NULL) / 100.0f)) {
+        printf("Usage: partial <1-%d> <level_%%> (-100 to 100)\n", ADDITIVE_MAX_PARTIALS);
+        return;
+    }
+    printf("Harmonic %s: %s%%\n", harmonic, level);
+}
+
+static void uart_command_capture(char *args) {
+    char *action = strtok(args, " ");
+    char *seconds = strtok(NULL, " ");
+    
+    if (!action) {
+        capture_print_status();
+    } else if (strcmp(action, "on") == 0 || strcmp(action, "off") == 0) {
+        capture_set_ring(strcmp(action, "on") == 0);
+        capture_print_status();
+    } else if (strcmp(action, "dump") == 0) {
+        if (!capture_start_dump()) {
+            printf("Capture busy or USB not connected\n");
+        }
+    } else if (strcmp(action, "stream") == 0) {
+        if (!capture_start_stream(seconds ? strtof(seconds, NULL) : 0.0f)) {
+            printf("Capture busy or USB not connected\n");
+        }
+    } else if (strcmp(action, "stop") == 0) {
+        capture_stop();
+    } else {
+        printf("Usage: capture [on|off|dump|stream [seconds]|stop]\n");
+    }
+}
+
+static int uart_parse_waveform(const char *name) {
+    for (int i = 0; i < WAVEFORM_COUNT; i++) {
+        if (strcasecmp(name, uart_get_waveform_name(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void uart_command_seq_step(char *args) {
+    char *index = strtok(args, " ");
+    char *note = strtok(NULL, " ");
+    char *gate = strtok(NULL, " ");
+    char *waveform = strtok(NULL, " ");
+    
+    int waveform_id = waveform ? uart_parse_waveform(waveform) : -1;
+    int note_value = (note && strcmp(note, "rest") == 0) ? SEQ_REST : (note ? atoi(note) : 0);
+    if (!index || !note || (waveform && waveform_id < 0) ||
+        !sequencer_set_step(atoi(index) - 1, note_value, gate ? atoi(gate) : 50, waveform_id)) {
+        printf("Usage: seq step <1-%d> <semitones|rest> [gate_%%] [waveform] (+/-%d semitones)\n",
+               SEQ_MAX_STEPS, SEQ_NOTE_RANGE);
+        return;
+    }
+    sequencer_print_status();
+}
+
+static int uart_parse_drum(const char *name) {
+    for (int i = 0; i < DRUM_VOICE_COUNT; i++) {
+        if (strcmp(name, drums_get_voice_name(i)) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void uart_command_seq_drum(char *args) {
+    char *index = strtok(args, " ");
+    uint8_t drums = 0;
+    bool valid = index != NULL;
+    char *voice;
+    while ((voice = strtok(NULL, " ")) != NULL) {
+        int voice_id = uart_parse_drum(voice);
+        if (voice_id >= 0) {
+            drums |= 1u << voice_id;
+        } else if (strcmp(voice, "off") != 0) {
+            valid = false;
+        }
+    }
+    
+    if (!valid || !sequencer_set_drums(atoi(index) - 1, drums)) {
+        printf("Usage: seq drum <1-%d> <kick|snare|hat|off>...\n", SEQ_MAX_STEPS);
+        return;
+    }
+    sequencer_print_status();
+}
+
+static void uart_command_tuning(char *args) {
+    char *action = strtok(args, " ");
+    char *value = strtok(NULL, " ");
+    
+    int mode = -1;
+    for (int i = 0; action && i < TUNING_MODE_COUNT; i++) {
+        if (strcmp(action, tuning_get_mode_name(i)) == 0) {
+            mode = i;
+        }
+    }
+    
+    if (!action) {
+        tuning_print_status();
+    } else if (mode >= 0) {
+        if (!tuning_set_mode(mode)) {
+            printf("Load a scale first (scale <cents|ratio>...)\n");
+            return;
+        }
+        tuning_print_status();
+    } else if (strcmp(action, "root") == 0 && value) {
+        if (!tuning_set_root(strtof(value, NULL))) {
+            printf("Root must be %d-%d Hz\n", MIN_FREQUENCY, MAX_FREQUENCY);
+            return;
+        }
+        tuning_print_status();
+    } else if (strcmp(action, "phase") == 0 && value &&
+               (strcmp(value, "32") == 0 || strcmp(value, "64") == 0)) {
+        tuning_set_high_precision(strcmp(value, "64") == 0);
+        tuning_print_status();
+    } else if (strcmp(action, "check") == 0) {
+        tuning_print_error_report();
+    } else {
+        printf("Usage: tuning [off|12tet|just|scala|root <hz>|phase <32|64>|check]\n");
+    }
+}
+
+static void uart_command_scale(char *args) {
+    float cents[TUNING_MAX_DEGREES];
+    uint8_t count = 0;
+    bool append = false;
+    bool valid = true;
+    char *pitch = strtok(args, " ");
+    
+    if (!pitch) {
+        tuning_print_status();
+        return;
+    }
+    if (strcmp(pitch, "+") == 0) {
+        append = true;
+        pitch = strtok(NULL, " ");
+    }
+    for (; pitch && valid; pitch = strtok(NULL, " ")) {
+        valid = count < TUNING_MAX_DEGREES && tuning_parse_pitch(pitch, &cents[count++]);
+    }
+    
+    if (!valid || !tuning_load_degrees(cents, count, append)) {
+        printf("Usage: scale [+] <cents|ratio>... (ascending, up to %d degrees, last = period)\n",
+               TUNING_MAX_DEGREES);
+        printf("       %d-%d Hz must fit in %d table notes (fewer degrees or a longer period)\n",
+               MIN_FREQUENCY, MAX_FREQUENCY, TUNING_MAX_NOTES);
+        return;
+    }
+    tuning_print_status();
+}
+
+static void uart_command_drum(char *args) {
+    char *action = strtok(args, " ");
+    
+    if (!action) {
+        drums_print_status();
+    } else if (strcmp(action, "set") == 0) {
+        char *voice = strtok(NULL, " ");
+        char *tune = strtok(NULL, " ");
+        char *decay = strtok(NULL, " ");
+        char *level = strtok(NULL, " ");
+        int voice_id = voice ? uart_parse_drum(voice) : -1;
+        if (voice_id < 0 || !tune || !decay ||
+            !drums_set_voice(voice_id, strtof(tune, NULL), strtof(decay, NULL),
+                             level ? strtof(level, NULL) / 100.0f : 1.0f)) {
+            printf("Usage: drum set <kick|snare|hat> <%d-%d Hz> <%.0f-%.0f ms> [level_%%]\n",
+                   MIN_FREQUENCY, MAX_FREQUENCY, DRUM_MIN_DECAY_MS, DRUM_MAX_DECAY_MS);
+            return;
+        }
+        drums_print_status();
+    } else if (strcmp(action, "pad") == 0) {
+        char *voice = strtok(NULL, " ");
+        int voice_id = voice ? uart_parse_drum(voice) : -1;
+        if (voice_id < 0) {
+            printf("Usage: drum pad <kick|snare|hat>\n");
+            return;
+        }
+        ui_set_drum_pad(voice_id);
+        printf("Drum pad: %s\n", voice);
+    } else {
+        char *velocity = strtok(NULL, " ");
+        int voice_id = uart_parse_drum(action);
+        float amount = velocity ? strtof(velocity, NULL) / 100.0f : 1.0f;
+        if (voice_id < 0 || amount < 0.0f || amount > 1.0f) {
+            printf("Usage: drum [kick|snare|hat [velocity_%%]|set ...|pad <voice>]\n");
+            return;
+        }
+        drums_trigger(voice_id, (int32_t)(amount * 32768.0f));
+    }
+}
+
+static void uart_command_granular(sound_system_t *system, char *args) {
+    char *action = strtok(args, " ");
+    char *value = strtok(NULL, " ");
+    
+    if (!action) {
+        waveform_select(system, WAVEFORM_GRANULAR);
+    } else if (strcmp(action, "capture") == 0) {
+        if (!granular_load_source(GRANULAR_SOURCE_CAPTURE)) {
+            printf("Nothing captured yet (capture on, play, then granular capture)\n");
+            return;
+        }
+        waveform_select(system, WAVEFORM_GRANULAR);
+    } else if (strcmp(action, "flash") == 0) {
+        if (!granular_load_source(GRANULAR_SOURCE_FLASH)) {
+            printf("No sample image at flash offset 0x%X\n", GRANULAR_FLASH_OFFSET);
+            return;
+        }
+        waveform_select(system, WAVEFORM_GRANULAR);
+    } else if (strcmp(action, "pos") == 0 && value) {
+        granular_set_position(strtof(value, NULL) / 100.0f);
+    } else {
+        printf("Usage: granular [capture|flash|pos <0-100>]\n");
+        return;
+    }
+    granular_print_status();
+}
+
+static void uart_command_grains(char *args) {
+    char *density = strtok(args, " ");
+    char *size = strtok(NULL, " ");
+    char *spray = strtok(NULL, " ");
+    char *jitter = strtok(NULL, " ");
+    
+    if (!density) {
+        granular_print_status();
+        return;
+    }
+    if (!size || !granular_set_scheduler(strtof(density, NULL), strtof(size, NULL),
+                                         spray ? strtof(spray, NULL) / 100.0f : 0.1f,
+                                         jitter ? strtof(jitter, NULL) / 100.0f : 0.5f)) {
+        printf("Usage: grains <%.0f-%.0f per s> <%.0f-%.0f ms> [spray_%%] [jitter_%%]\n",
+               GRANULAR_MIN_DENSITY, GRANULAR_MAX_DENSITY, GRANULAR_MIN_SIZE_MS, GRANULAR_MAX_SIZE_MS);
+        return;
+    }
+    granular_print_status();
+}
+
+static void uart_command_input(char *args) {
+    char *action = strtok(args, " ");
+    char *first = strtok(NULL, " ");
+    char *second = strtok(NULL, " ");
+    bool valid = true;
+    
+    if (!action) {
+        // Status only
+    } else if (strcmp(action, "on") == 0 || strcmp(action, "off") == 0) {
+        audio_input_set_enabled(strcmp(action, "on") == 0);
+    } else if (strcmp(action, "follow") == 0 && first) {
+        int mode = -1;
+        for (int i = 0; i < AUDIO_INPUT_FOLLOW_COUNT; i++) {
+            if (strcmp(first, audio_input_get_follow_name(i)) == 0) {
+                mode = i;
+            }
+        }
+        valid = mode >= 0 && audio_input_set_follow(mode, second ? strtof(second, NULL) / 100.0f : 0.1f);
+    } else if (strcmp(action, "env") == 0 && first && second) {
+        valid = audio_input_set_envelope(strtof(first, NULL), strtof(second, NULL));
+    } else if (strcmp(action, "mod") == 0 && first) {
+        int mod = -1;
+        for (int i = 0; i < AUDIO_INPUT_MOD_COUNT; i++) {
+            if (strcmp(first, audio_input_get_mod_name(i)) == 0) {
+                mod = i;
+            }
+        }
+        valid = mod >= 0 && audio_input_set_mod(mod, second ? strtof(second, NULL) / 100.0f : 1.0f);
+    } else if (strcmp(action, "gain") == 0 && first) {
+        valid = audio_input_set_gain(atoi(first));
+    } else {
+        valid = false;
+    }
+    
+    if (!valid) {
+        printf("Usage: input [on|off], input follow <off|level|trigger> [threshold_%%],\n");
+        printf("       input env <%.1f-%.0f ms> <%.1f-%.0f ms>, input mod <off|ring|am> [depth_%%],\n",
+               AUDIO_INPUT_MIN_ENV_MS, AUDIO_INPUT_MAX_ENV_MS, AUDIO_INPUT_MIN_ENV_MS, AUDIO_INPUT_MAX_ENV_MS);
+        printf("       input gain <1-%d>\n", AUDIO_INPUT_MAX_GAIN);
+        return;
+    }
+    audio_input_print_status();
+}
+
+static void uart_command_seq(sound_system_t *system, char *args) {
+    char *action = strtok(args, " ");
+    char *value = strtok(NULL, "");
+    
+    if (!action) {
+        sequencer_print_status();
+    } else if (strcmp(action, "start") == 0) {
+        sequencer_start(system);
+    } else if (strcmp(action, "stop") == 0) {
+        sequencer_stop(system);
+    } else if (strcmp(action, "clear") == 0) {
+        sequencer_clear();
+        printf("Pattern cleared\n");
+    } else if (strcmp(action, "tempo") == 0 && value) {
+        if (!sequencer_set_tempo(strtof(value, NULL))) {
+            printf("Tempo must be %d-%d BPM\n", SEQ_MIN_TEMPO, SEQ_MAX_TEMPO);
+        } else {
+            sequencer_print_status();
+        }
+    } else if (strcmp(action, "length") == 0 && value) {
+        if (!sequencer_set_length(atoi(value))) {
+            printf("Length must be 1-%d\n", SEQ_MAX_STEPS);
+        } else {
+            sequencer_print_status();
+        }
+    } else if (strcmp(action, "step") == 0 && value) {
+        uart_command_seq_step(value);
+    } else if (strcmp(action, "drum") == 0 && value) {
+        uart_command_seq_drum(value);
+    } else {
+        printf("Usage: seq [start|stop|clear|tempo <bpm>|length <n>|step ...|drum ...]\n");
+    }
+}
+
+static void uart_command_arp(char *args) {
+    char *action = strtok(args, " ");
+    
+    if (action && strcmp(action, "notes") == 0) {
+        int8_t notes[SEQ_ARP_MAX_NOTES];
+        uint8_t count = 0;
+        char *note;
+        bool valid = true;
+        while ((note = strtok(NULL, " ")) != NULL) {
+            if (count == SEQ_ARP_MAX_NOTES) {
+                valid = false;
+                break;
+            }
+            int value = atoi(note);
+            valid = valid && value >= -SEQ_NOTE_RANGE && value <= SEQ_NOTE_RANGE;
+            notes[count++] = (int8_t)value;
+        }
+        if (!valid || !sequencer_set_arp_notes(notes, count)) {
+            printf("Usage: arp notes <semitones...> (1-%d notes, +/-%d)\n",
+                   SEQ_ARP_MAX_NOTES, SEQ_NOTE_RANGE);
+            return;
+        }
+        sequencer_print_status();
+        return;
+    }
+    
+    int mode = -1;
+    for (int i = 0; action && i < ARP_MODE_COUNT; i++) {
+        if (strcmp(action, sequencer_get_arp_mode_name(i)) == 0) {
+            mode = i;
+        }
+    }
+    char *octaves = strtok(NULL, " ");
+    if (mode < 0 || !sequencer_set_arp(mode, octaves ? atoi(octaves) : 1)) {
+        printf("Usage: arp <off|up|down|updown|random> [1-%d octaves] or arp notes <semitones...>\n",
+               SEQ_ARP_MAX_OCTAVES);
+        return;
+    }
+    sequencer_print_status();
+}
+
+static void uart_command_lfo(char *args) {
+    char *index = strtok(args, " ");
+    char *shape = strtok(NULL, " ");
+    char *rate = strtok(NULL, " ");
+    
+    if (!index || !shape || !rate) {
+        printf("Usage: lfo <1-3> <shape> <rate_hz>\n");
+        return;
+    }
+    
+    int shape_id = uart_parse_shape(shape);
+    if (shape_id < 0 || !modulation_set_lfo(atoi(index) - 1, shape_id, strtof(rate, NULL))) {
+        printf("Invalid LFO settings\n");
+        return;
+    }
+    printf("LFO%s: %s %s Hz\n", index, shape, rate);
+}
+
+static void uart_command_route(char *args) {
+    char *slot = strtok(args, " ");
+    char *source = strtok(NULL, " ");
+    char *destination = strtok(NULL, " ");
+    char *depth = strtok(NULL, " ");
+    char *rate = strtok(NULL, " ");
+    
+    int slot_id = slot ? uart_parse_slot(slot) : -1;
+    if (slot_id >= 0 && source && strcmp(source, "off") == 0 && !destination) {
+        if (modulation_clear_route(slot_id)) {
+            printf("Route %d cleared\n", slot_id);
+            return;
+        }
+    }
+    
+    if (slot_id < 0 || !source || !destination || !depth) {
+        printf("Usage: route <0-%d> <1-3> <dest> <depth_%%> [audio]\n", MOD_MAX_ROUTES - 1);
+        printf("       route <0-%d> off\n", MOD_MAX_ROUTES - 1);
+        return;
+    }
+    
+    int destination_id = uart_parse_destination(destination);
+    mod_rate_t rate_id = (rate && strcmp(rate, "audio") == 0) ? MOD_RATE_AUDIO : MOD_RATE_CONTROL;
+    if (destination_id < 0 ||
+        !modulation_set_route(slot_id, atoi(source) - 1, destination_id,
+                              strtof(depth, NULL) / 100.0f, rate_id)) {
+        printf("Invalid route settings\n");
+        return;
+    }
+    printf("Route %s: LFO%s -> %s %s%% (%s rate)\n", slot, source, destination, depth,
+           rate_id == MOD_RATE_AUDIO ? "audio" : "control");
+}
+
+void uart_handle_command(sound_system_t *system, char *line) {
+    char *command = strtok(line, " ");
+    char *args = strtok(NULL, "");
+    char no_args[] = "";
+    
+    if (!command) {
+        return;
+    }
+    if (!args) {
+        args = no_args;
+    }
+    
+    // Replies are muted while a WAV transfer owns the link, so only accept
+    // the command that ends it
+    if (capture_is_transferring() &&
+        (strcmp(command, "capture") != 0 || strncmp(args, "stop", 4) != 0)) {
+        return;
+    }
+    
+    if (strcmp(command, "help") == 0) {
+        uart_print_help();
+    } else if (strcmp(command, "status") == 0) {
+        uart_print_status(system);
+    } else if (strcmp(command, "lfo") == 0) {
+        uart_command_lfo(args);
+    } else if (strcmp(command, "route") == 0) {
+        uart_command_route(args);
+    } else if (strcmp(command, "cutoff") == 0 && *args) {
+        float cutoff = strtof(args, NULL);
+        system->filter_cutoff = (cutoff <= 0.0f) ? MAX_FREQUENCY : cutoff;
+        printf("Filter cutoff: %.1f Hz\n", system->filter_cutoff);
+    } else if (strcmp(command, "spectrum") == 0) {
+        spectrum_print_status(system);
+    } else if (strcmp(command, "rate") == 0 && *args) {
+        if (!timebase_set_sample_rate(system, strtoul(args, NULL, 10))) {
+            printf("Supported rates: 22050, 44100, 48000, 96000\n");
+        }
+    } else if (strcmp(command, "clock") == 0 && *args) {
+        if (!timebase_set_system_clock(system, (uint32_t)(strtof(args, NULL) * 1000.0f))) {
+            printf("Clock must be %d-%d MHz and reachable by the PLL\n",
+                   TIMEBASE_MIN_SYS_CLOCK_KHZ / 1000, TIMEBASE_MAX_SYS_CLOCK_KHZ / 1000);
+        }
+    } else if (strcmp(command, "pitch") == 0) {
+        timebase_measure_pitch(system);
+    } else if (strcmp(command, "isr") == 0) {
+        if (strcmp(args, "reset") == 0) {
+            waveform_reset_isr_stats();
+            printf("Sample ISR statistics reset\n");
+        } else {
+            waveform_print_isr_stats();
+        }
+    } else if (strcmp(command, "oversample") == 0 && *args) {
+        if (oversampling_set_factor(atoi(args))) {
+            printf("Oversampling: %dx\n", oversampling_get_factor());
+        } else {
+            printf("Oversampling factor must be 1, 2 or 4\n");
+        }
+    } else if (strcmp(command, "note") == 0 && strcmp(args, "on") == 0) {
+        latency_arm(LATENCY_SRC_SERIAL, command_start_time);
+        system->output_enabled = true;
+        adsr_note_on(system);
+    } else if (strcmp(command, "note") == 0 && strcmp(args, "off") == 0) {
+        system->output_enabled = false;
+        adsr_note_off(system);
+    } else if (strcmp(command, "morph") == 0) {
+        waveform_select(system, WAVEFORM_MORPH);
+        printf("Waveform: Morph at %.2f\n", system->morph_position);
+    } else if (strcmp(command, "pluck") == 0) {
+        waveform_select(system, WAVEFORM_PLUCK);
+        latency_arm(LATENCY_SRC_SERIAL, command_start_time);
+        system->output_enabled = true;
+        adsr_note_on(system);
+    } else if (strcmp(command, "string") == 0) {
+        char *decay = strtok(args, " ");
+        char *bright = strtok(NULL, " ");
+        if (!decay || !bright || !ks_set_damping(strtof(decay, NULL), strtof(bright, NULL) / 100.0f)) {
+            printf("Usage: string <decay_s> <brightness_%%> (brightness 0-100)\n");
+        } else {
+            ks_print_status();
+        }
+    } else if (strcmp(command, "additive") == 0) {
+        int preset = *args ? uart_parse_preset(args) : ADDITIVE_PRESET_SAWTOOTH;
+        if (preset < 0) {
+            printf("Presets: saw square triangle organ\n");
+        } else {
+            additive_load_preset(preset);
+            waveform_select(system, WAVEFORM_ADDITIVE);
+            additive_print_status(system);
+        }
+    } else if (strcmp(command, "partials") == 0 && *args) {
+        if (!additive_set_partial_count(atoi(args))) {
+            printf("Partial count must be 1-%d\n", ADDITIVE_MAX_PARTIALS);
+        } else {
+            additive_print_status(system);
+        }
+    } else if (strcmp(command, "partial") == 0) {
+        uart_command_partial(args);
+    } else if (strcmp(command, "granular") == 0) {
+        uart_command_granular(system, args);
+    } else if (strcmp(command, "grains") == 0) {
+        uart_command_grains(args);
+    } else if (strcmp(command, "latency") == 0) {
+        if (strcmp(args, "reset") == 0) {
+            latency_reset();
+            printf("Latency trials cleared\n");
+        } else {
+            latency_print_report();
+        }
+    } else if (strcmp(command, "power") == 0) {
+        if (strcmp(args, "on") == 0 || strcmp(args, "off") == 0) {
+            power_set_enabled(strcmp(args, "on") == 0);
+        } else if (strcmp(args, "reset") == 0) {
+            power_reset_stats();
+        }
+        power_print_status();
+    } else if (strcmp(command, "input") == 0) {
+        uart_command_input(args);
+    } else if (strcmp(command, "tuning") == 0) {
+        uart_command_tuning(args);
+    } else if (strcmp(command, "scale") == 0) {
+        uart_command_scale(args);
+    } else if (strcmp(command, "drum") == 0) {
+        uart_command_drum(args);
+    } else if (strcmp(command, "capture") == 0) {
+        uart_command_capture(args);
+    } else if (strcmp(command, "seq") == 0) {
+        uart_command_seq(system, args);
+    } else if (strcmp(command, "arp") == 0) {
+        uart_command_arp(args);
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "mod") == 0) {
+        modulation_benchmark(system);
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "os") == 0) {
+        oversampling_benchmark(system);
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "ks") == 0) {
+        ks_benchmark();
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "add") == 0) {
+        additive_benchmark();
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "drums") == 0) {
+        drums_benchmark(system);
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "grains") == 0) {
+        granular_benchmark();
+    } else if (strcmp(command, "bench") == 0 && strcmp(args, "input") == 0) {
+        audio_input_benchmark();
+    } else {
+        printf("Unknown command: %s (type 'help')\n", command);
+    }
+}
+
+void uart_poll_commands(sound_system_t *system) {
+    static char line[UART_COMMAND_MAX_LENGTH];
+    static uint8_t length = 0;
+    
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT) {
+        if (c == '\r' || c == '\n') {
+            if (length > 0) {
+                line[length] = '\0';
+                uart_handle_command(system, line);
+                length = 0;
+            }
+        } else if (length < UART_COMMAND_MAX_LENGTH - 1) {
+            if (length == 0) {
+                command_start_time = time_us_32();
+            }
+            line[length++] = (char)c;
+        }
+    }
+}
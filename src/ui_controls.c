@@ -7,9 +7,17 @@
 
 #include "ui_controls.h"
 #include "adsr_envelope.h"
+#include "waveform_generator.h"
+#include "latency.h"
+#include "sequencer.h"
+#include "tuning.h"
+#include "granular.h"
+#include "audio_input.h"
 
 #define DEBOUNCE_TIME_US 50000  // 50ms debounce time
 
+static drum_voice_t drum_pad_voice = DRUM_KICK;
+
 void ui_controls_init(void) {
     // Initialize button pins as inputs with pull-up resistors
     gpio_init(WAVEFORM_BUTTON_PIN);
@@ -20,6 +28,10 @@ void ui_controls_init(void) {
     gpio_set_dir(OUTPUT_TOGGLE_PIN, GPIO_IN);
     gpio_pull_up(OUTPUT_TOGGLE_PIN);
     
+    gpio_init(DRUM_BUTTON_PIN);
+    gpio_set_dir(DRUM_BUTTON_PIN, GPIO_IN);
+    gpio_pull_up(DRUM_BUTTON_PIN);
+    
     // Initialize LED pins as outputs
     gpio_init(LED_SQUARE_PIN);
     gpio_set_dir(LED_SQUARE_PIN, GPIO_OUT);
@@ -52,6 +64,7 @@ void ui_update_buttons(sound_system_t *system) {
     // Read button states (active low due to pull-up)
     bool waveform_pressed = !gpio_get(WAVEFORM_BUTTON_PIN);
     bool output_pressed = !gpio_get(OUTPUT_TOGGLE_PIN);
+    bool drum_pressed = !gpio_get(DRUM_BUTTON_PIN);
     
     // Handle waveform button with debouncing
     if (waveform_pressed && !system->waveform_button_pressed) {
@@ -70,6 +83,15 @@ void ui_update_buttons(sound_system_t *system) {
         }
     }
     system->output_button_pressed = output_pressed;
+    
+    // Handle drum pad button with debouncing
+    if (drum_pressed && !system->drum_button_pressed) {
+        if ((current_time - system->last_drum_press) > DEBOUNCE_TIME_US) {
+            ui_handle_drum_button(system);
+            system->last_drum_press = current_time;
+        }
+    }
+    system->drum_button_pressed = drum_pressed;
 }
 
 void ui_read_potentiometers(sound_system_t *system) {
@@ -87,14 +109,32 @@ void ui_read_potentiometers(sound_system_t *system) {
     sleep_us(10); // Allow mux to settle
     
     // Read frequency potentiometer
-    adc_select_input(0); // FREQUENCY_POT_PIN is ADC0 (GPIO26)
-    uint16_t freq_adc = adc_read();
-    system->frequency = ui_adc_to_frequency(freq_adc);
+    uint16_t freq_adc = audio_input_read_adc(0); // FREQUENCY_POT_PIN is ADC0 (GPIO26)
+    float frequency = ui_adc_to_frequency(freq_adc);
+    
+    // Snap to the tuning's notes, with hysteresis so ADC noise cannot flip between two
+    static int pot_note = -1;
+    pot_note = tuning_nearest(frequency, pot_note);
+    if (pot_note >= 0) {
+        frequency = tuning_note_frequency(pot_note);
+    }
+    
+    if (sequencer_is_running()) {
+        // The sequencer sets the pitch; the pot sets the note it is relative to
+        sequencer_set_root(frequency);
+    } else {
+        system->frequency = frequency;
+    }
     
-    // Read duty cycle potentiometer
-    adc_select_input(1); // DUTY_CYCLE_POT_PIN is ADC1 (GPIO27)
-    uint16_t duty_adc = adc_read();
-    system->duty_cycle = ui_adc_to_duty_cycle(duty_adc);
+    // Read duty cycle potentiometer (sets the morph shape or the grain position)
+    uint16_t duty_adc = audio_input_read_adc(1); // DUTY_CYCLE_POT_PIN is ADC1 (GPIO27)
+    if (system->current_waveform == WAVEFORM_MORPH) {
+        system->morph_position = ui_adc_to_morph(duty_adc);
+    } else if (system->current_waveform == WAVEFORM_GRANULAR) {
+        granular_set_position((float)duty_adc / ADC_MAX_VALUE);
+    } else {
+        system->duty_cycle = ui_adc_to_duty_cycle(duty_adc);
+    }
     
     // Read ADSR parameters (this will handle its own multiplexer switching)
     adsr_read_parameters(system);
@@ -121,12 +161,41 @@ void ui_update_leds(sound_system_t *system) {
         case WAVEFORM_SINE:
             gpio_put(LED_SINE_PIN, true);
             break;
+        case WAVEFORM_PLUCK:
+            // No dedicated LED: light all four
+            gpio_put(LED_SQUARE_PIN, true);
+            gpio_put(LED_TRIANGLE_PIN, true);
+            gpio_put(LED_SAWTOOTH_PIN, true);
+            gpio_put(LED_SINE_PIN, true);
+            break;
+        case WAVEFORM_ADDITIVE:
+            // Blinking sine LED: a sum of sines
+            gpio_put(LED_SINE_PIN, (time_us_32() >> 18) & 1);
+            break;
+        case WAVEFORM_MORPH: {
+            // Light the one or two shapes being blended
+            static const uint led_pins[] = {LED_SQUARE_PIN, LED_TRIANGLE_PIN, LED_SAWTOOTH_PIN, LED_SINE_PIN};
+            int shape = (int)system->morph_position;
+            if (shape > 3) shape = 3;
+            gpio_put(led_pins[shape], true);
+            if (shape < 3 && system->morph_position > shape) {
+                gpio_put(led_pins[shape + 1], true);
+            }
+            break;
+        }
+        case WAVEFORM_GRANULAR:
+            // Flickering LEDs: scattered grains
+            gpio_put(LED_SQUARE_PIN, (time_us_32() >> 16) & 1);
+            gpio_put(LED_SAWTOOTH_PIN, (time_us_32() >> 17) & 1);
+            break;
+        default:
+            break;
     }
 }
 
 void ui_handle_waveform_button(sound_system_t *system) {
-    // Cycle through waveforms
-    system->current_waveform = (system->current_waveform + 1) % WAVEFORM_COUNT;
+    // Cycle through waveforms, crossfading to avoid a click
+    waveform_select(system, (system->current_waveform + 1) % WAVEFORM_COUNT);
     
     printf("Waveform changed to: ");
     switch (system->current_waveform) {
@@ -142,6 +211,20 @@ void ui_handle_waveform_button(sound_system_t *system) {
         case WAVEFORM_SINE:
             printf("Sine Wave\n");
             break;
+        case WAVEFORM_PLUCK:
+            printf("Plucked String\n");
+            break;
+        case WAVEFORM_ADDITIVE:
+            printf("Additive\n");
+            break;
+        case WAVEFORM_MORPH:
+            printf("Morph\n");
+            break;
+        case WAVEFORM_GRANULAR:
+            printf("Granular\n");
+            break;
+        default:
+            break;
     }
     
     // Update LED indicators
@@ -154,14 +237,27 @@ void ui_handle_output_toggle(sound_system_t *system) {
     printf("Audio output: %s\n", system->output_enabled ? "ON" : "OFF");
     
     if (system->output_enabled) {
-        // Start ADSR envelope
+        // Start ADSR envelope (timed from the button edge)
+        latency_arm(LATENCY_SRC_BUTTON, 0);
         adsr_note_on(system);
     } else {
         // Release ADSR envelope
+        latency_discard_edge();
         adsr_note_off(system);
     }
 }
 
+void ui_handle_drum_button(sound_system_t *system) {
+    (void)system;
+    drums_trigger(drum_pad_voice, 32768);
+}
+
+void ui_set_drum_pad(drum_voice_t voice) {
+    if (voice < DRUM_VOICE_COUNT) {
+        drum_pad_voice = voice;
+    }
+}
+
 float ui_adc_to_frequency(uint16_t adc_value) {
     // Convert ADC value to logarithmic frequency scale
     // 5 octaves from 20Hz to 20kHz
@@ -180,6 +276,12 @@ float ui_adc_to_duty_cycle(uint16_t adc_value) {
     return 0.05f + normalized * 0.9f;
 }
 
+float ui_adc_to_morph(uint16_t adc_value) {
+    // Convert ADC value to morph position (square to sine)
+    float normalized = (float)adc_value / ADC_MAX_VALUE;
+    return normalized * MORPH_POSITION_MAX;
+}
+
 float ui_adc_to_time(uint16_t adc_value) {
     // Convert ADC value to time parameter (1ms to 5s)
     float normalized = (float)adc_value / ADC_MAX_VALUE;
@@ -7,9 +7,23 @@
 
 #include "waveform_generator.h"
 #include "adsr_envelope.h"
+#include "modulation.h"
+#include "oversampling.h"
+#include "karplus_strong.h"
+#include "additive.h"
+#include "granular.h"
+#include "audio_input.h"
+#include "drums.h"
+#include "spectrum_analyzer.h"
+#include "capture.h"
+#include "latency.h"
+#include "sequencer.h"
+#include "tuning.h"
+#include "timebase.h"
+#include "hardware/sync.h"
 
 // Sine wave lookup table (256 entries for efficiency)
-static const uint8_t sine_table[256] = {
+static const uint8_t AUDIO_SCRATCH_DATA(sine_table)[256] = {
     128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
     176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
     218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
@@ -30,16 +44,29 @@ static const uint8_t sine_table[256] = {
 
 static uint pwm_slice_num;
 
+// One-pole low-pass filter state (Q15 sample)
+static int32_t filter_state = 0;
+
+// Waveform change crossfade (level and step in Q15). crossfade_to is the
+// voice fading in; a shape selected while a fade runs waits in
+// system->current_waveform until that fade completes.
+#define CROSSFADE_UNITY 32768
+static uint8_t crossfade_from = WAVEFORM_SQUARE;
+static uint8_t crossfade_to = WAVEFORM_SQUARE;
+static int32_t crossfade_level = CROSSFADE_UNITY;
+static int32_t crossfade_step = CROSSFADE_UNITY;
+
+// Sample interrupt timing in PWM counter ticks
+static volatile isr_stats_t isr_stats;
+static volatile bool isr_stats_reset_pending = false;
+
 void waveform_generator_init(void) {
     // Set up PWM on the audio output pin
     gpio_set_function(PWM_OUTPUT_PIN, GPIO_FUNC_PWM);
     pwm_slice_num = pwm_gpio_to_slice_num(PWM_OUTPUT_PIN);
     
-    // Configure PWM
+    // Configure PWM (divider and wrap are set by the timebase below)
     pwm_config config = pwm_get_default_config();
-    pwm_config_set_clkdiv(&config, 1.0f); // No clock division for high frequency
-    pwm_config_set_wrap(&config, PWM_WRAP);
-    
     pwm_init(pwm_slice_num, &config, true);
     
     // Set up PWM interrupt for sample generation
@@ -48,18 +75,16 @@ void waveform_generator_init(void) {
     irq_set_exclusive_handler(PWM_IRQ_WRAP, pwm_interrupt_handler);
     irq_set_enabled(PWM_IRQ_WRAP, true);
     
-    // Set initial PWM frequency for audio sample rate
-    // Clock speed / (wrap + 1) = sample rate
-    // For 44.1kHz: 125MHz / 2834 ≈ 44.1kHz
-    pwm_set_wrap(pwm_slice_num, 2833);
+    // Set PWM frequency for the audio sample rate from the actual clk_sys:
+    // clk_sys / (divider * (wrap + 1)) = sample rate
+    timebase_init();
 }
 
-uint8_t generate_square_wave(uint16_t phase, float duty_cycle) {
-    uint16_t duty_threshold = (uint16_t)(duty_cycle * 65535);
+uint8_t AUDIO_SCRATCH_FUNC(generate_square_wave)(uint16_t phase, uint16_t duty_threshold) {
     return (phase < duty_threshold) ? 255 : 0;
 }
 
-uint8_t generate_triangle_wave(uint16_t phase) {
+uint8_t AUDIO_SCRATCH_FUNC(generate_triangle_wave)(uint16_t phase) {
     if (phase < 32768) {
         // Rising edge: 0 to 255
         return (uint8_t)((phase * 255) / 32767);
@@ -69,25 +94,26 @@ uint8_t generate_triangle_wave(uint16_t phase) {
     }
 }
 
-uint8_t generate_sawtooth_wave(uint16_t phase) {
+uint8_t AUDIO_SCRATCH_FUNC(generate_sawtooth_wave)(uint16_t phase) {
     // Linear ramp from 0 to 255
     return (uint8_t)(phase >> 8);
 }
 
-uint8_t generate_sine_wave(uint16_t phase) {
+uint8_t AUDIO_SCRATCH_FUNC(generate_sine_wave)(uint16_t phase) {
     // Use lookup table for efficiency
     uint8_t table_index = phase >> 8;
     return sine_table[table_index];
 }
 
-uint8_t generate_waveform_sample(sound_system_t *system) {
-    uint16_t phase = system->phase_accumulator >> 16;
+/**
+ * Render one of the four basic shapes at the given phase as a bipolar Q15 sample
+ */
+static int32_t AUDIO_HOT_FUNC(render_shape)(uint8_t shape, uint16_t phase, uint16_t duty_threshold) {
     uint8_t sample = 0;
     
-    // Generate the base waveform
-    switch (system->current_waveform) {
+    switch (shape) {
         case WAVEFORM_SQUARE:
-            sample = generate_square_wave(phase, system->duty_cycle);
+            sample = generate_square_wave(phase, duty_threshold);
             break;
         case WAVEFORM_TRIANGLE:
             sample = generate_triangle_wave(phase);
@@ -103,34 +129,284 @@ uint8_t generate_waveform_sample(sound_system_t *system) {
             break;
     }
     
-    // Apply ADSR envelope
-    float envelope_level = adsr_get_level(system);
-    sample = (uint8_t)((sample - 128) * envelope_level + 128);
+    return ((int32_t)sample - 128) << 8;
+}
+
+/**
+ * Render a phase-driven waveform as a bipolar Q15 sample
+ * The morph oscillator only evaluates the two shapes either side of its position.
+ */
+static int32_t AUDIO_HOT_FUNC(render_oscillator)(uint8_t waveform, uint16_t phase, const mod_output_t *mod) {
+    if (waveform != WAVEFORM_MORPH) {
+        return render_shape(waveform, phase, mod->duty_threshold);
+    }
+    
+    uint8_t shape = mod->morph >> 15;
+    int32_t frac = mod->morph & 0x7FFF;
+    int32_t value = render_shape(shape, phase, mod->duty_threshold);
+    if (frac != 0) {
+        int32_t next = render_shape(shape + 1, phase, mod->duty_threshold);
+        value += ((next - value) * frac) >> 15;
+    }
+    return value;
+}
+
+static bool AUDIO_HOT_FUNC(is_phase_voice)(uint8_t waveform) {
+    return waveform <= WAVEFORM_SINE || waveform == WAVEFORM_MORPH;
+}
+
+/**
+ * Render the phase-driven voices of a crossfade and advance the phase
+ * Both voices are mixed before the decimator so its state stays continuous.
+ * A gain of 0 skips that voice.
+ */
+static int32_t AUDIO_HOT_FUNC(render_phase_voices)(sound_system_t *system, const mod_output_t *mod,
+                                                   uint8_t to, int32_t gain, uint8_t from, int32_t from_gain) {
+    int32_t oversampled[OVERSAMPLE_MAX_FACTOR];
+    uint8_t factor = oversampling_get_factor();
+    
+    // 32.32 phase; the fractional increment is only used in 64-bit mode
+    uint64_t phase = ((uint64_t)system->phase_accumulator << 32) | system->phase_fraction;
+    uint64_t increment = (uint64_t)(mod->phase_increment / factor) << 32;
+    if (tuning_is_high_precision()) {
+        // factor >> 1 is log2 of the factor (1, 2 or 4)
+        increment = (((uint64_t)mod->phase_increment << 32) | mod->phase_fraction) >> (factor >> 1);
+    }
+    
+    for (int i = 0; i < factor; i++) {
+        uint16_t sample_phase = phase >> 48;
+        int32_t mix = 0;
+        if (gain) {
+            mix += render_oscillator(to, sample_phase, mod) * gain;
+        }
+        if (from_gain) {
+            mix += render_oscillator(from, sample_phase, mod) * from_gain;
+        }
+        oversampled[i] = mix >> 15;
+        phase += increment;
+    }
+    system->phase_accumulator = (uint32_t)(phase >> 32);
+    system->phase_fraction = (uint32_t)phase;
+    
+    // Run the oscillator at factor x the output rate, then decimate
+    return (factor == 1) ? oversampled[0] : oversampling_decimate(oversampled);
+}
+
+/**
+ * Render a voice that keeps its own state (string, additive bank or grains)
+ */
+static int32_t AUDIO_HOT_FUNC(render_engine_voice)(uint8_t waveform, const mod_output_t *mod) {
+    if (waveform == WAVEFORM_PLUCK) {
+        // Strings are tuned when plucked and have no phase to oversample
+        return ks_process();
+    }
+    if (waveform == WAVEFORM_ADDITIVE) {
+        // Band-limited by construction, rendered in blocks
+        return additive_process(mod->phase_increment);
+    }
+    if (waveform == WAVEFORM_GRANULAR) {
+        // Grains take their pitch when they start
+        return granular_process(mod->phase_increment);
+    }
+    return 0;
+}
+
+uint8_t AUDIO_HOT_FUNC(generate_waveform_sample)(sound_system_t *system) {
+    const mod_output_t *mod = modulation_process_sample();
+    int32_t gain = CROSSFADE_UNITY;
+    int32_t from_gain = 0;
+    int32_t value = 0;
+    
+    // A shape selected during the last fade fades in from silence now
+    if (crossfade_level >= CROSSFADE_UNITY && crossfade_to != system->current_waveform) {
+        crossfade_from = crossfade_to;
+        crossfade_to = system->current_waveform;
+        crossfade_level = 0;
+    }
+    uint8_t waveform = crossfade_to;
+    
+    // Linear crossfade from the previous waveform after a change
+    if (crossfade_level < CROSSFADE_UNITY) {
+        gain = crossfade_level;
+        from_gain = CROSSFADE_UNITY - gain;
+        crossfade_level += crossfade_step;
+    }
+    
+    int32_t phase_gain = is_phase_voice(waveform) ? gain : 0;
+    int32_t phase_from_gain = is_phase_voice(crossfade_from) ? from_gain : 0;
+    if (phase_gain || phase_from_gain) {
+        value = render_phase_voices(system, mod, waveform, phase_gain, crossfade_from, phase_from_gain);
+    }
+    if (!is_phase_voice(waveform)) {
+        value += (render_engine_voice(waveform, mod) * gain) >> 15;
+    }
+    if (from_gain && !is_phase_voice(crossfade_from)) {
+        value += (render_engine_voice(crossfade_from, mod) * from_gain) >> 15;
+    }
+    
+    // One-pole low-pass filter (coefficient 32768 passes the input through)
+    filter_state += ((value - filter_state) * mod->cutoff) >> 15;
+    value = filter_state;
+    
+    // Ring/amplitude modulation and follower level from the audio input
+    value = audio_input_apply(value);
     
-    return sample;
+    // Advance and apply ADSR envelope, scaled by amplitude modulation
+    int32_t envelope = (int32_t)(adsr_process(system) * 32768.0f);
+    envelope = (envelope * mod->gain) >> 15;
+    value = (value * envelope) >> 15;
+    
+    // Drum hits carry their own envelopes
+    value += drums_process();
+    
+    // Decimator ringing can overshoot full scale
+    value = (value >> 8) + 128;
+    if (value < 0) value = 0;
+    if (value > 255) value = 255;
+    
+    return (uint8_t)value;
+}
+
+void AUDIO_HOT_FUNC(waveform_select)(sound_system_t *system, waveform_type_t waveform) {
+    if (waveform >= WAVEFORM_COUNT || waveform == system->current_waveform) {
+        return;
+    }
+    
+    int32_t samples = (int32_t)(timebase_get_sample_rate() * WAVEFORM_CROSSFADE_MS / 1000.0f);
+    int32_t step = (samples > 0) ? CROSSFADE_UNITY / samples : CROSSFADE_UNITY;
+    if (step < 1) step = 1;
+    
+    // The fade starts on the sample after the switch. Both voices of a
+    // running fade are audible, so neither is replaced: going back to the
+    // one fading out reverses the fade, any other shape starts once it ends.
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (crossfade_level < CROSSFADE_UNITY && waveform == crossfade_from) {
+        crossfade_from = crossfade_to;
+        crossfade_to = waveform;
+        crossfade_level = CROSSFADE_UNITY - crossfade_level;
+    }
+    crossfade_step = step;
+    system->current_waveform = waveform;
+    restore_interrupts(irq_state);
 }
 
 void update_phase_accumulator(sound_system_t *system) {
     // Calculate phase increment for current frequency
-    // phase_increment = (frequency * 2^32) / sample_rate
-    system->phase_increment = (uint32_t)((system->frequency * 4294967296.0f) / SAMPLE_RATE);
+    // phase_increment = (frequency * 2^32) / sample_rate, as 32.32 fixed point
+    float frequency = system->frequency;
+    uint32_t fraction;
+    uint32_t increment = tuning_frequency_to_increment(frequency, &fraction);
+    
+    // A sequencer event in the sample interrupt may have retuned meanwhile
+    uint32_t irq_state = save_and_disable_interrupts();
+    if (system->frequency == frequency) {
+        system->phase_increment = increment;
+        system->phase_increment_fraction = fraction;
+    }
+    restore_interrupts(irq_state);
+}
+
+void waveform_set_sample_interrupt(bool enabled) {
+    if (enabled) {
+        // A wrap flagged while stopped would be measured as a late entry
+        pwm_clear_irq(pwm_slice_num);
+        irq_set_enabled(PWM_IRQ_WRAP, true);
+    } else {
+        irq_set_enabled(PWM_IRQ_WRAP, false);
+        pwm_set_gpio_level(PWM_OUTPUT_PIN, timebase_get_pwm_levels() >> 1);
+    }
 }
 
-void pwm_interrupt_handler(void) {
+void AUDIO_SCRATCH_FUNC(pwm_interrupt_handler)(void) {
+    // The PWM counter restarted at the wrap, so it reads the entry latency
+    uint16_t entry_count = pwm_get_counter(pwm_slice_num);
+    
     // Clear the interrupt
     pwm_clear_irq(pwm_slice_num);
+    timebase_count_sample();
+    
+    // Sequencer events due on this sample (notes, frequency, waveform)
+    sequencer_process(&g_sound_system);
+    
+    // Next audio input sample; in trigger mode this may gate the envelope
+    audio_input_process(&g_sound_system);
+    
+    // 8-bit samples are scaled to the PWM counter range set by the timebase
+    uint32_t pwm_levels = timebase_get_pwm_levels();
     
-    if (g_sound_system.output_enabled) {
-        // Generate the next sample
+    // Keep rendering after output is switched off so the release and drum tails are heard
+    if (g_sound_system.output_enabled || g_sound_system.adsr_state != ADSR_IDLE || drums_active()) {
+        // Generate the next sample (also advances the phase accumulator)
         uint8_t sample = generate_waveform_sample(&g_sound_system);
         
         // Update PWM duty cycle with the sample
-        pwm_set_gpio_level(PWM_OUTPUT_PIN, sample);
-        
-        // Update phase accumulator
-        g_sound_system.phase_accumulator += g_sound_system.phase_increment;
+        pwm_set_gpio_level(PWM_OUTPUT_PIN, (sample * pwm_levels) >> 8);
+        spectrum_tap(sample);
+        capture_tap(sample);
+        latency_tap(g_sound_system.envelope_level);
     } else {
         // Output silence (DC bias)
-        pwm_set_gpio_level(PWM_OUTPUT_PIN, 128);
+        pwm_set_gpio_level(PWM_OUTPUT_PIN, pwm_levels >> 1);
+        spectrum_tap(128);
+        capture_tap(128);
+    }
+    
+    // Record timing; a counter value below the entry value means the
+    // handler ran into the next sample period
+    uint16_t exit_count = pwm_get_counter(pwm_slice_num);
+    if (isr_stats_reset_pending) {
+        isr_stats.worst_latency = 0;
+        isr_stats.worst_duration = 0;
+        isr_stats.total_duration = 0;
+        isr_stats.count = 0;
+        isr_stats.overruns = 0;
+        isr_stats_reset_pending = false;
+    }
+    uint32_t duration;
+    if (exit_count >= entry_count) {
+        duration = exit_count - entry_count;
+    } else {
+        duration = exit_count + pwm_levels - entry_count;
+        isr_stats.overruns++;
     }
-}
\ No newline at end of file
+    if (entry_count > isr_stats.worst_latency) isr_stats.worst_latency = entry_count;
+    if (duration > isr_stats.worst_duration) isr_stats.worst_duration = duration;
+    isr_stats.total_duration += duration;
+    isr_stats.count++;
+}
+
+void waveform_get_isr_stats(isr_stats_t *stats) {
+    uint32_t irq_state = save_and_disable_interrupts();
+    stats->worst_latency = isr_stats.worst_latency;
+    stats->worst_duration = isr_stats.worst_duration;
+    stats->total_duration = isr_stats.total_duration;
+    stats->count = isr_stats.count;
+    stats->overruns = isr_stats.overruns;
+    restore_interrupts(irq_state);
+    
+    // Convert PWM ticks to clk_sys cycles
+    uint32_t divider = timebase_get_pwm_divider();
+    stats->worst_latency *= divider;
+    stats->worst_duration *= divider;
+    stats->total_duration *= divider;
+}
+
+void waveform_reset_isr_stats(void) {
+    isr_stats_reset_pending = true;
+}
+
+void waveform_print_isr_stats(void) {
+    static const char *placement_names[] = {"XIP flash", "SRAM", "scratch banks"};
+    isr_stats_t stats;
+    waveform_get_isr_stats(&stats);
+    
+    uint32_t budget = timebase_get_pwm_levels() * timebase_get_pwm_divider();
+    printf("Sample ISR (hot path in %s, %lu samples):\n",
+           placement_names[AUDIO_HOT_PATH_PLACEMENT], (unsigned long)stats.count);
+    printf("  Worst latency: %lu cycles\n", (unsigned long)stats.worst_latency);
+    printf("  Worst duration: %lu cycles, average %lu cycles (budget %lu)\n",
+           (unsigned long)stats.worst_duration,
+           (unsigned long)(stats.count ? stats.total_duration / stats.count : 0),
+           (unsigned long)budget);
+    printf("  Overruns: %lu\n", (unsigned long)stats.overruns);
+}
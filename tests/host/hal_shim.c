@@ -0,0 +1,503 @@
+/**
+ * Host HAL Shim
+ *
+ * Minimal implementations of the Pico SDK calls the sources make, so the
+ * modules can be built and exercised with the host compiler. Peripherals
+ * only record what they were told; time, ADC inputs and pin levels are set
+ * by the tests through host_hal.h.
+ */
+
+#include "host_hal.h"
+#include "hardware/adc.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+#include "hardware/vreg.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
+#include "tusb.h"
+
+#define HOST_GPIO_COUNT 30
+#define HOST_ADC_CHANNELS 5
+#define HOST_DMA_CHANNELS 12
+
+uint8_t host_flash[HOST_FLASH_SIZE];
+sound_system_t g_sound_system;
+
+static uint64_t now_us = 0;
+static uint32_t sys_clock_hz = 150000000;
+
+// Time
+
+void host_set_time_us(uint64_t us) {
+    now_us = us;
+}
+
+void host_advance_us(uint64_t us) {
+    now_us += us;
+}
+
+uint64_t time_us_64(void) {
+    return now_us;
+}
+
+uint32_t time_us_32(void) {
+    return (uint32_t)now_us;
+}
+
+void sleep_us(uint64_t us) {
+    now_us += us;
+}
+
+void sleep_ms(uint32_t ms) {
+    now_us += (uint64_t)ms * 1000u;
+}
+
+void busy_wait_us(uint64_t us) {
+    now_us += us;
+}
+
+void tight_loop_contents(void) {
+    // Polling loops would never see time move otherwise
+    now_us++;
+}
+
+uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+void restore_interrupts(uint32_t status) {
+    (void)status;
+}
+
+// Clocks
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    if (clk_index == clk_usb || clk_index == clk_adc) {
+        return 48000000;
+    }
+    return sys_clock_hz;
+}
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required) {
+    (void)required;
+    sys_clock_hz = freq_khz * 1000u;
+    return true;
+}
+
+void host_set_sys_clock_hz(uint32_t hz) {
+    sys_clock_hz = hz;
+}
+
+void vreg_set_voltage(enum vreg_voltage voltage) {
+    (void)voltage;
+}
+
+// GPIO
+
+#define HOST_GPIO_RAW_HANDLERS 4
+
+static bool gpio_levels[HOST_GPIO_COUNT];
+static uint32_t gpio_irq_events[HOST_GPIO_COUNT];
+static uint32_t gpio_irq_pending[HOST_GPIO_COUNT];
+static gpio_irq_callback_t gpio_callback = NULL;
+static bool gpio_bank_irq_enabled = false;
+static uint32_t gpio_unacknowledged = 0;
+
+// Raw handlers, highest order priority first
+static struct {
+    uint32_t mask;
+    irq_handler_t handler;
+    uint8_t order_priority;
+} gpio_raw[HOST_GPIO_RAW_HANDLERS];
+static uint32_t gpio_raw_count = 0;
+static uint32_t gpio_raw_mask = 0;
+
+// Set when an enabled interrupt is raised; ends __wfi()
+static bool interrupt_raised = false;
+static void (*wfi_hook)(void) = NULL;
+
+void gpio_init(uint gpio) {
+    // Buttons are pulled up, so idle pins read high
+    gpio_levels[gpio] = true;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    gpio_levels[gpio] = value;
+}
+
+bool gpio_get(uint gpio) {
+    return gpio_levels[gpio];
+}
+
+void gpio_pull_up(uint gpio) {
+    gpio_levels[gpio] = true;
+}
+
+void gpio_set_function(uint gpio, int fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled,
+                                        gpio_irq_callback_t callback) {
+    gpio_callback = callback;
+    gpio_set_irq_enabled(gpio, event_mask, enabled);
+    gpio_bank_irq_enabled = true;
+}
+
+void gpio_add_raw_irq_handler_with_order_priority_masked(uint32_t gpio_mask, irq_handler_t handler,
+                                                         uint8_t order_priority) {
+    uint32_t i = gpio_raw_count++;
+    while (i > 0 && gpio_raw[i - 1].order_priority < order_priority) {
+        gpio_raw[i] = gpio_raw[i - 1];
+        i--;
+    }
+    gpio_raw[i].mask = gpio_mask;
+    gpio_raw[i].handler = handler;
+    gpio_raw[i].order_priority = order_priority;
+    gpio_raw_mask |= gpio_mask;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return gpio_irq_pending[gpio] & gpio_irq_events[gpio];
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t events) {
+    gpio_irq_pending[gpio] &= ~events;
+}
+
+/**
+ * IO bank interrupt: raw handlers in order priority, then the callback for
+ * the pins no raw handler claims (the SDK's default handler)
+ */
+static void gpio_bank_interrupt(void) {
+    interrupt_raised = true;
+    for (uint32_t i = 0; i < gpio_raw_count; i++) {
+        gpio_raw[i].handler();
+    }
+    for (uint gpio = 0; gpio < HOST_GPIO_COUNT; gpio++) {
+        uint32_t events = gpio_get_irq_event_mask(gpio);
+        if (events && !(gpio_raw_mask & (1u << gpio)) && gpio_callback) {
+            gpio_acknowledge_irq(gpio, events);
+            gpio_callback(gpio, events);
+        }
+    }
+    for (uint gpio = 0; gpio < HOST_GPIO_COUNT; gpio++) {
+        if (gpio_get_irq_event_mask(gpio)) {
+            // On the device the interrupt would fire again at once
+            gpio_unacknowledged++;
+            gpio_acknowledge_irq(gpio, gpio_irq_pending[gpio]);
+        }
+    }
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled) {
+    if (enabled) {
+        gpio_irq_events[gpio] |= event_mask;
+    } else {
+        gpio_irq_events[gpio] &= ~event_mask;
+    }
+}
+
+void host_set_gpio(uint gpio, bool level) {
+    bool previous = gpio_levels[gpio];
+    gpio_levels[gpio] = level;
+    if (previous == level) {
+        return;
+    }
+    gpio_irq_pending[gpio] |= level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+    if (gpio_bank_irq_enabled && gpio_get_irq_event_mask(gpio)) {
+        gpio_bank_interrupt();
+    }
+}
+
+uint32_t host_gpio_unacknowledged(void) {
+    return gpio_unacknowledged;
+}
+
+void host_set_wfi_hook(void (*hook)(void)) {
+    wfi_hook = hook;
+}
+
+void __wfi(void) {
+    // Without a hook nothing can happen while asleep
+    interrupt_raised = false;
+    for (uint32_t i = 0; wfi_hook && !interrupt_raised && i < HOST_WFI_MAX_HOOK_CALLS; i++) {
+        wfi_hook();
+    }
+}
+
+// ADC
+
+static adc_hw_t adc_registers;
+adc_hw_t *adc_hw = &adc_registers;
+static uint16_t adc_values[HOST_ADC_CHANNELS];
+static uint adc_input = 0;
+
+void host_set_adc(uint channel, uint16_t value) {
+    adc_values[channel] = value;
+}
+
+void adc_init(void) {
+}
+
+void adc_gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void adc_select_input(uint input) {
+    adc_input = input;
+}
+
+uint16_t adc_read(void) {
+    return adc_values[adc_input];
+}
+
+void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift) {
+    (void)en;
+    (void)dreq_en;
+    (void)dreq_thresh;
+    (void)err_in_fifo;
+    (void)byte_shift;
+}
+
+void adc_set_round_robin(uint input_mask) {
+    (void)input_mask;
+}
+
+void adc_set_clkdiv(float clkdiv) {
+    (void)clkdiv;
+}
+
+void adc_run(bool run) {
+    (void)run;
+}
+
+void adc_fifo_drain(void) {
+}
+
+// DMA: channels are claimed and configured, but never transfer
+
+static dma_channel_hw_t dma_channels[HOST_DMA_CHANNELS];
+static uint dma_claimed = 0;
+
+int dma_claim_unused_channel(bool required) {
+    if (dma_claimed == HOST_DMA_CHANNELS) {
+        return required ? 0 : -1;
+    }
+    return (int)dma_claimed++;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    return (dma_channel_config){0};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    (void)c;
+    (void)size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_ring(dma_channel_config *c, bool write, uint size_bits) {
+    (void)c;
+    (void)write;
+    (void)size_bits;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    (void)c;
+    (void)dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to) {
+    (void)c;
+    (void)chain_to;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger) {
+    (void)config;
+    (void)trigger;
+    dma_channels[channel].write_addr = write_addr;
+    dma_channels[channel].read_addr = read_addr;
+    dma_channels[channel].transfer_count = transfer_count;
+}
+
+void dma_channel_abort(uint channel) {
+    (void)channel;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    (void)channel;
+    return false;
+}
+
+dma_channel_hw_t *dma_channel_hw_addr(uint channel) {
+    return &dma_channels[channel];
+}
+
+// PWM and interrupts: the sample interrupt is never raised by the shim
+
+static uint16_t pwm_wrap[8];
+static uint8_t pwm_divider[8];
+
+uint pwm_gpio_to_slice_num(uint gpio) {
+    return (gpio >> 1) & 7u;
+}
+
+pwm_config pwm_get_default_config(void) {
+    return (pwm_config){0};
+}
+
+void pwm_config_set_clkdiv(pwm_config *c, float div) {
+    (void)c;
+    (void)div;
+}
+
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap) {
+    c->top = wrap;
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start) {
+    (void)slice_num;
+    (void)c;
+    (void)start;
+}
+
+void pwm_clear_irq(uint slice_num) {
+    (void)slice_num;
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled) {
+    (void)slice_num;
+    (void)enabled;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap) {
+    pwm_wrap[slice_num & 7u] = wrap;
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level) {
+    (void)gpio;
+    (void)level;
+}
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract) {
+    (void)fract;
+    pwm_divider[slice_num & 7u] = integer;
+}
+
+uint16_t host_get_pwm_wrap(uint slice_num) {
+    return pwm_wrap[slice_num & 7u];
+}
+
+uint8_t host_get_pwm_divider(uint slice_num) {
+    return pwm_divider[slice_num & 7u];
+}
+
+uint16_t pwm_get_counter(uint slice_num) {
+    (void)slice_num;
+    return 0;
+}
+
+void irq_set_exclusive_handler(uint num, void (*handler)(void)) {
+    (void)num;
+    (void)handler;
+}
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num == IO_IRQ_BANK0) {
+        gpio_bank_irq_enabled = enabled;
+    }
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    (void)entry;
+}
+
+// Serial: output goes to the host stdout, the USB link counts bytes
+
+static uint32_t usb_bytes = 0;
+
+static void host_usb_out_chars(const char *buf, int len) {
+    (void)buf;
+    usb_bytes += (uint32_t)len;
+}
+
+stdio_driver_t stdio_usb = {
+    .out_chars = host_usb_out_chars,
+};
+
+uint32_t host_take_usb_bytes(void) {
+    uint32_t bytes = usb_bytes;
+    usb_bytes = 0;
+    return bytes;
+}
+
+bool stdio_usb_connected(void) {
+    return true;
+}
+
+static char serial_input[256];
+static uint32_t serial_head = 0;
+static uint32_t serial_tail = 0;
+static void (*chars_available)(void *) = NULL;
+static void *chars_available_param = NULL;
+
+uint32_t tud_cdc_available(void) {
+    return serial_head - serial_tail;
+}
+
+uint32_t tud_cdc_write_available(void) {
+    return 256;
+}
+
+int stdio_init_all(void) {
+    return 1;
+}
+
+void host_queue_serial(const char *text) {
+    while (*text) {
+        serial_input[serial_head++ % sizeof(serial_input)] = *text++;
+    }
+    // Reported from the USB interrupt on the device
+    if (chars_available) {
+        interrupt_raised = true;
+        chars_available(chars_available_param);
+    }
+}
+
+int getchar_timeout_us(uint32_t timeout_us) {
+    (void)timeout_us;
+    if (serial_tail == serial_head) {
+        return PICO_ERROR_TIMEOUT;
+    }
+    return (unsigned char)serial_input[serial_tail++ % sizeof(serial_input)];
+}
+
+void stdio_set_driver_enabled(stdio_driver_t *driver, bool enabled) {
+    (void)driver;
+    (void)enabled;
+}
+
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param) {
+    chars_available = fn;
+    chars_available_param = param;
+}
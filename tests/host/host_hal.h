@@ -0,0 +1,97 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+/**
+ * Host HAL shim controls
+ *
+ * The shim implements the Pico SDK calls used by the sources on the host.
+ * Time only moves when a test (or a sleep/busy-wait in the code under test)
+ * advances it, so runs are deterministic.
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/gpio.h"
+#include "sound_explorer.h"
+
+#define HOST_FLASH_SIZE (4u * 1024u * 1024u)
+#define HOST_WFI_MAX_HOOK_CALLS 100000     // __wfi() gives up after this many hook calls
+
+extern uint8_t host_flash[HOST_FLASH_SIZE];
+
+// The sound system lives in main.c on the device
+extern sound_system_t g_sound_system;
+
+/**
+ * Set the simulated time
+ * @param us Microseconds since boot
+ */
+void host_set_time_us(uint64_t us);
+
+/**
+ * Advance the simulated time
+ * @param us Microseconds to add
+ */
+void host_advance_us(uint64_t us);
+
+/**
+ * Set the value the next conversions of an ADC channel return
+ * @param channel ADC channel (0-4)
+ * @param value Raw reading (0-4095)
+ */
+void host_set_adc(uint channel, uint16_t value);
+
+/**
+ * Drive an input pin, raising the GPIO interrupt if its edge is enabled
+ * @param gpio Pin number
+ * @param level New level
+ */
+void host_set_gpio(uint gpio, bool level);
+
+/**
+ * GPIO interrupts raised that no handler acknowledged (an interrupt storm
+ * on the device)
+ * @return Count since start
+ */
+uint32_t host_gpio_unacknowledged(void);
+
+/**
+ * Set what happens while the code under test sleeps in __wfi(): the hook is
+ * called repeatedly (advancing time, driving pins or serial input) until an
+ * enabled interrupt is raised, or HOST_WFI_MAX_HOOK_CALLS times
+ * @param hook Function to call, or NULL to return from __wfi() at once
+ */
+void host_set_wfi_hook(void (*hook)(void));
+
+/**
+ * Set the frequency clock_get_hz() reports for clk_sys
+ * @param hz Frequency in Hz
+ */
+void host_set_sys_clock_hz(uint32_t hz);
+
+/**
+ * Wrap last programmed into a PWM slice
+ * @param slice_num PWM slice
+ * @return Wrap (counter top)
+ */
+uint16_t host_get_pwm_wrap(uint slice_num);
+
+/**
+ * Integer clock divider last programmed into a PWM slice
+ * @param slice_num PWM slice
+ * @return Divider
+ */
+uint8_t host_get_pwm_divider(uint slice_num);
+
+/**
+ * Queue text for getchar_timeout_us() to return, as if typed on the console
+ * @param text Characters to queue (include the line ending)
+ */
+void host_queue_serial(const char *text);
+
+/**
+ * Bytes written to the USB CDC driver since the last call
+ * @return Byte count
+ */
+uint32_t host_take_usb_bytes(void);
+
+#endif // HOST_HAL_H
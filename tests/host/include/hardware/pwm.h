@@ -0,0 +1,28 @@
+#ifndef HOST_HARDWARE_PWM_H
+#define HOST_HARDWARE_PWM_H
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+
+#define PWM_IRQ_WRAP 4
+
+typedef struct {
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+uint pwm_gpio_to_slice_num(uint gpio);
+pwm_config pwm_get_default_config(void);
+void pwm_config_set_clkdiv(pwm_config *c, float div);
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap);
+void pwm_init(uint slice_num, pwm_config *c, bool start);
+void pwm_clear_irq(uint slice_num);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract);
+uint16_t pwm_get_counter(uint slice_num);
+
+
+#endif // HOST_HARDWARE_PWM_H
@@ -0,0 +1,10 @@
+#ifndef HOST_HARDWARE_REGS_ADDRESSMAP_H
+#define HOST_HARDWARE_REGS_ADDRESSMAP_H
+
+#include <stdint.h>
+
+// Flash is a host buffer (see host_hal.h); offsets into it match the device
+extern uint8_t host_flash[];
+#define XIP_BASE ((uintptr_t)host_flash)
+
+#endif // HOST_HARDWARE_REGS_ADDRESSMAP_H
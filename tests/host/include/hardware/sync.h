@@ -0,0 +1,15 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include "pico/stdlib.h"
+
+// The host runs the sample path synchronously, so masking is a no-op
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+static inline void __wfe(void) {}
+void __wfi(void);                   // Returns when an enabled interrupt is raised
+static inline void __sev(void) {}
+static inline void __dmb(void) { __sync_synchronize(); }
+
+#endif // HOST_HARDWARE_SYNC_H
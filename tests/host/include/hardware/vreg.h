@@ -0,0 +1,17 @@
+#ifndef HOST_HARDWARE_VREG_H
+#define HOST_HARDWARE_VREG_H
+
+#include "pico/stdlib.h"
+
+enum vreg_voltage {
+    VREG_VOLTAGE_1_10 = 0,
+    VREG_VOLTAGE_1_15,
+    VREG_VOLTAGE_1_20,
+    VREG_VOLTAGE_1_25,
+    VREG_VOLTAGE_1_30,
+    VREG_VOLTAGE_DEFAULT = VREG_VOLTAGE_1_10
+};
+
+void vreg_set_voltage(enum vreg_voltage voltage);
+
+#endif // HOST_HARDWARE_VREG_H
@@ -0,0 +1,9 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+// Core 1 is never started on the host
+void multicore_launch_core1(void (*entry)(void));
+
+#endif // HOST_PICO_MULTICORE_H
@@ -0,0 +1,18 @@
+#ifndef HOST_PICO_STDIO_USB_H
+#define HOST_PICO_STDIO_USB_H
+
+#include "pico/stdlib.h"
+
+struct stdio_driver {
+    void (*out_chars)(const char *buf, int len);
+    void (*out_flush)(void);
+    int (*in_chars)(char *buf, int len);
+    void (*set_chars_available_callback)(void (*fn)(void *), void *param);
+    struct stdio_driver *next;
+};
+
+extern stdio_driver_t stdio_usb;
+
+bool stdio_usb_connected(void);
+
+#endif // HOST_PICO_STDIO_USB_H
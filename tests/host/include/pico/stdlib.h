@@ -0,0 +1,52 @@
+/**
+ * Host HAL shim: the subset of pico/stdlib.h used by the sources
+ *
+ * Time is simulated; see host_hal.h for the controls tests use.
+ */
+
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+#define PICO_ERROR_TIMEOUT (-1)
+
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+#define __isr
+#define __force_inline inline
+#define __not_in_flash(group)
+#define __not_in_flash_func(func_name) func_name
+#define __time_critical_func(func_name) func_name
+#define __scratch_x(group)
+#define __scratch_y(group)
+
+#define GPIO_IN 0
+#define GPIO_OUT 1
+#define GPIO_FUNC_PWM 4
+
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void busy_wait_us(uint64_t us);
+void tight_loop_contents(void);
+
+int stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+
+typedef struct stdio_driver stdio_driver_t;
+void stdio_set_driver_enabled(stdio_driver_t *driver, bool enabled);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, int fn);
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,9 @@
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+
+#include <stdint.h>
+
+uint32_t tud_cdc_available(void);
+uint32_t tud_cdc_write_available(void);
+
+#endif // HOST_TUSB_H
@@ -0,0 +1,164 @@
+/**
+ * ADSR envelope continuity tests
+ *
+ * Drives adsr_process() through note-off mid-attack and retriggers mid-release
+ * and mid-decay, and checks the level never jumps between two samples.
+ */
+
+#include "test_support.h"
+#include "host_hal.h"
+#include "adsr_envelope.h"
+#include "timebase.h"
+
+#define ATTACK_S 0.10f
+#define DECAY_S 0.20f
+#define SUSTAIN 0.5f
+#define RELEASE_S 0.30f
+
+// A stage covers its full range in its time with ln(1/0.0001) ~ 9.2 time
+// constants, so the steepest step is about 9.2 / (time * rate); anything
+// far above that is a discontinuity
+#define SHORTEST_STAGE_S ATTACK_S
+#define MAX_STEP (12.0f / (SHORTEST_STAGE_S * SAMPLE_RATE))
+
+static sound_system_t sys;
+static float max_step;
+
+/**
+ * Run the envelope and track the largest sample-to-sample step
+ * @return Level after the last sample
+ */
+static float run_samples(uint32_t count) {
+    float previous = sys.envelope_level;
+    for (uint32_t n = 0; n < count; n++) {
+        float level = adsr_process(&sys);
+        float step = fabsf(level - previous);
+        if (step > max_step) {
+            max_step = step;
+        }
+        previous = level;
+    }
+    return previous;
+}
+
+static uint32_t seconds(float s) {
+    return (uint32_t)(s * timebase_get_sample_rate());
+}
+
+static void reset(void) {
+    // adsr_update() only recomputes when the parameters change, so carry the
+    // coefficients over
+    sound_system_t previous = sys;
+    sys = (sound_system_t){0};
+    sys.attack_stage = previous.attack_stage;
+    sys.decay_stage = previous.decay_stage;
+    sys.release_stage = previous.release_stage;
+    sys.attack_time = ATTACK_S;
+    sys.decay_time = DECAY_S;
+    sys.sustain_level = SUSTAIN;
+    sys.release_time = RELEASE_S;
+    sys.adsr_state = ADSR_IDLE;
+    adsr_update(&sys);
+    max_step = 0.0f;
+}
+
+static void test_full_note(void) {
+    reset();
+    adsr_gate(&sys, true);
+    float level = run_samples(seconds(ATTACK_S + DECAY_S + 0.05f));
+    CHECK(sys.adsr_state == ADSR_SUSTAIN, "not in sustain after attack + decay (state %d)", sys.adsr_state);
+    CHECK(level == SUSTAIN, "sustain level %f", level);
+
+    adsr_gate(&sys, false);
+    level = run_samples(seconds(RELEASE_S * 1.1f));
+    CHECK(sys.adsr_state == ADSR_IDLE && level == 0.0f, "release did not end (level %f)", level);
+    CHECK(max_step < MAX_STEP, "full note step %f >= %f", max_step, MAX_STEP);
+}
+
+static void test_note_off_mid_attack(void) {
+    reset();
+    adsr_note_on(&sys);
+    float level = run_samples(seconds(ATTACK_S / 3));
+    CHECK(sys.adsr_state == ADSR_ATTACK, "attack ended early");
+    CHECK(level > 0.1f && level < 0.9f, "mid-attack level %f", level);
+
+    // Release starts from the attack level, not from the sustain level
+    adsr_note_off(&sys);
+    float first = run_samples(1);
+    CHECK(first < level && level - first < MAX_STEP, "release from %f went to %f", level, first);
+
+    float previous = first;
+    bool falling = true;
+    while (sys.adsr_state == ADSR_RELEASE) {
+        float next = run_samples(1);
+        falling = falling && next <= previous;
+        previous = next;
+    }
+    CHECK(falling, "release is not monotonic");
+    CHECK(max_step < MAX_STEP, "note-off mid-attack step %f >= %f", max_step, MAX_STEP);
+}
+
+static void test_retrigger_mid_release(void) {
+    reset();
+    adsr_gate(&sys, true);
+    run_samples(seconds(ATTACK_S + DECAY_S + 0.05f));
+    adsr_gate(&sys, false);
+    float level = run_samples(seconds(RELEASE_S / 10));
+    CHECK(sys.adsr_state == ADSR_RELEASE && level > 0.05f, "release level %f", level);
+
+    // Attack climbs from where the release got to, not from zero
+    adsr_note_on(&sys);
+    float first = run_samples(1);
+    CHECK(first > level && first - level < MAX_STEP, "retrigger from %f went to %f", level, first);
+
+    run_samples(seconds(ATTACK_S + DECAY_S));
+    CHECK(sys.adsr_state == ADSR_SUSTAIN, "retriggered note did not reach sustain");
+    CHECK(max_step < MAX_STEP, "retrigger mid-release step %f >= %f", max_step, MAX_STEP);
+}
+
+static void test_retrigger_mid_decay(void) {
+    reset();
+    adsr_gate(&sys, true);
+    run_samples(seconds(ATTACK_S) + seconds(DECAY_S / 4));
+    CHECK(sys.adsr_state == ADSR_DECAY, "not in decay (state %d)", sys.adsr_state);
+
+    float level = sys.envelope_level;
+    adsr_gate(&sys, true);
+    float first = run_samples(1);
+    CHECK(first >= level, "retrigger mid-decay fell from %f to %f", level, first);
+    CHECK(max_step < MAX_STEP, "retrigger mid-decay step %f >= %f", max_step, MAX_STEP);
+}
+
+static void test_repeated_retriggers(void) {
+    // Hammer the gate at a period unrelated to the stage times
+    reset();
+    for (int i = 0; i < 40; i++) {
+        adsr_gate(&sys, (i & 1) == 0);
+        run_samples(1237 + i * 97);
+    }
+    CHECK(max_step < MAX_STEP, "repeated retrigger step %f >= %f", max_step, MAX_STEP);
+}
+
+static void test_instant_stages(void) {
+    // Zero-time stages jump by design; the level must still stay in range
+    reset();
+    sys.attack_time = 0.0f;
+    sys.release_time = 0.0f;
+    adsr_update(&sys);
+    adsr_gate(&sys, true);
+    float level = run_samples(1);
+    CHECK(level == 1.0f, "instant attack reached %f", level);
+    adsr_gate(&sys, false);
+    level = run_samples(1);
+    CHECK(level == 0.0f && sys.adsr_state == ADSR_IDLE, "instant release reached %f", level);
+}
+
+int main(void) {
+    test_full_note();
+    test_note_off_mid_attack();
+    test_retrigger_mid_release();
+    test_retrigger_mid_decay();
+    test_repeated_retriggers();
+    test_instant_stages();
+    return test_finish("test_adsr");
+}
@@ -0,0 +1,108 @@
+/**
+ * Granular source reload test
+ *
+ * Reloads the capture snapshot while grains are playing from it, and runs
+ * the sample interrupt in the middle of the copy (as the device would) with
+ * the snapshot filled with a marker value. Nothing read from the snapshot
+ * may reach the output until the new source is published.
+ */
+
+#include <stdlib.h>
+#include "test_support.h"
+#include "host_hal.h"
+
+// Stand in for the copy so the interrupt can be run part-way through it
+#define capture_copy_recent test_copy_recent
+#include "../src/granular.c"
+#undef capture_copy_recent
+
+// capture.h was included above under the stand-in name
+uint32_t capture_copy_recent(uint8_t *dest, uint32_t count);
+
+#define TONE_SAMPLES 40000
+#define RUN_SAMPLES 8000
+
+static bool interrupt_during_copy = false;
+static int32_t peak_during_copy;
+static uint8_t grains_during_copy;
+
+/**
+ * Render samples as the sample interrupt does
+ * @return Largest output magnitude
+ */
+static int32_t run_samples(uint32_t count) {
+    int32_t peak = 0;
+    for (uint32_t n = 0; n < count; n++) {
+        int32_t value = abs(granular_process(1u << 24));
+        peak = value > peak ? value : peak;
+    }
+    return peak;
+}
+
+uint32_t test_copy_recent(uint8_t *dest, uint32_t count) {
+    if (interrupt_during_copy) {
+        // Half-written snapshot full of marker values that would be loud if
+        // read; samples already rendered into the current block are not
+        // from it, so start a fresh block
+        memset(dest, 0xFF, count / 2);
+        block_position = GRANULAR_BLOCK_SIZE;
+        peak_during_copy = run_samples(4 * GRANULAR_BLOCK_SIZE);
+        grains_during_copy = active_count;
+    }
+    return capture_copy_recent(dest, count);
+}
+
+static void fill_capture(float frequency) {
+    float rate = timebase_get_sample_rate();
+    for (int n = 0; n < TONE_SAMPLES; n++) {
+        capture_tap((uint8_t)lrintf(128.0f + 100.0f * sinf(2.0f * (float)M_PI * frequency * n / rate)));
+    }
+}
+
+static void test_reload_while_playing(void) {
+    capture_set_ring(true);
+    fill_capture(440.0f);
+    CHECK(granular_load_source(GRANULAR_SOURCE_CAPTURE), "first capture load failed");
+    granular_set_scheduler(200.0f, 100.0f, 0.5f, 0.5f);
+
+    int32_t playing = run_samples(RUN_SAMPLES);
+    CHECK(active_count > 4 && playing > 1000, "grains not playing (%d active, peak %ld)",
+          active_count, (long)playing);
+
+    fill_capture(660.0f);
+    interrupt_during_copy = true;
+    CHECK(granular_load_source(GRANULAR_SOURCE_CAPTURE), "reload failed");
+    interrupt_during_copy = false;
+    CHECK(peak_during_copy == 0, "output %ld rendered during the copy", (long)peak_during_copy);
+    CHECK(grains_during_copy == 0, "%d grains still active during the copy", grains_during_copy);
+
+    int32_t after = run_samples(RUN_SAMPLES);
+    CHECK(active_count > 4 && after > 1000, "grains did not resume (%d active, peak %ld)",
+          active_count, (long)after);
+}
+
+static void test_switch_source_retires_grains(void) {
+    // Grains started on one source must not outlive a switch to another
+    const int8_t *old = source_data;
+    CHECK(old == capture_source && active_count > 0, "no capture grains to retire");
+    static const int8_t other_source[1 << GRANULAR_MIN_SOURCE_BITS];
+    source_data = other_source;
+    source_bits = GRANULAR_MIN_SOURCE_BITS;
+    granular_publish();
+    block_position = GRANULAR_BLOCK_SIZE;
+    run_samples(GRANULAR_BLOCK_SIZE);
+    bool stale = false;
+    for (int i = 0; i < active_count; i++) {
+        stale = stale || pool[i].data == old;
+    }
+    CHECK(!stale, "grains on the old source survived the switch");
+}
+
+int main(void) {
+    timebase_init();
+    capture_init();
+    granular_init();
+    test_reload_while_playing();
+    test_switch_source_retires_grains();
+    return test_finish("test_granular");
+}
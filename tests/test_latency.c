@@ -0,0 +1,287 @@
+/**
+ * Latency harness tests
+ *
+ * Simulates the device on the HAL shim: the sample interrupt runs at the
+ * sample rate and the main loop polls the buttons and serial port every
+ * millisecond. Bouncing button presses and serial note commands are fed in
+ * at known times, and every trial the harness records is compared with the
+ * handler and first-audible-sample times seen by the simulation. The
+ * trial ring and the percentile report are checked with known data.
+ */
+
+#include "test_support.h"
+#include "host_hal.h"
+#include "../src/latency.c"
+#include "waveform_generator.h"
+#include "adsr_envelope.h"
+#include "ui_controls.h"
+#include "uart_comm.h"
+#include "modulation.h"
+#include "oversampling.h"
+#include "karplus_strong.h"
+#include "additive.h"
+#include "drums.h"
+#include "granular.h"
+#include "audio_input.h"
+#include "tuning.h"
+#include "capture.h"
+#include "sequencer.h"
+#include "power.h"
+
+#define MAIN_LOOP_US 1000
+#define BUTTON_TRIALS 24
+#define SERIAL_TRIALS 6
+
+// Simulation state
+static uint64_t next_sample_ns;
+static uint64_t next_main_us;
+static uint64_t sample_period_ns;
+
+// What the simulation saw for the trial in flight
+static bool watching = false;
+static uint64_t seen_handled_us;
+static uint64_t seen_sound_us;
+
+static void main_loop(void) {
+    bool was_enabled = g_sound_system.output_enabled;
+    ui_update_buttons(&g_sound_system);
+    adsr_update(&g_sound_system);
+    update_phase_accumulator(&g_sound_system);
+    modulation_update_control(&g_sound_system);
+    uart_poll_commands(&g_sound_system);
+    sequencer_service(&g_sound_system);
+    capture_service();
+    latency_service();
+    if (!was_enabled && g_sound_system.output_enabled) {
+        seen_handled_us = time_us_64();
+        watching = true;
+    }
+}
+
+/**
+ * Run the sample interrupt and main loop until the given time
+ */
+static void run_until(uint64_t end_us) {
+    for (;;) {
+        uint64_t sample_us = next_sample_ns / 1000;
+        uint64_t next = sample_us <= next_main_us ? sample_us : next_main_us;
+        if (next > end_us) {
+            host_set_time_us(end_us);
+            return;
+        }
+        host_set_time_us(next);
+        if (sample_us <= next_main_us) {
+            pwm_interrupt_handler();
+            if (watching && g_sound_system.output_enabled &&
+                g_sound_system.envelope_level >= LATENCY_ENVELOPE_THRESHOLD) {
+                seen_sound_us = next;
+                watching = false;
+            }
+            next_sample_ns += sample_period_ns;
+        } else {
+            main_loop();
+            next_main_us += MAIN_LOOP_US;
+        }
+    }
+}
+
+/**
+ * Press the output toggle button at the given time with contact bounce
+ */
+static void press_button(uint64_t at_us) {
+    static const uint32_t bounce_us[] = {0, 150, 300, 520, 700};
+    for (unsigned i = 0; i < count_of(bounce_us); i++) {
+        run_until(at_us + bounce_us[i]);
+        host_set_gpio(OUTPUT_TOGGLE_PIN, (i & 1) != 0);
+    }
+}
+
+static void release_button(uint64_t at_us) {
+    static const uint32_t bounce_us[] = {0, 200, 350};
+    for (unsigned i = 0; i < count_of(bounce_us); i++) {
+        run_until(at_us + bounce_us[i]);
+        host_set_gpio(OUTPUT_TOGGLE_PIN, (i & 1) == 0);
+    }
+}
+
+static uint32_t sample_period_us(void) {
+    return (uint32_t)(1000000.0f / timebase_get_sample_rate());
+}
+
+/**
+ * Check the newest recorded trial against what the simulation saw
+ */
+static void check_last_trial(latency_source_t source, uint64_t input_us, uint32_t expected_count) {
+    latency_trials_t *t = &trials[source];
+    CHECK(t->count == expected_count, "%s: %lu trials recorded, expected %lu",
+          latency_get_source_name(source), (unsigned long)t->count, (unsigned long)expected_count);
+    if (t->count == 0) {
+        return;
+    }
+    uint32_t slot = (t->count - 1) % LATENCY_MAX_TRIALS;
+    uint32_t handled = (uint32_t)(seen_handled_us - input_us);
+    uint32_t total = (uint32_t)(seen_sound_us - input_us) + sample_period_us();
+    CHECK(t->handled_us[slot] == handled, "%s trial %lu: input to handler %lu us, simulation saw %lu us",
+          latency_get_source_name(source), (unsigned long)t->count,
+          (unsigned long)t->handled_us[slot], (unsigned long)handled);
+    CHECK(t->total_us[slot] == total, "%s trial %lu: total %lu us, simulation saw %lu us",
+          latency_get_source_name(source), (unsigned long)t->count,
+          (unsigned long)t->total_us[slot], (unsigned long)total);
+}
+
+static void setup(void) {
+    g_sound_system = (sound_system_t){
+        .current_waveform = WAVEFORM_SQUARE,
+        .frequency = 440.0f,
+        .duty_cycle = 0.5f,
+        .filter_cutoff = MAX_FREQUENCY,
+        .attack_time = 0.1f,
+        .decay_time = 0.2f,
+        .sustain_level = 0.7f,
+        .release_time = 0.05f,
+        .adsr_state = ADSR_IDLE,
+    };
+    host_set_time_us(1000000);
+
+    waveform_generator_init();
+    tuning_init();
+    adsr_envelope_init();
+    modulation_init();
+    oversampling_init();
+    ks_init();
+    additive_init();
+    drums_init();
+    granular_init();
+    capture_init();
+    sequencer_init();
+    ui_controls_init();
+    audio_input_init();
+    latency_init();
+    power_init();
+    uart_comm_init();
+    adsr_update(&g_sound_system);
+
+    sample_period_ns = (uint64_t)llround(1e9 / timebase_get_sample_rate());
+    next_sample_ns = time_us_64() * 1000;
+    next_main_us = time_us_64();
+}
+
+static void test_button_trials(void) {
+    uint64_t t = time_us_64() + 100000;
+    for (uint32_t i = 0; i < BUTTON_TRIALS; i++) {
+        // Presses land at different points of the main loop period
+        uint64_t press_us = t + (i * 137) % MAIN_LOOP_US;
+        press_button(press_us);
+        run_until(press_us + 150000);
+        CHECK(g_sound_system.output_enabled && !watching, "button trial %lu: note did not sound", (unsigned long)i + 1);
+        check_last_trial(LATENCY_SRC_BUTTON, press_us, i + 1);
+        release_button(press_us + 160000);
+
+        // Second press switches the output off again; no trial
+        press_button(press_us + 250000);
+        release_button(press_us + 300000);
+        run_until(press_us + 400000);
+        CHECK(!g_sound_system.output_enabled, "button trial %lu: output still on", (unsigned long)i + 1);
+        CHECK(trials[LATENCY_SRC_BUTTON].count == i + 1, "switching off recorded a trial");
+        t = press_us + 500000 - (press_us % MAIN_LOOP_US);
+    }
+}
+
+static void test_still_sounding(void) {
+    // A note-on while the release is still audible cannot be timed
+    uint32_t before = trials[LATENCY_SRC_BUTTON].count;
+    g_sound_system.release_time = 0.5f;
+    uint64_t t = time_us_64() + 100000;
+    press_button(t);
+    release_button(t + 100000);
+    press_button(t + 200000);
+    release_button(t + 250000);
+    press_button(t + 300000);       // 100 ms into a 500 ms release
+    run_until(t + 450000);
+    CHECK(g_sound_system.output_enabled, "third press did not switch the output on");
+    CHECK(trials[LATENCY_SRC_BUTTON].count == before + 1, "trial recorded over a sounding note (%lu)",
+          (unsigned long)(trials[LATENCY_SRC_BUTTON].count - before));
+    release_button(t + 460000);
+    press_button(t + 560000);
+    release_button(t + 600000);
+    g_sound_system.release_time = 0.05f;
+    run_until(t + 1600000);
+}
+
+static void test_serial_trials(void) {
+    for (uint32_t i = 0; i < SERIAL_TRIALS; i++) {
+        uint64_t t = time_us_64() + 1000 + i * 311;
+        run_until(t);
+        host_queue_serial("note on\r");
+        // The command is read on the next main loop pass
+        uint64_t poll_us = next_main_us;
+        run_until(t + 150000);
+        check_last_trial(LATENCY_SRC_SERIAL, poll_us, i + 1);
+        host_queue_serial("note off\r");
+        run_until(t + 300000);
+    }
+}
+
+static void test_percentiles(void) {
+    uint32_t values[LATENCY_MAX_TRIALS];
+    for (uint32_t i = 0; i < LATENCY_MAX_TRIALS; i++) {
+        values[i] = (i * 37) % LATENCY_MAX_TRIALS + 1;     // 1..64 shuffled
+    }
+    latency_sort(values, LATENCY_MAX_TRIALS);
+    bool sorted = true;
+    for (uint32_t i = 0; i < LATENCY_MAX_TRIALS; i++) {
+        sorted = sorted && values[i] == i + 1;
+    }
+    CHECK(sorted, "sort did not order 1..%d", LATENCY_MAX_TRIALS);
+
+    // Nearest rank: the smallest value with at least p% of trials at or below it
+    CHECK(latency_percentile(values, 64, 50) == 32, "p50 of 1..64 = %lu", (unsigned long)latency_percentile(values, 64, 50));
+    CHECK(latency_percentile(values, 64, 90) == 58, "p90 of 1..64 = %lu", (unsigned long)latency_percentile(values, 64, 90));
+    CHECK(latency_percentile(values, 64, 99) == 64, "p99 of 1..64 = %lu", (unsigned long)latency_percentile(values, 64, 99));
+    CHECK(latency_percentile(values, 10, 50) == 5, "p50 of 1..10 = %lu", (unsigned long)latency_percentile(values, 10, 50));
+    CHECK(latency_percentile(values, 10, 90) == 9, "p90 of 1..10 = %lu", (unsigned long)latency_percentile(values, 10, 90));
+    CHECK(latency_percentile(values, 10, 99) == 10, "p99 of 1..10 = %lu", (unsigned long)latency_percentile(values, 10, 99));
+    CHECK(latency_percentile(values, 1, 50) == 1, "p50 of one trial");
+    CHECK(latency_percentile(values, 1, 0) == 1, "p0 of one trial");
+}
+
+static void test_trial_ring(void) {
+    // More trials than the ring holds: the oldest are replaced
+    latency_reset();
+    g_sound_system.envelope_level = 0.0f;
+    uint32_t total_trials = LATENCY_MAX_TRIALS + 9;
+    for (uint32_t i = 0; i < total_trials; i++) {
+        uint32_t input = time_us_32();
+        host_advance_us(10);
+        latency_arm(LATENCY_SRC_SERIAL, input);
+        host_advance_us(100 + i);
+        latency_tap(1.0f);
+        latency_service();
+    }
+    latency_trials_t *t = &trials[LATENCY_SRC_SERIAL];
+    CHECK(t->count == total_trials, "ring count %lu", (unsigned long)t->count);
+    uint32_t oldest = 0xFFFFFFFFu;
+    uint32_t newest = 0;
+    for (uint32_t i = 0; i < LATENCY_MAX_TRIALS; i++) {
+        uint32_t to_sound = t->total_us[i] - t->handled_us[i] - sample_period_us();
+        oldest = to_sound < oldest ? to_sound : oldest;
+        newest = to_sound > newest ? to_sound : newest;
+        CHECK(t->handled_us[i] == 10, "slot %lu input to handler %lu", (unsigned long)i, (unsigned long)t->handled_us[i]);
+    }
+    CHECK(oldest == 100 + total_trials - LATENCY_MAX_TRIALS && newest == 100 + total_trials - 1,
+          "ring holds %lu..%lu us, expected the last %d trials", (unsigned long)oldest,
+          (unsigned long)newest, LATENCY_MAX_TRIALS);
+    CHECK(trials[LATENCY_SRC_BUTTON].count == 0, "reset left button trials");
+    latency_print_report();
+}
+
+int main(void) {
+    setup();
+    test_button_trials();
+    test_still_sounding();
+    test_serial_trials();
+    latency_print_report();
+    test_percentiles();
+    test_trial_ring();
+    return test_finish("test_latency");
+}
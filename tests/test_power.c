@@ -0,0 +1,119 @@
+/**
+ * Deep idle wake-up tests
+ *
+ * Lets the system go quiet until power_service() enters deep idle, then
+ * wakes it with each button and with serial input, both before and after
+ * the latency harness has registered its button interrupt. Every wake must
+ * come from the interrupt the event raises (the shim's __wfi() only
+ * returns on one), no button edge may be left unacknowledged, and
+ * characters reported before idle began must end it at once.
+ */
+
+#include "test_support.h"
+#include "host_hal.h"
+#include "power.h"
+#include "latency.h"
+#include "ui_controls.h"
+
+#define PRESS_AFTER_MS 20           // Time asleep before the event
+#define GIVE_UP_MS 500              // Serial input that ends a test stuck in idle
+
+static uint32_t wfi_calls;
+static uint32_t press_after;
+static uint press_pin;
+static uint32_t serial_after;
+
+/**
+ * One millisecond asleep: time passes and the scheduled event happens
+ */
+static void asleep(void) {
+    wfi_calls++;
+    host_advance_us(1000);
+    if (wfi_calls == press_after) {
+        host_set_gpio(press_pin, false);
+    }
+    if (wfi_calls == serial_after) {
+        host_queue_serial("\r");
+    }
+}
+
+/**
+ * Let the system go quiet long enough for deep idle and run one main loop
+ * pass (which returns when idle ends)
+ * @return Wakes per source during the pass
+ */
+static power_stats_t idle_once(void) {
+    power_stats_t before;
+    power_stats_t after;
+    power_get_stats(&before);
+    wfi_calls = 0;
+    host_advance_us((POWER_IDLE_DELAY_MS + 10) * 1000u);
+    power_service(&g_sound_system);
+    power_get_stats(&after);
+    after.entries -= before.entries;
+    for (int i = 0; i < POWER_WAKE_SOURCE_COUNT; i++) {
+        after.wakes[i] -= before.wakes[i];
+    }
+    return after;
+}
+
+static void drain_serial(void) {
+    while (getchar_timeout_us(0) != PICO_ERROR_TIMEOUT) {
+    }
+}
+
+static void check_button_wakes(const char *when) {
+    static const uint pins[] = {WAVEFORM_BUTTON_PIN, OUTPUT_TOGGLE_PIN, DRUM_BUTTON_PIN};
+    for (unsigned i = 0; i < count_of(pins); i++) {
+        press_pin = pins[i];
+        press_after = PRESS_AFTER_MS;
+        serial_after = GIVE_UP_MS;
+        power_stats_t woke = idle_once();
+        CHECK(woke.entries == 1 && woke.wakes[POWER_WAKE_BUTTON] == 1,
+              "%s: pin %u press gave %lu entries, %lu button wakes", when, pins[i],
+              (unsigned long)woke.entries, (unsigned long)woke.wakes[POWER_WAKE_BUTTON]);
+        CHECK(wfi_calls == PRESS_AFTER_MS, "%s: pin %u press did not raise an interrupt (woke after %lu ms)",
+              when, pins[i], (unsigned long)wfi_calls);
+        host_set_gpio(pins[i], true);
+        drain_serial();
+    }
+    CHECK(host_gpio_unacknowledged() == 0, "%s: %lu button edges left unacknowledged", when,
+          (unsigned long)host_gpio_unacknowledged());
+}
+
+static void test_serial_before_idle(void) {
+    // Reported by the chars-available callback, not read by the main loop yet
+    press_after = 0;
+    serial_after = GIVE_UP_MS;
+    host_queue_serial("x");
+    power_stats_t woke = idle_once();
+    CHECK(woke.wakes[POWER_WAKE_SERIAL] == 1 && wfi_calls == 0,
+          "pending input did not end idle at once (slept %lu ms)", (unsigned long)wfi_calls);
+    drain_serial();
+}
+
+static void test_serial_during_idle(void) {
+    press_after = 0;
+    serial_after = PRESS_AFTER_MS;
+    power_stats_t woke = idle_once();
+    CHECK(woke.wakes[POWER_WAKE_SERIAL] == 1 && wfi_calls == PRESS_AFTER_MS,
+          "serial input woke after %lu ms, %lu serial wakes", (unsigned long)wfi_calls,
+          (unsigned long)woke.wakes[POWER_WAKE_SERIAL]);
+    drain_serial();
+}
+
+int main(void) {
+    host_set_time_us(1000000);
+    timebase_init();
+    ui_controls_init();
+    power_init();
+    host_set_wfi_hook(asleep);
+
+    test_serial_before_idle();
+    test_serial_during_idle();
+    check_button_wakes("without the latency harness");
+
+    latency_init();
+    check_button_wakes("with the latency harness");
+    return test_finish("test_power");
+}
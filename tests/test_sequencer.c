@@ -0,0 +1,257 @@
+/**
+ * Sequencer event queue tests
+ *
+ * Pushes events out of order and on the same sample across the wrap of the
+ * 32-bit sample counter and checks the sample interrupt applies them in
+ * time order, same-sample events in queue order, each on its own sample.
+ * Also runs the pattern and arpeggiator across the wrap, and checks the
+ * arpeggiator's octave follows the active scale.
+ */
+
+#include "test_support.h"
+#include "host_hal.h"
+
+// The sample counter is the test's, and frequency events are logged in the
+// order the sequencer applies them
+#define timebase_get_sample_count test_sample_count
+#define modulation_set_base_increment test_apply_frequency
+#include "../src/sequencer.c"
+#undef timebase_get_sample_count
+#undef modulation_set_base_increment
+
+#include "tuning.h"
+#include "uart_comm.h"
+
+#define LOG_SIZE 512
+
+typedef struct {
+    uint32_t tag;                   // phase_increment of the event
+    uint32_t applied;               // Sample count it was applied on
+} applied_t;
+
+static uint32_t now;
+static applied_t log_entries[LOG_SIZE];
+static uint32_t log_count;
+
+uint32_t test_sample_count(void) {
+    return now;
+}
+
+void test_apply_frequency(uint32_t increment, uint32_t fraction) {
+    (void)fraction;
+    if (log_count < LOG_SIZE) {
+        log_entries[log_count].tag = increment;
+        log_entries[log_count].applied = now;
+        log_count++;
+    }
+}
+
+static void reset_queue(uint32_t start) {
+    sequencer_init();
+    now = start;
+    log_count = 0;
+}
+
+static void push_frequency(uint32_t time, uint32_t tag) {
+    seq_event_t event = {.time = time, .type = SEQ_EVENT_FREQUENCY, .phase_increment = tag};
+    CHECK(seq_queue_push(&event), "queue full pushing tag %lu", (unsigned long)tag);
+}
+
+/**
+ * Run the sample interrupt's sequencer step for a number of samples
+ */
+static void run_samples(uint32_t count) {
+    for (uint32_t n = 0; n < count; n++) {
+        now++;
+        sequencer_process(&g_sound_system);
+    }
+}
+
+static void test_wrap_order(void) {
+    // Start 16 samples before the counter wraps; times are offsets from there
+    uint32_t start = 0xFFFFFFF0u;
+    reset_queue(start);
+
+    static const struct {
+        uint32_t offset;
+        uint32_t tag;
+    } pushes[] = {
+        {20, 7},                    // After the wrap
+        {5, 2},
+        {16, 5},                    // Sample count 0
+        {5, 3},                     // Same sample as tag 2, pushed later
+        {30, 9},
+        {15, 4},                    // Last sample before the wrap
+        {1, 1},
+        {20, 8},                    // Same sample as tag 7
+        {16, 6},                    // Same sample as tag 5
+        {5, 10},                    // Third on sample 5, pushed last
+    };
+    for (unsigned i = 0; i < count_of(pushes); i++) {
+        push_frequency(start + pushes[i].offset, pushes[i].tag);
+    }
+    run_samples(40);
+
+    static const uint32_t expected_tags[] = {1, 2, 3, 10, 4, 5, 6, 7, 8, 9};
+    static const uint32_t expected_offsets[] = {1, 5, 5, 5, 15, 16, 16, 20, 20, 30};
+    CHECK(log_count == count_of(expected_tags), "%lu events applied, expected %u",
+          (unsigned long)log_count, (unsigned)count_of(expected_tags));
+    for (unsigned i = 0; i < log_count && i < count_of(expected_tags); i++) {
+        CHECK(log_entries[i].tag == expected_tags[i], "event %u is tag %lu, expected %lu",
+              i, (unsigned long)log_entries[i].tag, (unsigned long)expected_tags[i]);
+        CHECK(log_entries[i].applied == start + expected_offsets[i],
+              "tag %lu applied at offset %lu, expected %lu", (unsigned long)log_entries[i].tag,
+              (unsigned long)(log_entries[i].applied - start), (unsigned long)expected_offsets[i]);
+    }
+
+    seq_stats_t result;
+    sequencer_get_stats(&result);
+    CHECK(result.events == count_of(expected_tags), "stats.events %lu", (unsigned long)result.events);
+    CHECK(result.late == 0 && result.max_late == 0, "late %lu, max_late %lu",
+          (unsigned long)result.late, (unsigned long)result.max_late);
+    CHECK(queue_count == 0, "%d events left in the queue", queue_count);
+}
+
+static void test_full_queue(void) {
+    // Fill the queue in scrambled order straddling the wrap, then drain it
+    uint32_t start = 0xFFFFFF00u;
+    reset_queue(start);
+    uint32_t noise = 12345;
+    uint32_t offsets[SEQ_QUEUE_SIZE];
+    for (uint32_t i = 0; i < SEQ_QUEUE_SIZE; i++) {
+        noise = noise * 1103515245u + 12345u;
+        offsets[i] = 1 + (noise >> 16) % 512;   // Ties are likely
+        push_frequency(start + offsets[i], i);
+    }
+    seq_event_t extra = {.time = start + 1, .type = SEQ_EVENT_FREQUENCY};
+    CHECK(!seq_queue_push(&extra), "push into a full queue succeeded");
+
+    run_samples(600);
+    CHECK(log_count == SEQ_QUEUE_SIZE, "%lu of %d events applied", (unsigned long)log_count, SEQ_QUEUE_SIZE);
+
+    bool ordered = true;
+    bool on_time = true;
+    for (uint32_t i = 0; i < log_count; i++) {
+        uint32_t tag = log_entries[i].tag;
+        on_time = on_time && log_entries[i].applied == start + offsets[tag];
+        if (i > 0) {
+            uint32_t previous = log_entries[i - 1].tag;
+            // Earlier sample first; on the same sample, earlier push first
+            ordered = ordered && (offsets[previous] < offsets[tag] ||
+                                  (offsets[previous] == offsets[tag] && previous < tag));
+        }
+    }
+    CHECK(ordered, "events not in (time, push order)");
+    CHECK(on_time, "events not applied on their sample");
+
+    seq_stats_t result;
+    sequencer_get_stats(&result);
+    CHECK(result.max_late == 0 && result.dropped == 1, "max_late %lu, dropped %lu",
+          (unsigned long)result.max_late, (unsigned long)result.dropped);
+}
+
+static void test_late_event(void) {
+    // An interrupt that misses a sample applies the event one sample late
+    uint32_t start = 0xFFFFFFFEu;
+    reset_queue(start);
+    push_frequency(start + 2, 1);
+    now += 3;
+    sequencer_process(&g_sound_system);
+    seq_stats_t result;
+    sequencer_get_stats(&result);
+    CHECK(log_count == 1 && result.late == 1 && result.max_late == 1,
+          "late event: applied %lu, late %lu, max_late %lu", (unsigned long)log_count,
+          (unsigned long)result.late, (unsigned long)result.max_late);
+}
+
+static void test_pattern_across_wrap(void) {
+    // Run the pattern at the top tempo over the wrap with the main loop
+    // servicing the queue every millisecond
+    reset_queue(0xFFFFFFFFu - 4000);
+    g_sound_system.frequency = 440.0f;
+    sequencer_set_tempo(SEQ_MAX_TEMPO);
+    sequencer_start(&g_sound_system);
+
+    uint32_t loop_samples = (uint32_t)(timebase_get_sample_rate() / 1000.0f);
+    for (int loop = 0; loop < 400; loop++) {
+        sequencer_service(&g_sound_system);
+        run_samples(loop_samples);
+    }
+    sequencer_stop(&g_sound_system);
+
+    double step_samples = timebase_get_sample_rate() * 60.0 / (SEQ_MAX_TEMPO * SEQ_STEPS_PER_BEAT);
+    bool wrapped = false;
+    bool spaced = true;
+    for (uint32_t i = 1; i < log_count; i++) {
+        uint32_t gap = log_entries[i].applied - log_entries[i - 1].applied;
+        spaced = spaced && fabs(gap - step_samples) <= 1.0;
+        wrapped = wrapped || log_entries[i].applied < log_entries[i - 1].applied;
+    }
+    CHECK(log_count > 5 && wrapped, "%lu steps, wrapped %d", (unsigned long)log_count, wrapped);
+    CHECK(spaced, "step spacing differs from %.2f samples", step_samples);
+
+    seq_stats_t result;
+    sequencer_get_stats(&result);
+    CHECK(result.max_late == 0 && result.dropped == 0, "max_late %lu, dropped %lu",
+          (unsigned long)result.max_late, (unsigned long)result.dropped);
+    sequencer_set_tempo(SEQ_DEFAULT_TEMPO);
+}
+
+static void test_arp_octave_stride(void) {
+    static const int8_t notes[] = {0, 2};
+    sequencer_set_arp_notes(notes, count_of(notes));
+    sequencer_set_arp(ARP_UP, 3);
+
+    tuning_set_mode(TUNING_EQUAL);
+    int equal[6];
+    for (uint32_t step = 0; step < 6; step++) {
+        equal[step] = seq_arp_note(step);
+    }
+    CHECK(equal[2] == 12 && equal[3] == 14 && equal[5] == 26, "12-TET arp %d %d %d", equal[2], equal[3], equal[5]);
+
+    // A five-degree scale: the octave is five scale steps
+    static const float pentatonic[] = {200.0f, 400.0f, 700.0f, 900.0f, 1200.0f};
+    tuning_load_degrees(pentatonic, count_of(pentatonic), false);
+    tuning_set_mode(TUNING_SCALA);
+    int scala[6];
+    for (uint32_t step = 0; step < 6; step++) {
+        scala[step] = seq_arp_note(step);
+    }
+    CHECK(scala[2] == 5 && scala[3] == 7 && scala[5] == 12, "pentatonic arp %d %d %d", scala[2], scala[3], scala[5]);
+
+    // 64 degrees over three octaves is beyond int8_t
+    float wide[TUNING_MAX_DEGREES];
+    for (int i = 0; i < TUNING_MAX_DEGREES; i++) {
+        wide[i] = 1200.0f * (i + 1) / TUNING_MAX_DEGREES;
+    }
+    tuning_load_degrees(wide, TUNING_MAX_DEGREES, false);
+    CHECK(seq_arp_note(5) == 2 * TUNING_MAX_DEGREES + 2, "64-degree arp top note %d", seq_arp_note(5));
+
+    tuning_set_mode(TUNING_CONTINUOUS);
+    sequencer_set_arp(ARP_OFF, 1);
+}
+
+static void test_arp_notes_command(void) {
+    static const int8_t notes[] = {0, 4, 7};
+    sequencer_set_arp_notes(notes, count_of(notes));
+
+    char too_many[] = "arp notes 0 1 2 3 4 5 6 7 8";
+    uart_handle_command(&g_sound_system, too_many);
+    CHECK(arp_note_count == 3, "excess notes accepted (%d held)", arp_note_count);
+
+    char eight[] = "arp notes 0 1 2 3 4 5 6 7";
+    uart_handle_command(&g_sound_system, eight);
+    CHECK(arp_note_count == SEQ_ARP_MAX_NOTES, "%d notes held, expected %d", arp_note_count, SEQ_ARP_MAX_NOTES);
+}
+
+int main(void) {
+    timebase_init();
+    tuning_init();
+    test_wrap_order();
+    test_full_queue();
+    test_late_event();
+    test_pattern_across_wrap();
+    test_arp_octave_stride();
+    test_arp_notes_command();
+    return test_finish("test_sequencer");
+}
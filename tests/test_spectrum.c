@@ -0,0 +1,264 @@
+/**
+ * Spectrum analyzer tests
+ *
+ * Compares the fixed-point radix-4 FFT with a double-precision DFT for 256
+ * and 1024 points, then runs synthetic tones through the capture, window,
+ * FFT and analysis path and checks peak frequency, level, THD and noise
+ * floor against a double-precision reference. Built once per supported
+ * SPECTRUM_FFT_SIZE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "test_support.h"
+#include "host_hal.h"
+
+// The analysis functions are private to the module
+#include "../src/spectrum_analyzer.c"
+
+#define FFT_MIN_SNR_DB 75.0         // Fixed-point FFT error vs. the exact DFT
+#define FULL_SCALE_BIN_POWER (1.0 / 16.0)   // Full-scale sine, Hann, 1/N scaled
+
+static double ref_re[SPECTRUM_FFT_SIZE];
+static double ref_im[SPECTRUM_FFT_SIZE];
+
+static uint32_t random_state = 12345;
+
+static int32_t random_q23(void) {
+    random_state = random_state * 1664525u + 1013904223u;
+    return ((int32_t)(random_state >> 8) - (1 << 23)) / 2;
+}
+
+/**
+ * Exact DFT divided by n, the scaling spectrum_fft() applies
+ */
+static void reference_dft(const int32_t *data, uint16_t n) {
+    for (int k = 0; k < n; k++) {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double angle = -2.0 * M_PI * (double)((uint32_t)k * i % n) / n;
+            re += data[2 * i] * cos(angle) - data[2 * i + 1] * sin(angle);
+            im += data[2 * i] * sin(angle) + data[2 * i + 1] * cos(angle);
+        }
+        ref_re[k] = re / n;
+        ref_im[k] = im / n;
+    }
+}
+
+/**
+ * Run the fixed-point FFT on a copy of data and compare it with the DFT
+ * @return Signal-to-error ratio in dB
+ */
+static double fft_snr_db(const int32_t *input, uint16_t n) {
+    static int32_t data[2 * SPECTRUM_FFT_SIZE];
+    memcpy(data, input, 2 * n * sizeof(int32_t));
+    reference_dft(input, n);
+    spectrum_fft(data, n);
+
+    double signal = 0.0, error = 0.0;
+    for (int k = 0; k < n; k++) {
+        double dr = data[2 * k] - ref_re[k];
+        double di = data[2 * k + 1] - ref_im[k];
+        signal += ref_re[k] * ref_re[k] + ref_im[k] * ref_im[k];
+        error += dr * dr + di * di;
+    }
+    return 10.0 * log10(signal / (error + 1e-30));
+}
+
+static void test_fft_against_dft(void) {
+    static int32_t input[2 * SPECTRUM_FFT_SIZE];
+    const uint16_t sizes[] = {256, 1024};
+
+    for (unsigned s = 0; s < count_of(sizes); s++) {
+        uint16_t n = sizes[s];
+        if (n > SPECTRUM_FFT_SIZE) {
+            continue;
+        }
+
+        // Complex noise exercises every butterfly and twiddle
+        for (int i = 0; i < n; i++) {
+            input[2 * i] = random_q23();
+            input[2 * i + 1] = random_q23();
+        }
+        double snr = fft_snr_db(input, n);
+        printf("  %4d-point FFT, complex noise: %.1f dB SNR vs double DFT\n", n, snr);
+        CHECK(snr > FFT_MIN_SNR_DB, "%d-point noise SNR %.1f dB", n, snr);
+
+        // A full-scale complex exponential lands in exactly one bin
+        int bin = n / 8 + 3;
+        for (int i = 0; i < n; i++) {
+            double angle = 2.0 * M_PI * bin * i / n;
+            input[2 * i] = (int32_t)lrint(cos(angle) * ((1 << 23) - 1));
+            input[2 * i + 1] = (int32_t)lrint(sin(angle) * ((1 << 23) - 1));
+        }
+        snr = fft_snr_db(input, n);
+        printf("  %4d-point FFT, bin %d tone: %.1f dB SNR vs double DFT\n", n, bin, snr);
+        CHECK(snr > FFT_MIN_SNR_DB, "%d-point tone SNR %.1f dB", n, snr);
+    }
+}
+
+typedef struct {
+    float bins;                 // Frequency in FFT bins, so tones scale with the length
+    float amplitude;            // Fraction of full scale
+    float harmonic_2;           // Harmonic amplitudes relative to the fundamental
+    float harmonic_3;
+    float noise;                // Uniform noise amplitude, fraction of full scale
+} tone_t;
+
+/**
+ * Render a tone into PWM samples the way the sample interrupt taps them
+ */
+static void render_tone(const tone_t *tone, uint8_t *samples) {
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        double phase = 2.0 * M_PI * tone->bins * i / SPECTRUM_FFT_SIZE;
+        double value = sin(phase) + tone->harmonic_2 * sin(2 * phase) + tone->harmonic_3 * sin(3 * phase);
+        value *= tone->amplitude;
+        value += tone->noise * ((random_state = random_state * 1664525u + 1013904223u) / 4294967296.0 * 2.0 - 1.0);
+        long sample = lrint(128.0 + 127.0 * value);
+        samples[i] = (uint8_t)(sample < 0 ? 0 : sample > 255 ? 255 : sample);
+    }
+}
+
+/**
+ * The analysis in double precision on the same PWM samples
+ */
+static void reference_analysis(const uint8_t *samples, spectrum_result_t *result) {
+    const int n = SPECTRUM_FFT_SIZE;
+    const int bins = n / 2;
+    static double power[SPECTRUM_FFT_SIZE / 2];
+    static bool excluded[SPECTRUM_FFT_SIZE / 2];
+
+    for (int k = 0; k < bins; k++) {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double window = 0.5 - 0.5 * cos(2.0 * M_PI * i / n);
+            double x = (samples[i] - 128) / 128.0 * window;
+            double angle = -2.0 * M_PI * (double)((uint32_t)k * i % n) / n;
+            re += x * cos(angle);
+            im += x * sin(angle);
+        }
+        power[k] = (re * re + im * im) / ((double)n * n) / FULL_SCALE_BIN_POWER;
+        excluded[k] = k < SPECTRUM_SKIP_BINS;
+    }
+
+    int peak = SPECTRUM_SKIP_BINS;
+    for (int k = SPECTRUM_SKIP_BINS + 1; k < bins - 1; k++) {
+        if (power[k] > power[peak]) {
+            peak = k;
+        }
+    }
+    double alpha = log(power[peak - 1]), beta = log(power[peak]), gamma = log(power[peak + 1]);
+    double offset = 0.5 * (alpha - gamma) / (alpha - 2.0 * beta + gamma);
+    result->peak_frequency = (float)((peak + offset) * timebase_get_sample_rate() / n);
+    result->peak_level_db = (float)(10.0 * log10(power[peak]));
+
+    double fundamental = 0.0, harmonics = 0.0;
+    for (int h = 1; h <= SPECTRUM_MAX_HARMONIC; h++) {
+        int center = (int)lrint(h * (peak + offset));
+        if (h > 1 && center + SPECTRUM_LOBE_BINS >= bins) {
+            break;
+        }
+        for (int k = center - SPECTRUM_LOBE_BINS; k <= center + SPECTRUM_LOBE_BINS; k++) {
+            if (k >= 0 && k < bins) {
+                if (h == 1) {
+                    fundamental += power[k];
+                } else {
+                    harmonics += power[k];
+                }
+                excluded[k] = true;
+            }
+        }
+    }
+    result->thd_percent = (float)(sqrt(harmonics / fundamental) * 100.0);
+
+    double noise = 0.0;
+    int noise_bins = 0;
+    for (int k = 0; k < bins; k++) {
+        if (!excluded[k]) {
+            noise += power[k];
+            noise_bins++;
+        }
+    }
+    result->noise_floor_db = (float)(10.0 * log10(noise / noise_bins));
+}
+
+/**
+ * Analyze a tone on the device path and in double precision and compare
+ * @param expected_thd THD the tone was built with (%)
+ * @param thd_tolerance Allowed difference from expected_thd (%), negative to skip
+ */
+static void check_tone(const char *name, const tone_t *tone, float expected_thd, float thd_tolerance) {
+    static uint8_t samples[SPECTRUM_FFT_SIZE];
+    render_tone(tone, samples);
+
+    // Through the sample interrupt's tap, then core 1's processing
+    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
+        spectrum_tap(samples[i]);
+    }
+    CHECK(capture_ready, "%s: capture not complete", name);
+    spectrum_window_capture();
+    CHECK(!capture_ready && capture_index == 0, "%s: capture not handed back", name);
+    spectrum_fft(fft_data, SPECTRUM_FFT_SIZE);
+    spectrum_result_t result;
+    spectrum_analyze(&result);
+
+    spectrum_result_t reference;
+    reference_analysis(samples, &reference);
+
+    float bin_width = timebase_get_sample_rate() / SPECTRUM_FFT_SIZE;
+    float frequency = tone->bins * bin_width;
+    printf("  %-16s peak %8.2f Hz %6.2f dBFS, THD %6.3f%%, floor %6.1f dBFS/bin"
+           " (ref %8.2f Hz %6.2f dBFS, %6.3f%%, %6.1f)\n",
+           name, result.peak_frequency, result.peak_level_db, result.thd_percent,
+           result.noise_floor_db, reference.peak_frequency, reference.peak_level_db,
+           reference.thd_percent, reference.noise_floor_db);
+
+    CHECK(fabsf(result.peak_frequency - frequency) <= bin_width / 2,
+          "%s: peak %.2f Hz, set %.2f Hz", name, result.peak_frequency, frequency);
+    CHECK(fabsf(result.peak_frequency - reference.peak_frequency) < 0.01f * bin_width,
+          "%s: peak %.2f Hz, reference %.2f Hz", name, result.peak_frequency, reference.peak_frequency);
+    CHECK(fabsf(result.peak_level_db - reference.peak_level_db) < 0.05f,
+          "%s: level %.2f dB, reference %.2f dB", name, result.peak_level_db, reference.peak_level_db);
+    CHECK(fabsf(result.thd_percent - reference.thd_percent) < 0.02f * reference.thd_percent + 0.01f,
+          "%s: THD %.3f%%, reference %.3f%%", name, result.thd_percent, reference.thd_percent);
+    CHECK(thd_tolerance < 0.0f || fabsf(result.thd_percent - expected_thd) < thd_tolerance,
+          "%s: THD %.3f%%, expected %.3f%%", name, result.thd_percent, expected_thd);
+    CHECK(fabsf(result.noise_floor_db - reference.noise_floor_db) < 1.0f,
+          "%s: noise floor %.1f dB, reference %.1f dB", name, result.noise_floor_db,
+          reference.noise_floor_db);
+}
+
+static void test_analysis(void) {
+    // Above SPECTRUM_SKIP_BINS, with the 10th harmonic of the distorted tone
+    // still below Nyquist at 256 points
+    const tone_t pure = {23.22f, 0.8f, 0.0f, 0.0f, 0.0f};
+    const tone_t on_bin = {40.0f, 0.5f, 0.0f, 0.0f, 0.0f};
+    const tone_t distorted = {10.22f, 0.6f, 0.05f, 0.10f, 0.0f};
+    const tone_t noisy = {58.05f, 0.5f, 0.0f, 0.0f, 0.1f};
+
+    // 8-bit output rounding alone shows up as a few tenths of a percent
+    check_tone("sine", &pure, 0.0f, 0.5f);
+    check_tone("on-bin sine", &on_bin, 0.0f, 0.5f);
+    check_tone("sine + h2/h3", &distorted, sqrtf(0.05f * 0.05f + 0.10f * 0.10f) * 100.0f, 0.5f);
+    check_tone("sine + noise", &noisy, 0.0f, -1.0f);
+
+    // Uniform noise of amplitude a has variance a^2/3; after the Hann window
+    // (sum of squares 3N/8) and 1/N scaling each bin holds variance * 3/(8N),
+    // which is variance * 6/N relative to a full-scale sine's bin
+    static uint8_t samples[SPECTRUM_FFT_SIZE];
+    render_tone(&noisy, samples);
+    spectrum_result_t reference;
+    reference_analysis(samples, &reference);
+    double variance = noisy.noise * noisy.noise / 3.0 * (127.0 / 128.0) * (127.0 / 128.0);
+    double expected_floor = 10.0 * log10(variance * 6.0 / SPECTRUM_FFT_SIZE);
+    CHECK(fabs(reference.noise_floor_db - expected_floor) < 1.5,
+          "noise floor %.1f dB, expected %.1f dB", reference.noise_floor_db, expected_floor);
+}
+
+int main(void) {
+    printf("SPECTRUM_FFT_SIZE %d\n", SPECTRUM_FFT_SIZE);
+    spectrum_analyzer_init();
+    test_fft_against_dft();
+    test_analysis();
+    return test_finish(SPECTRUM_FFT_SIZE == 256 ? "test_spectrum_256" : "test_spectrum");
+}
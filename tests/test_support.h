@@ -0,0 +1,33 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+// Record a failure and keep going, so one run reports every broken check
+#define CHECK(condition, ...)                                         \
+    do {                                                              \
+        if (!(condition)) {                                           \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);               \
+            printf(__VA_ARGS__);                                      \
+            printf("\n");                                             \
+            test_failures++;                                          \
+        }                                                             \
+    } while (0)
+
+/**
+ * Print the result line
+ * @param name Test program name
+ * @return Process exit status (0 if every check passed)
+ */
+static inline int test_finish(const char *name) {
+    if (test_failures) {
+        printf("%s: %d check(s) failed\n", name, test_failures);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+#endif // TEST_SUPPORT_H
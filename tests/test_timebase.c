@@ -0,0 +1,117 @@
+/**
+ * Timebase tests
+ *
+ * Sets clk_sys to 125 MHz, 150 MHz and an overclock, and for every
+ * supported sample rate checks the PWM divider and wrap the timebase
+ * programs, the sample rate they really produce, and the pitch error of
+ * the phase increments update_phase_accumulator() derives from it, for
+ * continuous pitches and for 12-TET table notes.
+ */
+
+#include "test_support.h"
+#include "host_hal.h"
+#include "timebase.h"
+#include "tuning.h"
+#include "waveform_generator.h"
+
+#define TWO_POW_32 4294967296.0
+
+#define OVERCLOCK_KHZ 250000
+#define INCREMENT_32_CENTS 1e-2     // Integer increment only (32-bit phase)
+#define INCREMENT_64_CENTS 1e-3     // 32.32 increment, limited by the float rate
+
+static const uint32_t clocks_khz[] = {125000, 150000, OVERCLOCK_KHZ};
+static const uint32_t rates[] = {22050, 44100, 48000, 96000};
+static const float pitches[] = {MIN_FREQUENCY, 27.5f, 261.6256f, 440.0f, 3520.0f, 12345.6f, MAX_FREQUENCY};
+
+static sound_system_t sys;
+
+static double cents_between(double a, double b) {
+    return fabs(1200.0 * log2(a / b));
+}
+
+/**
+ * Largest pitch error of the oscillator increment over the test pitches
+ * (or the first notes of the table in a tuned mode) at the real rate
+ */
+static void check_pitch(const char *label, double real_rate) {
+    double worst_32 = 0.0;
+    double worst_64 = 0.0;
+    int count = tuning_get_mode() == TUNING_CONTINUOUS ? (int)count_of(pitches) : tuning_note_count();
+    for (int i = 0; i < count; i++) {
+        sys.frequency = tuning_get_mode() == TUNING_CONTINUOUS ? pitches[i] : tuning_note_frequency(i);
+        update_phase_accumulator(&sys);
+        double from_32 = sys.phase_increment / TWO_POW_32 * real_rate;
+        double from_64 = (sys.phase_increment + sys.phase_increment_fraction / TWO_POW_32) / TWO_POW_32 * real_rate;
+        worst_32 = fmax(worst_32, cents_between(from_32, sys.frequency));
+        worst_64 = fmax(worst_64, cents_between(from_64, sys.frequency));
+    }
+    CHECK(worst_32 < INCREMENT_32_CENTS, "%s: 32-bit increment off by %.2e cents", label, worst_32);
+    CHECK(worst_64 < INCREMENT_64_CENTS, "%s: 64-bit increment off by %.2e cents", label, worst_64);
+}
+
+static void check_rate(uint32_t khz, uint32_t rate) {
+    char label[48];
+    snprintf(label, sizeof(label), "%lu kHz clk_sys, %lu Hz", (unsigned long)khz, (unsigned long)rate);
+    CHECK(timebase_set_sample_rate(&sys, rate), "%s: rate rejected", label);
+
+    // Smallest integer divider that keeps the wrap within 16 bits, then the
+    // nearest period
+    uint32_t sys_hz = khz * 1000;
+    uint32_t divider = 1;
+    while ((double)sys_hz / divider / rate > 65536.0) {
+        divider++;
+    }
+    uint32_t period = (uint32_t)lround((double)sys_hz / divider / rate);
+    double real_rate = (double)sys_hz / ((double)divider * period);
+
+    uint slice = pwm_gpio_to_slice_num(PWM_OUTPUT_PIN);
+    CHECK(host_get_pwm_divider(slice) == divider && timebase_get_pwm_divider() == divider,
+          "%s: divider %u (reported %lu), expected %lu", label, host_get_pwm_divider(slice),
+          (unsigned long)timebase_get_pwm_divider(), (unsigned long)divider);
+    CHECK(host_get_pwm_wrap(slice) == period - 1 && timebase_get_pwm_levels() == period,
+          "%s: wrap %u (levels %u), expected %lu", label, host_get_pwm_wrap(slice),
+          timebase_get_pwm_levels(), (unsigned long)(period - 1));
+
+    // The rounded period is within half a count of the exact one
+    double rate_cents = cents_between(real_rate, rate);
+    CHECK(rate_cents <= 1200.0 * log2(1.0 + 0.5 / (period - 0.5)), "%s: real rate %.3f Hz is %.3f cents off",
+          label, real_rate, rate_cents);
+    CHECK(cents_between(timebase_get_sample_rate(), real_rate) < 1e-4, "%s: timebase reports %.3f Hz, real %.3f Hz",
+          label, timebase_get_sample_rate(), real_rate);
+    printf("  %-26s divider %lu, wrap %5lu, real %10.3f Hz (%+.3f cents)\n", label, (unsigned long)divider,
+           (unsigned long)(period - 1), real_rate, 1200.0 * log2(real_rate / rate));
+
+    tuning_set_mode(TUNING_CONTINUOUS);
+    check_pitch(label, real_rate);
+    tuning_set_mode(TUNING_EQUAL);
+    check_pitch(label, real_rate);
+    tuning_set_mode(TUNING_CONTINUOUS);
+}
+
+static void test_clocks_and_rates(void) {
+    for (unsigned c = 0; c < count_of(clocks_khz); c++) {
+        if (clocks_khz[c] > 150000) {
+            CHECK(timebase_set_system_clock(&sys, clocks_khz[c]), "overclock to %lu kHz rejected",
+                  (unsigned long)clocks_khz[c]);
+        } else {
+            // The part's own boot clock
+            host_set_sys_clock_hz(clocks_khz[c] * 1000);
+            timebase_init();
+        }
+        for (unsigned r = 0; r < count_of(rates); r++) {
+            check_rate(clocks_khz[c], rates[r]);
+        }
+    }
+    CHECK(!timebase_set_sample_rate(&sys, 32000), "unsupported rate accepted");
+}
+
+int main(void) {
+    sys.frequency = 440.0f;
+    sys.duty_cycle = 0.5f;
+    sys.filter_cutoff = MAX_FREQUENCY;
+    tuning_init();
+    tuning_set_high_precision(true);
+    test_clocks_and_rates();
+    return test_finish("test_timebase");
+}
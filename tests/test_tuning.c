@@ -0,0 +1,181 @@
+/**
+ * Tuning table tests
+ *
+ * Rebuilds the expected note list in double precision for 12-TET, just
+ * intonation and several Scala scales (up to TUNING_MAX_DEGREES degrees),
+ * and checks the table covers MIN_FREQUENCY-MAX_FREQUENCY completely and
+ * that table frequencies and phase increments are within their cents
+ * error budgets. Scales the table cannot cover must be rejected.
+ */
+
+#include "test_support.h"
+#include "host_hal.h"
+#include "tuning.h"
+#include "timebase.h"
+
+#define TWO_POW_32 4294967296.0
+#define TWO_POW_64 18446744073709551616.0
+
+#define FLOAT_CENTS 2e-4            // Table frequencies are stored as float
+#define INCREMENT_32_CENTS 1e-3     // Integer increment only (32-bit phase)
+#define INCREMENT_64_CENTS 1e-12    // 32.32 increment (64-bit phase)
+
+static double cents_between(double a, double b) {
+    return fabs(1200.0 * log2(a / b));
+}
+
+/**
+ * Check the table against every degree of the scale between MIN_FREQUENCY
+ * and MAX_FREQUENCY
+ * @param ratios Degrees 1..count as ratios over the root; the last is the period
+ */
+static void check_table(const char *name, double root, const double *ratios, int count) {
+    double rate = timebase_get_sample_rate();
+    double period = ratios[count - 1];
+
+    // Expected notes, ascending
+    static double expected[4 * TUNING_MAX_NOTES];
+    int expected_count = 0;
+    int octave = (int)floor(log(MIN_FREQUENCY / root) / log(period)) - 1;
+    for (double base = root * pow(period, octave); base <= MAX_FREQUENCY; base *= period) {
+        for (int degree = 0; degree < count; degree++) {
+            double frequency = base * (degree == 0 ? 1.0 : ratios[degree - 1]);
+            if (frequency >= MIN_FREQUENCY && frequency <= MAX_FREQUENCY) {
+                expected[expected_count++] = frequency;
+            }
+        }
+    }
+
+    int notes = tuning_note_count();
+    CHECK(notes == expected_count, "%s: %d table notes, %d degrees in range", name, notes, expected_count);
+    CHECK(notes <= TUNING_MAX_NOTES, "%s: %d notes over TUNING_MAX_NOTES", name, notes);
+
+    double worst_float = 0.0;
+    double worst_32 = 0.0;
+    double worst_64 = 0.0;
+    for (int i = 0; i < notes && i < expected_count; i++) {
+        double frequency = expected[i];
+        uint32_t fraction;
+        uint32_t increment = tuning_note_increment(i, &fraction);
+        double from_32 = increment / TWO_POW_32 * rate;
+        double from_64 = (((uint64_t)increment << 32) | fraction) / TWO_POW_64 * rate;
+
+        worst_float = fmax(worst_float, cents_between(tuning_note_frequency(i), frequency));
+        worst_32 = fmax(worst_32, cents_between(from_32, frequency));
+        worst_64 = fmax(worst_64, cents_between(from_64, frequency));
+        CHECK(tuning_nearest((float)frequency, -1) == i, "%s: %.3f Hz not nearest to note %d", name, frequency, i);
+    }
+    printf("  %-22s %3d notes %7.2f-%8.2f Hz, worst cents: float %.1e, 32-bit %.1e, 64-bit %.1e\n",
+           name, notes, tuning_note_frequency(0), tuning_note_frequency(notes - 1),
+           worst_float, worst_32, worst_64);
+    CHECK(worst_float < FLOAT_CENTS, "%s: table frequency off by %.2e cents", name, worst_float);
+    CHECK(worst_32 < INCREMENT_32_CENTS, "%s: 32-bit increment off by %.2e cents", name, worst_32);
+    CHECK(worst_64 < INCREMENT_64_CENTS, "%s: 64-bit increment off by %.2e cents", name, worst_64);
+}
+
+/**
+ * Load a Scala scale from cents and check its table
+ */
+static void check_scala(const char *name, const float *cents, int count) {
+    double ratios[TUNING_MAX_DEGREES];
+    for (int i = 0; i < count; i++) {
+        ratios[i] = pow(2.0, cents[i] / 1200.0);
+    }
+    CHECK(tuning_load_degrees(cents, count, false), "%s: degrees rejected", name);
+    CHECK(tuning_set_mode(TUNING_SCALA), "%s: Scala mode rejected", name);
+    check_table(name, TUNING_DEFAULT_ROOT, ratios, count);
+}
+
+static void test_equal_and_just(void) {
+    double equal[12];
+    for (int i = 0; i < 12; i++) {
+        equal[i] = pow(2.0, (i + 1) / 12.0);
+    }
+    tuning_set_mode(TUNING_EQUAL);
+    check_table("12-TET", TUNING_DEFAULT_ROOT, equal, 12);
+
+    static const double just[] = {
+        16.0 / 15.0, 9.0 / 8.0, 6.0 / 5.0, 5.0 / 4.0, 4.0 / 3.0, 45.0 / 32.0,
+        3.0 / 2.0, 8.0 / 5.0, 5.0 / 3.0, 9.0 / 5.0, 15.0 / 8.0, 2.0
+    };
+    tuning_set_mode(TUNING_JUST);
+    check_table("5-limit just", TUNING_DEFAULT_ROOT, just, 12);
+
+    // Another root moves the whole table
+    tuning_set_root(27.5f);
+    check_table("5-limit just on A0", 27.5, just, 12);
+    tuning_set_root(TUNING_DEFAULT_ROOT);
+}
+
+static void test_scala(void) {
+    static const float pentatonic[] = {200.0f, 400.0f, 700.0f, 900.0f, 1200.0f};
+    check_scala("pentatonic", pentatonic, count_of(pentatonic));
+
+    // Bohlen-Pierce: 13 degrees over a 3/1 tritave
+    float bohlen_pierce[13];
+    for (int i = 0; i < 13; i++) {
+        bohlen_pierce[i] = (float)(1200.0 * log2(3.0) * (i + 1) / 13);
+    }
+    check_scala("Bohlen-Pierce", bohlen_pierce, 13);
+
+    // The largest scale: every degree over ten octaves must fit
+    float edo[TUNING_MAX_DEGREES];
+    for (int i = 0; i < TUNING_MAX_DEGREES; i++) {
+        edo[i] = 1200.0f * (i + 1) / TUNING_MAX_DEGREES;
+    }
+    check_scala("64-EDO", edo, TUNING_MAX_DEGREES);
+}
+
+static void test_rejected_scales(void) {
+    // 64 degrees in a half-octave period need twice the table
+    float dense[TUNING_MAX_DEGREES];
+    for (int i = 0; i < TUNING_MAX_DEGREES; i++) {
+        dense[i] = 600.0f * (i + 1) / TUNING_MAX_DEGREES;
+    }
+    CHECK(!tuning_load_degrees(dense, TUNING_MAX_DEGREES, false), "64 degrees in 600 cents accepted");
+
+    // Appending is checked against the whole scale: 16 degrees in 300 cents
+    // fit, 32 in 375 cents do not
+    float part[16];
+    for (int i = 0; i < 16; i++) {
+        part[i] = 300.0f * (i + 1) / 16;
+    }
+    CHECK(tuning_load_degrees(part, 16, false), "16 degrees in 300 cents rejected");
+    for (int i = 0; i < 16; i++) {
+        part[i] = 300.0f + 75.0f * (i + 1) / 16;
+    }
+    CHECK(!tuning_load_degrees(part, 16, true), "32 degrees in 375 cents accepted");
+
+    float too_many[TUNING_MAX_DEGREES + 1];
+    for (int i = 0; i <= TUNING_MAX_DEGREES; i++) {
+        too_many[i] = 1200.0f * (i + 1) / (TUNING_MAX_DEGREES + 1);
+    }
+    CHECK(!tuning_load_degrees(too_many, TUNING_MAX_DEGREES + 1, false), "%d degrees accepted", TUNING_MAX_DEGREES + 1);
+
+    static const float descending[] = {400.0f, 300.0f, 1200.0f};
+    CHECK(!tuning_load_degrees(descending, count_of(descending), false), "descending degrees accepted");
+}
+
+static void test_continuous_increments(void) {
+    // Off-table frequencies are computed directly
+    tuning_set_mode(TUNING_CONTINUOUS);
+    double rate = timebase_get_sample_rate();
+    double worst = 0.0;
+    for (double frequency = MIN_FREQUENCY; frequency <= MAX_FREQUENCY; frequency *= 1.0137) {
+        uint32_t fraction;
+        uint32_t increment = tuning_frequency_to_increment((float)frequency, &fraction);
+        double produced = (((uint64_t)increment << 32) | fraction) / TWO_POW_64 * rate;
+        worst = fmax(worst, cents_between(produced, (float)frequency));
+    }
+    CHECK(worst < INCREMENT_64_CENTS, "continuous 64-bit increment off by %.2e cents", worst);
+}
+
+int main(void) {
+    timebase_init();
+    tuning_init();
+    test_equal_and_just();
+    test_scala();
+    test_rejected_scales();
+    test_continuous_increments();
+    return test_finish("test_tuning");
+}
@@ -0,0 +1,139 @@
+/**
+ * Waveform crossfade continuity tests
+ *
+ * Changes the waveform with the button handler (and directly) several times
+ * within one WAVEFORM_CROSSFADE_MS fade, renders generate_waveform_sample()
+ * and checks the output never jumps between two samples.
+ */
+
+#include <stdlib.h>
+#include "test_support.h"
+#include "host_hal.h"
+#include "waveform_generator.h"
+#include "ui_controls.h"
+#include "modulation.h"
+#include "oversampling.h"
+#include "tuning.h"
+#include "timebase.h"
+
+// A low pitch keeps the shapes' own slopes small and the test window inside
+// one cycle, so the sawtooth never resets within it
+#define TEST_FREQUENCY 50.0f
+
+// Steepest step of the shapes (between adjacent entries of the 256-entry
+// sine table) plus the slope of a full-scale crossfade, in output levels
+// per sample, with a level of rounding on top
+#define SHAPE_STEP (2.0f * (float)M_PI * 127.5f / 256.0f)
+#define FADE_STEP (255.0f * 1000.0f / (WAVEFORM_CROSSFADE_MS * SAMPLE_RATE))
+#define MAX_STEP (SHAPE_STEP + FADE_STEP + 1.0f)
+
+static sound_system_t sys;
+static int max_step;
+static int previous = -1;
+
+/**
+ * Render output samples and track the largest sample-to-sample step
+ * @return Last sample
+ */
+static int run_samples(uint32_t count) {
+    for (uint32_t n = 0; n < count; n++) {
+        int sample = generate_waveform_sample(&sys);
+        if (previous >= 0 && abs(sample - previous) > max_step) {
+            max_step = abs(sample - previous);
+        }
+        previous = sample;
+    }
+    return previous;
+}
+
+static uint32_t ms(float t) {
+    return (uint32_t)(t * timebase_get_sample_rate() / 1000.0f);
+}
+
+/**
+ * Settle on a shape with no fade running, then restart its cycle
+ */
+static void reset(waveform_type_t shape) {
+    waveform_select(&sys, shape);
+    run_samples(ms(3 * WAVEFORM_CROSSFADE_MS));
+    sys.phase_accumulator = 0;
+    sys.phase_fraction = 0;
+    previous = -1;
+    max_step = 0;
+}
+
+/**
+ * Check the output is the plain sine after the fades
+ */
+static void check_settled_on_sine(const char *name) {
+    CHECK(sys.current_waveform == WAVEFORM_SINE, "%s: selected waveform %d", name, sys.current_waveform);
+    int worst = 0;
+    for (int n = 0; n < 64; n++) {
+        int expected = generate_sine_wave(sys.phase_accumulator >> 16);
+        int error = abs(run_samples(1) - expected);
+        worst = error > worst ? error : worst;
+    }
+    CHECK(worst <= 1, "%s: output differs from the sine by %d levels", name, worst);
+}
+
+static void test_two_presses(void) {
+    // Triangle -> sawtooth -> sine, the second press 1 ms into the fade
+    reset(WAVEFORM_TRIANGLE);
+    run_samples(ms(2));
+    ui_handle_waveform_button(&sys);
+    run_samples(ms(1));
+    ui_handle_waveform_button(&sys);
+    run_samples(ms(3 * WAVEFORM_CROSSFADE_MS));
+    CHECK(max_step <= MAX_STEP, "two presses: step %d > %.1f", max_step, MAX_STEP);
+    check_settled_on_sine("two presses");
+}
+
+static void test_second_press_late_in_fade(void) {
+    // Second press when the new shape is already dominant
+    reset(WAVEFORM_TRIANGLE);
+    ui_handle_waveform_button(&sys);
+    run_samples(ms(WAVEFORM_CROSSFADE_MS * 0.8f));
+    ui_handle_waveform_button(&sys);
+    run_samples(ms(3 * WAVEFORM_CROSSFADE_MS));
+    CHECK(max_step <= MAX_STEP, "late second press: step %d > %.1f", max_step, MAX_STEP);
+    check_settled_on_sine("late second press");
+}
+
+static void test_back_and_forth(void) {
+    // Going back to the shape fading out, then on to a third one
+    reset(WAVEFORM_TRIANGLE);
+    waveform_select(&sys, WAVEFORM_SAWTOOTH);
+    run_samples(ms(WAVEFORM_CROSSFADE_MS * 0.4f));
+    waveform_select(&sys, WAVEFORM_TRIANGLE);
+    run_samples(ms(WAVEFORM_CROSSFADE_MS * 0.3f));
+    waveform_select(&sys, WAVEFORM_SINE);
+    run_samples(ms(WAVEFORM_CROSSFADE_MS * 0.2f));
+    waveform_select(&sys, WAVEFORM_SAWTOOTH);
+    run_samples(ms(WAVEFORM_CROSSFADE_MS * 0.2f));
+    waveform_select(&sys, WAVEFORM_SINE);
+    run_samples(ms(3 * WAVEFORM_CROSSFADE_MS));
+    CHECK(max_step <= MAX_STEP, "back and forth: step %d > %.1f", max_step, MAX_STEP);
+    check_settled_on_sine("back and forth");
+}
+
+int main(void) {
+    timebase_init();
+    tuning_init();
+    modulation_init();
+    oversampling_init();
+
+    sys.current_waveform = WAVEFORM_SQUARE;
+    sys.frequency = TEST_FREQUENCY;
+    sys.duty_cycle = 0.5f;
+    sys.filter_cutoff = MAX_FREQUENCY;
+    sys.adsr_state = ADSR_SUSTAIN;
+    sys.sustain_level = 1.0f;
+    sys.envelope_level = 1.0f;
+    update_phase_accumulator(&sys);
+    modulation_update_control(&sys);
+
+    test_two_presses();
+    test_second_press_late_in_fade();
+    test_back_and_forth();
+    return test_finish("test_waveform");
+}